@@ -0,0 +1,132 @@
+#include "AhoCorasick.h"
+#include <queue>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AHO_CORASICK_SSE2 1
+#endif
+
+using namespace std;
+
+AhoCorasick::AhoCorasick(const vector<string>& terms) {
+    for (const auto& t : terms) {
+        if (!t.empty()) patterns.push_back(t);
+        longest = max(longest, t.size());
+    }
+
+    startsTerm.fill(false);
+    for (const auto& t : patterns) {
+        unsigned char first = static_cast<unsigned char>(t[0]);
+        if (!startsTerm[first]) {
+            startsTerm[first] = true;
+            startBytes.push_back(first);
+        }
+    }
+
+    // Class 0 is "byte not used by any pattern".
+    byteClass.fill(0);
+    for (const auto& t : patterns) {
+        for (unsigned char c : t) {
+            if (byteClass[c] == 0) byteClass[c] = static_cast<uint16_t>(classCount++);
+        }
+    }
+
+    // Trie over classes, -1 marks a missing edge until the BFS below fills it.
+    transitions.assign(classCount, -1);
+    output.assign(1, -1);
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        int32_t state = 0;
+        for (unsigned char c : patterns[i]) {
+            size_t slot = state * classCount + byteClass[c];
+            if (transitions[slot] < 0) {
+                transitions[slot] = static_cast<int32_t>(output.size());
+                output.push_back(-1);
+                transitions.resize(transitions.size() + classCount, -1);
+            }
+            state = transitions[slot];
+        }
+        if (output[state] < 0) output[state] = static_cast<int32_t>(i);
+    }
+
+    // Breadth-first pass turns the trie into a DFA: missing edges take the
+    // failure state's edge, and outputs are inherited along failure links.
+    vector<int32_t> failure(output.size(), 0);
+    queue<int32_t> pending;
+    for (size_t c = 0; c < classCount; ++c) {
+        int32_t child = transitions[c];
+        if (child < 0) {
+            transitions[c] = 0;
+        }
+        else {
+            failure[child] = 0;
+            pending.push(child);
+        }
+    }
+
+    while (!pending.empty()) {
+        int32_t state = pending.front();
+        pending.pop();
+        if (output[state] < 0) output[state] = output[failure[state]];
+
+        for (size_t c = 0; c < classCount; ++c) {
+            size_t slot = state * classCount + c;
+            int32_t child = transitions[slot];
+            int32_t fallback = transitions[failure[state] * classCount + c];
+            if (child < 0) {
+                transitions[slot] = fallback;
+            }
+            else {
+                failure[child] = fallback;
+                pending.push(child);
+            }
+        }
+    }
+}
+
+size_t AhoCorasick::skipToCandidate(const char* text, size_t pos, size_t length) const {
+#ifdef AHO_CORASICK_SSE2
+    if (startBytes.size() <= kMaxVectorStartBytes) {
+        __m128i needles[kMaxVectorStartBytes];
+        for (size_t i = 0; i < startBytes.size(); ++i) {
+            needles[i] = _mm_set1_epi8(static_cast<char>(startBytes[i]));
+        }
+        for (; pos + 16 <= length; pos += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+            __m128i hits = _mm_setzero_si128();
+            for (size_t i = 0; i < startBytes.size(); ++i) {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+            }
+            int mask = _mm_movemask_epi8(hits);
+            if (mask) {
+                int bit = 0;
+                while (!(mask & (1 << bit))) ++bit;
+                return pos + bit;
+            }
+        }
+    }
+#endif
+    while (pos < length && !startsTerm[static_cast<unsigned char>(text[pos])]) ++pos;
+    return pos;
+}
+
+bool AhoCorasick::findFirst(const char* text, size_t length, Match& match, size_t reportFrom) const {
+    if (patterns.empty()) return false;
+
+    const int32_t* table = transitions.data();
+    const size_t width = classCount;
+    int32_t state = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (state == 0) {
+            i = skipToCandidate(text, i, length);
+            if (i == length) break;
+        }
+        state = table[state * width + byteClass[static_cast<unsigned char>(text[i])]];
+        if (output[state] >= 0 && i >= reportFrom) {
+            match.term = static_cast<size_t>(output[state]);
+            match.offset = i + 1 - patterns[match.term].size();
+            return true;
+        }
+    }
+    return false;
+}
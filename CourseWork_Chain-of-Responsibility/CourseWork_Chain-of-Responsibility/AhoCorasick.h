@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Multi-pattern matcher compiled into a full DFA over byte classes.
+// Bytes that occur in no pattern share one class, which keeps the
+// transition table small for UTF-8 (Cyrillic) term lists.
+// While the automaton sits in the root state, a prefilter skips ahead to
+// the next byte that can start a term (16 bytes per step with SSE2 when
+// there are only a few distinct first bytes).
+class AhoCorasick {
+public:
+    struct Match {
+        size_t term;     // index into the term list
+        size_t offset;   // byte offset of the match start
+    };
+
+    AhoCorasick() = default;
+    explicit AhoCorasick(const std::vector<std::string>& terms);
+
+    bool empty() const { return patterns.empty(); }
+    size_t termCount() const { return patterns.size(); }
+    const std::string& term(size_t index) const { return patterns[index]; }
+    size_t maxTermLength() const { return longest; }
+
+    // Reports the match that ends first in `text`. Matches ending before
+    // `reportFrom` are skipped: scanning a piece of a longer text from
+    // maxTermLength() - 1 bytes before the piece gives the same answer as
+    // scanning the whole text up to there.
+    bool findFirst(const char* text, size_t length, Match& match, size_t reportFrom = 0) const;
+    bool findFirst(const std::string& text, Match& match) const {
+        return findFirst(text.data(), text.size(), match);
+    }
+
+private:
+    static const size_t kMaxVectorStartBytes = 6;
+
+    size_t skipToCandidate(const char* text, size_t pos, size_t length) const;
+
+    std::vector<std::string> patterns;
+    size_t longest = 0;
+    std::array<bool, 256> startsTerm{};
+    std::vector<unsigned char> startBytes;
+    std::array<uint16_t, 256> byteClass{};
+    size_t classCount = 1;
+    std::vector<int32_t> transitions;   // state * classCount + class
+    std::vector<int32_t> output;        // term ending in the state (or a suffix), -1 if none
+};
@@ -0,0 +1,78 @@
+#include "AsyncIO.h"
+
+using namespace std;
+
+IoThreadPool& IoThreadPool::shared() {
+    // Several threads, so a coroutine resumed on one of them (and busy
+    // validating) does not hold up the next read it has already queued.
+    static IoThreadPool pool(4);
+    return pool;
+}
+
+IoThreadPool::IoThreadPool(size_t threads) {
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this] { run(); });
+    }
+}
+
+IoThreadPool::~IoThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void IoThreadPool::submit(function<void()> job) {
+    {
+        lock_guard<mutex> guard(lock);
+        jobs.push_back(move(job));
+    }
+    wake.notify_one();
+}
+
+void IoThreadPool::run() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return; // stopping and drained
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+IoOperation<string> readChunkAsync(shared_ptr<ifstream> in, size_t maxBytes) {
+    return IoOperation<string>([in, maxBytes] {
+        string chunk(maxBytes, '\0');
+        in->read(chunk.data(), static_cast<streamsize>(maxBytes));
+        chunk.resize(static_cast<size_t>(in->gcount()));
+        return chunk;
+    });
+}
+
+IoOperation<optional<string>> readFileAsync(string path, size_t maxBytes) {
+    return IoOperation<optional<string>>([path = move(path), maxBytes]() -> optional<string> {
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in.is_open()) return nullopt;
+        const streamoff size = in.tellg();
+        if (size < 0 || static_cast<uint64_t>(size) > maxBytes) return nullopt;
+
+        string data(static_cast<size_t>(size), '\0');
+        in.seekg(0);
+        if (!in.read(data.data(), size)) return nullopt;
+        return data;
+    });
+}
+
+IoOperation<bool> writeChunkAsync(shared_ptr<ofstream> out, string data) {
+    return IoOperation<bool>([out, data = move(data)] {
+        out->write(data.data(), static_cast<streamsize>(data.size()));
+        return static_cast<bool>(*out);
+    });
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <coroutine>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Blocking file calls run on a small pool of I/O threads so the caller can
+// keep parsing and validating meanwhile. (A portable stand-in for io_uring:
+// no extra dependency, and the same code runs on Windows.)
+class IoThreadPool {
+public:
+    static IoThreadPool& shared();
+
+    explicit IoThreadPool(size_t threads);
+    ~IoThreadPool();
+
+    IoThreadPool(const IoThreadPool&) = delete;
+    IoThreadPool& operator=(const IoThreadPool&) = delete;
+
+    void submit(std::function<void()> job);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void run();
+};
+
+// An I/O call already in flight. It starts when constructed, so the caller
+// can do other work and co_await the result later; the awaiting coroutine
+// resumes on the I/O thread that finished the call.
+template <typename T>
+class IoOperation {
+public:
+    explicit IoOperation(std::function<T()> work) : state(std::make_shared<State>()) {
+        IoThreadPool::shared().submit([s = state, work = std::move(work)] {
+            T result = work();
+            std::coroutine_handle<> waiter;
+            {
+                std::lock_guard<std::mutex> guard(s->lock);
+                s->result = std::move(result);
+                s->done = true;
+                waiter = s->waiter;
+            }
+            if (waiter) waiter.resume();
+        });
+    }
+
+    bool await_ready() const {
+        std::lock_guard<std::mutex> guard(state->lock);
+        return state->done;
+    }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (state->done) return false; // finished meanwhile, just continue
+        state->waiter = awaiting;
+        return true;
+    }
+    T await_resume() { return std::move(state->result); }
+
+private:
+    struct State {
+        std::mutex lock;
+        bool done = false;
+        T result{};
+        std::coroutine_handle<> waiter;
+    };
+    std::shared_ptr<State> state;
+};
+
+// Up to `maxBytes` from the current position; shorter only at end of file.
+// At most one operation may be in flight per stream.
+IoOperation<std::string> readChunkAsync(std::shared_ptr<std::ifstream> in, size_t maxBytes);
+IoOperation<bool> writeChunkAsync(std::shared_ptr<std::ofstream> out, std::string data);
+// Opens and reads the whole file on the pool; nothing if it cannot be
+// opened or is longer than `maxBytes`.
+IoOperation<std::optional<std::string>> readFileAsync(std::string path, size_t maxBytes);
@@ -0,0 +1,121 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+
+// Lazily started coroutine returning a T. The body runs when the task is
+// first awaited (or handed to syncWait) and resumes its awaiter when done,
+// on whichever thread finished the last awaited operation.
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> done) noexcept {
+                auto next = done.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        template <typename U>
+        void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() {
+        auto& promise = handle.promise();
+        if (promise.error) std::rethrow_exception(promise.error);
+        return std::move(*promise.value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+    struct SyncWaitLatch {
+        std::mutex lock;
+        std::condition_variable signal;
+        bool done = false;
+    };
+
+    // Starts immediately and frees its own frame when finished.
+    struct DetachedCoroutine {
+        struct promise_type {
+            DetachedCoroutine get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    template <typename T>
+    DetachedCoroutine runToLatch(Task<T>& task, std::optional<T>& result, std::exception_ptr& error, SyncWaitLatch& latch) {
+        try {
+            result.emplace(co_await task);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        // Notify under the lock: the waiter may destroy the latch as soon as
+        // it can reacquire it.
+        std::lock_guard<std::mutex> guard(latch.lock);
+        latch.done = true;
+        latch.signal.notify_one();
+    }
+}
+
+// Runs a task to completion from ordinary (non-coroutine) code, blocking
+// the calling thread. Exceptions from the task are rethrown here.
+template <typename T>
+T syncWait(Task<T> task) {
+    std::optional<T> result;
+    std::exception_ptr error;
+    detail::SyncWaitLatch latch;
+
+    detail::runToLatch(task, result, error, latch);
+    {
+        std::unique_lock<std::mutex> guard(latch.lock);
+        latch.signal.wait(guard, [&latch] { return latch.done; });
+    }
+
+    if (error) std::rethrow_exception(error);
+    return std::move(*result);
+}
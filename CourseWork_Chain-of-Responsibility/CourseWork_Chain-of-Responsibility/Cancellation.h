@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+// Set by whoever wants a validation run to stop (a signal handler, another
+// thread); the run polls it. Setting it is a single lock-free store, so it
+// is safe from a signal handler. One-shot: use a new token per run.
+class CancellationToken {
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled{ false };
+};
+
+enum class StopReason {
+    None,
+    Deadline,
+    Cancelled,
+};
+
+// When a validation run has to give up: at a point in time, when a token
+// is cancelled, or whichever comes first. The default never stops and
+// costs nothing to poll. Runs check it between documents and between the
+// pieces of a long scan, so they overrun it by at most one piece.
+struct ValidationDeadline {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point at = Clock::time_point::max();
+    const CancellationToken* token = nullptr;
+
+    static ValidationDeadline after(Clock::duration budget, const CancellationToken* token = nullptr) {
+        ValidationDeadline deadline;
+        deadline.at = Clock::now() + budget;
+        deadline.token = token;
+        return deadline;
+    }
+    static ValidationDeadline cancelledBy(const CancellationToken& token) {
+        ValidationDeadline deadline;
+        deadline.token = &token;
+        return deadline;
+    }
+
+    bool unbounded() const { return !token && at == Clock::time_point::max(); }
+
+    StopReason reason() const {
+        if (token && token->isCancelled()) return StopReason::Cancelled;
+        if (at != Clock::time_point::max() && Clock::now() >= at) return StopReason::Deadline;
+        return StopReason::None;
+    }
+    bool passed() const { return reason() != StopReason::None; }
+};
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include "DaemonClient.h"
+
+using namespace std;
+
+namespace {
+    void printUsage() {
+        cerr << "Використання: document_client [--socket validator.sock] [--timeout <мс>] <команда>\n"
+            << "  validate <id>...                 перевірити збережені документи\n"
+            << "  check <формат> <0|1> <текст>     перевірити документ без збереження\n"
+            << "  add <формат> <0|1> <текст>       додати документ\n"
+            << "  edit <id> поле=значення...       content=, signed=0|1, format=, signature=\n"
+            << "  delete <id>...                   видалити документи\n"
+            << "  query [маска] [ліміт] [після]    ID документів з помилками (маска 0 = всі),\n"
+            << "                                   більші за ID \"після\"\n"
+            << "  get <id>...                      показати документи\n"
+            << "  save [файл]                      зберегти сховище демона\n"
+            << "  bench [пакет] [проходи]          затримка перевірки через демон\n";
+    }
+
+    bool parseIds(char** first, char** last, vector<DocumentId>& ids) {
+        for (char** arg = first; arg != last; ++arg) {
+            char* end = nullptr;
+            unsigned long long id = strtoull(*arg, &end, 10);
+            if (end == *arg || *end != '\0' || id == 0) {
+                cerr << "Невірний ID: " << *arg << "\n";
+                return false;
+            }
+            ids.push_back(id);
+        }
+        return !ids.empty();
+    }
+
+    void printVerdict(const DaemonClient::Verdict& verdict) {
+        if (verdict.status == daemon_protocol::ItemNotFound) {
+            cout << "не знайдено\n";
+            return;
+        }
+        if (verdict.status == daemon_protocol::ItemNotValidated) {
+            cout << "не перевірено (вичерпано час)\n";
+            return;
+        }
+        const ErrorSet& errors = verdict.errors;
+        if (errors.empty()) {
+            cout << "OK\n";
+            return;
+        }
+        cout << "помилки:";
+        for (const auto& error : errors) cout << " " << error;
+        cout << "\n";
+    }
+
+    // Validates every stored document through the daemon, first one per
+    // request and then in batches, so the cost of a round trip shows.
+    bool runBenchmark(DaemonClient& client, size_t batch, int rounds, uint32_t timeoutMs) {
+        vector<DocumentId> all;
+        for (vector<DocumentId> page;; all.insert(all.end(), page.begin(), page.end())) {
+            if (!client.query(0, 0, page, all.empty() ? 0 : all.back())) return false;
+            if (page.empty()) break;
+        }
+        if (all.empty()) {
+            cerr << "У демона немає документів\n";
+            return false;
+        }
+
+        cout << "Документів: " << all.size() << ", проходів: " << rounds << "\n";
+        cout << fixed << setprecision(2);
+        for (size_t size : { size_t(1), batch }) {
+            vector<DaemonClient::Verdict> results;
+            size_t requests = 0;
+            auto start = chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (size_t i = 0; i < all.size(); i += size) {
+                    vector<DocumentId> ids(all.begin() + i, all.begin() + min(all.size(), i + size));
+                    if (!client.validate(ids, results, timeoutMs)) return false;
+                    ++requests;
+                }
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            double documents = static_cast<double>(all.size()) * rounds;
+            cout << "Пакет " << size << ": " << seconds * 1e6 / documents << " мкс на документ, "
+                << seconds * 1e6 / requests << " мкс на запит\n";
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    string socketPath = "validator.sock";
+    uint32_t timeoutMs = 0;
+    int first = 1;
+    for (; first + 1 < argc; first += 2) {
+        string option = argv[first];
+        if (option == "--socket") socketPath = argv[first + 1];
+        else if (option == "--timeout") timeoutMs = static_cast<uint32_t>(strtoul(argv[first + 1], nullptr, 10));
+        else break;
+    }
+    if (first >= argc) {
+        printUsage();
+        return 1;
+    }
+
+    DaemonClient client;
+    if (!client.connect(socketPath)) {
+        cerr << client.error() << "\n";
+        return 1;
+    }
+
+    const string command = argv[first];
+    char** args = argv + first + 1;
+    char** argsEnd = argv + argc;
+    const size_t argCount = static_cast<size_t>(argsEnd - args);
+    bool ok = true;
+
+    if (command == "validate") {
+        vector<DocumentId> ids;
+        vector<DaemonClient::Verdict> results;
+        if (!parseIds(args, argsEnd, ids)) return 1;
+        ok = client.validate(ids, results, timeoutMs);
+        for (size_t i = 0; ok && i < ids.size(); ++i) {
+            cout << "ID " << ids[i] << ": ";
+            printVerdict(results[i]);
+        }
+    }
+    else if ((command == "check" || command == "add") && argCount == 3) {
+        vector<Document> docs;
+        docs.emplace_back(args[2], string(args[1]) == "1", args[0]);
+        if (command == "check") {
+            vector<DaemonClient::Verdict> results;
+            ok = client.validateDocuments(docs, results, timeoutMs);
+            if (ok) printVerdict(results[0]);
+        }
+        else {
+            vector<DocumentId> ids;
+            ok = client.add(docs, ids);
+            if (ok && ids[0] != 0) cout << "Додано документ з ID " << ids[0] << "\n";
+            else if (ok) cout << "Документ не додано\n";
+        }
+    }
+    else if (command == "edit" && argCount >= 2) {
+        vector<DocumentId> ids;
+        if (!parseIds(args, args + 1, ids)) return 1;
+        DocumentPatch patch;
+        for (char** arg = args + 1; arg != argsEnd; ++arg) {
+            string field = *arg;
+            size_t eq = field.find('=');
+            string name = eq == string::npos ? "" : field.substr(0, eq);
+            string value = eq == string::npos ? "" : field.substr(eq + 1);
+            if (name == "content") patch.content = value;
+            else if (name == "signed") patch.isSigned = value == "1";
+            else if (name == "format") patch.format = value;
+            else if (name == "signature") patch.signature = value;
+            else {
+                cerr << "Невідоме поле: " << field << "\n";
+                return 1;
+            }
+        }
+        vector<bool> done;
+        ok = client.edit({ { ids[0], patch } }, done);
+        if (ok) cout << (done[0] ? "Документ змінено\n" : "Документ не знайдено\n");
+    }
+    else if (command == "delete") {
+        vector<DocumentId> ids;
+        vector<bool> done;
+        if (!parseIds(args, argsEnd, ids)) return 1;
+        ok = client.remove(ids, done);
+        for (size_t i = 0; ok && i < ids.size(); ++i) {
+            cout << "ID " << ids[i] << ": " << (done[i] ? "видалено" : "не знайдено") << "\n";
+        }
+    }
+    else if (command == "query" && argCount <= 3) {
+        unsigned mask = argCount > 0 ? static_cast<unsigned>(strtoul(args[0], nullptr, 0)) : 0;
+        uint32_t limit = argCount > 1 ? static_cast<uint32_t>(strtoul(args[1], nullptr, 10)) : 0;
+        DocumentId after = argCount > 2 ? strtoull(args[2], nullptr, 10) : 0;
+        vector<DocumentId> ids;
+        ok = client.query(mask, limit, ids, after);
+        if (ok) {
+            for (DocumentId id : ids) cout << id << "\n";
+            cout << "Знайдено: " << ids.size() << "\n";
+        }
+    }
+    else if (command == "get") {
+        vector<DocumentId> ids;
+        vector<optional<Document>> docs;
+        if (!parseIds(args, argsEnd, ids)) return 1;
+        ok = client.get(ids, docs);
+        for (size_t i = 0; ok && i < ids.size(); ++i) {
+            if (!docs[i]) {
+                cout << "ID " << ids[i] << ": не знайдено\n";
+                continue;
+            }
+            string scratch;
+            cout << "ID " << ids[i] << " [" << docs[i]->format << ", "
+                << (docs[i]->isSigned ? "підписаний" : "без підпису") << "]: "
+                << docs[i]->content.text(scratch) << "\n";
+        }
+    }
+    else if (command == "save" && argCount <= 1) {
+        bool saved = false;
+        ok = client.save(argCount == 1 ? args[0] : "", saved);
+        if (ok) cout << (saved ? "Збережено\n" : "Не вдалося зберегти\n");
+    }
+    else if (command == "bench" && argCount <= 2) {
+        size_t batch = argCount > 0 ? max<size_t>(1, strtoull(args[0], nullptr, 10)) : 256;
+        int rounds = argCount > 1 ? max(1, atoi(args[1])) : 10;
+        ok = runBenchmark(client, batch, rounds, timeoutMs);
+    }
+    else {
+        printUsage();
+        return 1;
+    }
+
+    if (!ok) {
+        if (!client.error().empty()) cerr << client.error() << "\n";
+        return 1;
+    }
+    return 0;
+}
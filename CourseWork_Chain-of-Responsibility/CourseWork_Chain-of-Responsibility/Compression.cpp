@@ -0,0 +1,194 @@
+#include "Compression.h"
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    const size_t kMinMatch = 4;
+    const size_t kHashBits = 12;
+    const size_t kMaxOffset = 65535;
+    const size_t kTailLiterals = 5; // the last bytes of a block are always literals
+    const size_t kNoPosition = static_cast<size_t>(-1);
+
+    uint32_t read32(const char* p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    size_t hash4(uint32_t v) {
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    void writeLength(string& out, size_t len) {
+        while (len >= 255) {
+            out.push_back(static_cast<char>(255));
+            len -= 255;
+        }
+        out.push_back(static_cast<char>(len));
+    }
+
+    bool readLength(const unsigned char*& ip, const unsigned char* end, size_t& len) {
+        unsigned char b;
+        do {
+            if (ip == end) return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    }
+
+    // matchLen == 0 marks the final, literals-only sequence.
+    void emitSequence(string& out, const char* literals, size_t litLen, size_t offset, size_t matchLen) {
+        size_t extra = matchLen ? matchLen - kMinMatch : 0;
+        unsigned char token = static_cast<unsigned char>((min<size_t>(litLen, 15) << 4) | min<size_t>(extra, 15));
+        out.push_back(static_cast<char>(token));
+        if (litLen >= 15) writeLength(out, litLen - 15);
+        out.append(literals, litLen);
+        if (matchLen) {
+            out.push_back(static_cast<char>(offset & 0xFF));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (extra >= 15) writeLength(out, extra - 15);
+        }
+    }
+
+    const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+string compressBlock(const string& input) {
+    const size_t n = input.size();
+    const char* src = input.data();
+    string out;
+    out.reserve(n / 2 + 16);
+
+    vector<size_t> table(size_t(1) << kHashBits, kNoPosition);
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    if (n > kMinMatch + kTailLiterals) {
+        const size_t lastMatchStart = n - kTailLiterals - kMinMatch;
+        while (pos <= lastMatchStart) {
+            uint32_t seq = read32(src + pos);
+            size_t h = hash4(seq);
+            size_t candidate = table[h];
+            table[h] = pos;
+
+            if (candidate != kNoPosition && pos - candidate <= kMaxOffset && read32(src + candidate) == seq) {
+                size_t len = kMinMatch;
+                size_t maxLen = n - kTailLiterals - pos;
+                while (len < maxLen && src[candidate + len] == src[pos + len]) ++len;
+
+                emitSequence(out, src + anchor, pos - anchor, pos - candidate, len);
+                pos += len;
+                anchor = pos;
+            }
+            else {
+                ++pos;
+            }
+        }
+    }
+
+    emitSequence(out, src + anchor, n - anchor, 0, 0);
+    return out;
+}
+
+size_t maxDecompressedSize(size_t packedSize) {
+    return packedSize > SIZE_MAX / 255 ? SIZE_MAX : packedSize * 255;
+}
+
+bool decompressBlock(const string& packed, size_t originalSize, string& output, size_t limit) {
+    const size_t target = min(originalSize, limit);
+    output.clear();
+    if (target > maxDecompressedSize(packed.size())) return false;
+    output.reserve(target);
+
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(packed.data());
+    const unsigned char* end = ip + packed.size();
+
+    while (ip < end && output.size() < target) {
+        unsigned char token = *ip++;
+
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(ip, end, litLen)) return false;
+        if (static_cast<size_t>(end - ip) < litLen) return false;
+        output.append(reinterpret_cast<const char*>(ip), litLen);
+        ip += litLen;
+
+        if (ip == end) break; // final sequence has no match part
+
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t matchLen = token & 0x0F;
+        if (matchLen == 15 && !readLength(ip, end, matchLen)) return false;
+        matchLen += kMinMatch;
+
+        if (offset == 0 || offset > output.size()) return false;
+        // Matches may overlap the bytes they produce, so copy one at a time.
+        size_t from = output.size() - offset;
+        for (size_t i = 0; i < matchLen && output.size() < target; ++i) {
+            output.push_back(output[from + i]);
+        }
+    }
+
+    if (output.size() > target) output.resize(target);
+    return output.size() == target;
+}
+
+string encodeBase64(const string& bytes) {
+    string out;
+    out.reserve((bytes.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < bytes.size(); i += 3) {
+        uint32_t v = (static_cast<unsigned char>(bytes[i]) << 16)
+            | (static_cast<unsigned char>(bytes[i + 1]) << 8)
+            | static_cast<unsigned char>(bytes[i + 2]);
+        out.push_back(kBase64Alphabet[(v >> 18) & 0x3F]);
+        out.push_back(kBase64Alphabet[(v >> 12) & 0x3F]);
+        out.push_back(kBase64Alphabet[(v >> 6) & 0x3F]);
+        out.push_back(kBase64Alphabet[v & 0x3F]);
+    }
+
+    size_t rest = bytes.size() - i;
+    if (rest) {
+        uint32_t v = static_cast<unsigned char>(bytes[i]) << 16;
+        if (rest == 2) v |= static_cast<unsigned char>(bytes[i + 1]) << 8;
+        out.push_back(kBase64Alphabet[(v >> 18) & 0x3F]);
+        out.push_back(kBase64Alphabet[(v >> 12) & 0x3F]);
+        out.push_back(rest == 2 ? kBase64Alphabet[(v >> 6) & 0x3F] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+bool decodeBase64(const string& text, string& bytes) {
+    static const array<int, 256> lookup = [] {
+        array<int, 256> table;
+        table.fill(-1);
+        for (int i = 0; i < 64; ++i) table[static_cast<unsigned char>(kBase64Alphabet[i])] = i;
+        return table;
+    }();
+
+    bytes.clear();
+    bytes.reserve(text.size() / 4 * 3);
+
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : text) {
+        if (c == '=') break;
+        int v = lookup[static_cast<unsigned char>(c)];
+        if (v < 0) return false;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            bytes.push_back(static_cast<char>((acc >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// LZ4-style block codec used for large document bodies.
+// A block is a sequence of [token][literals][offset][match] records; the
+// decoder needs the original size and can stop early after `limit` bytes.
+std::string compressBlock(const std::string& input);
+bool decompressBlock(const std::string& packed, size_t originalSize, std::string& output,
+                     size_t limit = std::string::npos);
+// Most bytes a block of `packedSize` bytes can decode to (a length byte
+// adds at most 255); a larger declared original size means corruption.
+size_t maxDecompressedSize(size_t packedSize);
+
+// Compressed blocks are binary, the documents file is line based.
+std::string encodeBase64(const std::string& bytes);
+bool decodeBase64(const std::string& text, std::string& bytes);
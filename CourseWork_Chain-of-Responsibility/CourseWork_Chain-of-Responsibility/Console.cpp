@@ -0,0 +1,90 @@
+#include "Console.h"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+void initConsole() {
+#ifdef _WIN32
+    // Set console encoding for Ukrainian characters
+    SetConsoleCP(1251);
+    SetConsoleOutputCP(1251);
+
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (out != INVALID_HANDLE_VALUE && GetConsoleMode(out, &mode)) {
+        SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+}
+
+void clearScreen() {
+    cout << "\x1b[2J\x1b[H" << flush;
+}
+
+bool getValidatedInt(const string& prompt, int& result, int min, int max) {
+    cout << prompt;
+    string input;
+    getline(cin, input);
+
+    try {
+        result = stoi(input);
+        if (result < min || result > max) throw out_of_range("Out of range");
+        return true;
+    }
+    catch (...) {
+        cout << "Некоректне значення. Спробуйте ще раз!\n";
+        return false;
+    }
+}
+
+bool getValidatedId(const string& prompt, DocumentId& result, bool allowZero) {
+    cout << prompt;
+    string input;
+    getline(cin, input);
+
+    try {
+        size_t used = 0;
+        if (input.empty() || input[0] == '-') throw invalid_argument("Negative ID");
+        result = stoull(input, &used);
+        if (used != input.size() || (result == 0 && !allowZero)) throw out_of_range("Out of range");
+        return true;
+    }
+    catch (...) {
+        cout << "Некоректне значення. Спробуйте ще раз!\n";
+        return false;
+    }
+}
+
+int getValidatedMenuChoice(const string& prompt, int minOption, int maxOption) {
+    int choice;
+    string input;
+    while (true) {
+        cout << prompt;
+        getline(cin, input);
+
+        try {
+            choice = stoi(input);
+            if (choice >= minOption && choice <= maxOption) {
+                return choice;
+            }
+            else {
+                cout << "Неправильний пункт меню. Вибір має бути між " << minOption << " і " << maxOption << ".\n";
+            }
+        }
+        catch (...) {
+            cout << "Некоректний пункт меню. Спробуйте ще раз.\n";
+        }
+    }
+}
+
+void logResult(const string& message) {
+    ofstream logFile("log.txt", ios::app);
+    logFile << message << endl;
+    logFile.close();
+}
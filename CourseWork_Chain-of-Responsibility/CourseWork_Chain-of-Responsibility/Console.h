@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include "Document.h"
+
+// Thin portability layer for the interactive console.
+// On Windows the console is switched to CP1251 (sources are built with
+// /execution-charset:.1251) and ANSI escape handling is enabled; other
+// platforms are expected to run a UTF-8 terminal.
+void initConsole();
+
+// ANSI clear + cursor home; no shell process is spawned.
+void clearScreen();
+
+int getValidatedMenuChoice(const std::string& prompt, int minOption, int maxOption);
+bool getValidatedInt(const std::string& prompt, int& result, int min, int max);
+// Accepts 1..2^64-1, or 0 as well when `allowZero` is set.
+bool getValidatedId(const std::string& prompt, DocumentId& result, bool allowZero = false);
+void logResult(const std::string& message);
@@ -0,0 +1,160 @@
+#include "Content.h"
+#include "Compression.h"
+#include "MemoryUsage.h"
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Eight bytes per step; only used to find candidate duplicates.
+    uint64_t hashText(const string& text) {
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ text.size();
+        size_t i = 0;
+        for (; i + 8 <= text.size(); i += 8) {
+            uint64_t word;
+            memcpy(&word, text.data() + i, sizeof(word));
+            h = mix(h ^ word) + 0x9e3779b97f4a7c15ULL;
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, text.data() + i, text.size() - i);
+        return mix(h ^ tail);
+    }
+
+    shared_ptr<ContentBody> makeBody(string data, size_t size, bool compressed, uint64_t hash) {
+        auto body = make_shared<ContentBody>();
+        body->data = move(data);
+        body->size = size;
+        body->compressed = compressed;
+        body->hash = hash;
+        return body;
+    }
+}
+
+Content::Content(string text) {
+    if (text.empty()) return;
+    uint64_t h = hashText(text);
+    size_t size = text.size();
+    body = makeBody(move(text), size, false, h);
+}
+
+bool Content::fromCompressed(string packed, size_t originalSize, Content& out) {
+    if (originalSize == 0) {
+        out = Content();
+        return true;
+    }
+    string text;
+    if (!decompressBlock(packed, originalSize, text) || text.size() != originalSize) return false;
+    out.body = makeBody(move(packed), originalSize, true, hashText(text));
+    return true;
+}
+
+string Content::str() const {
+    if (!body) return string();
+    if (!body->compressed) return body->data;
+    string text;
+    decompressBlock(body->data, body->size, text);
+    return text;
+}
+
+const string& Content::text(string& scratch) const {
+    if (body && !body->compressed) return body->data;
+    scratch = str();
+    return scratch;
+}
+
+string Content::preview(size_t maxBytes) const {
+    if (!body) return string();
+    if (!body->compressed) return body->data.substr(0, maxBytes);
+    string text;
+    decompressBlock(body->data, body->size, text, maxBytes);
+    return text;
+}
+
+SniffedFormat Content::sniffedFormat() const {
+    if (!body) return SniffedFormat::Empty;
+    int cached = body->sniffed.load(memory_order_relaxed);
+    if (cached < 0) {
+        // Racing threads compute the same value, so no lock is needed.
+        if (body->compressed) {
+            string head = preview(kSniffBytes);
+            cached = static_cast<int>(sniffFormat(head.data(), head.size()));
+        }
+        else {
+            cached = static_cast<int>(sniffFormat(body->data.data(), body->data.size()));
+        }
+        body->sniffed.store(cached, memory_order_relaxed);
+    }
+    return static_cast<SniffedFormat>(cached);
+}
+
+const string& Content::stored() const {
+    static const string empty;
+    return body ? body->data : empty;
+}
+
+void Content::compress() {
+    if (!body || body->compressed) return;
+    string packed = compressBlock(body->data);
+    if (packed.size() < body->data.size()) {
+        auto packedBody = makeBody(move(packed), body->size, true, body->hash);
+        packedBody->sniffed.store(body->sniffed.load(memory_order_relaxed), memory_order_relaxed);
+        body = move(packedBody);
+    }
+}
+
+void Content::decompress() {
+    if (!body || !body->compressed) return;
+    auto plainBody = makeBody(str(), body->size, false, body->hash);
+    plainBody->sniffed.store(body->sniffed.load(memory_order_relaxed), memory_order_relaxed);
+    body = move(plainBody);
+}
+
+bool Content::sameText(const Content& other) const {
+    if (body == other.body) return true;
+    if (length() != other.length() || hash() != other.hash()) return false;
+    if (isCompressed() == other.isCompressed()) return stored() == other.stored();
+    return str() == other.str();
+}
+
+bool Content::findVerdict(uint64_t key, vector<string>& errors) const {
+    if (!body) return false;
+    lock_guard<mutex> lock(body->verdictLock);
+    auto it = body->verdicts.find(key);
+    if (it == body->verdicts.end()) return false;
+    errors.insert(errors.end(), it->second.begin(), it->second.end());
+    return true;
+}
+
+void Content::storeVerdict(uint64_t key, const vector<string>& errors) const {
+    if (!body) return;
+    lock_guard<mutex> lock(body->verdictLock);
+    body->verdicts[key] = errors;
+}
+
+void Content::clearVerdicts() const {
+    if (!body) return;
+    lock_guard<mutex> lock(body->verdictLock);
+    body->verdicts.clear();
+}
+
+size_t Content::bodyBytes() const {
+    return body ? sizeof(ContentBody) + memory::stringHeap(body->data) : 0;
+}
+
+size_t Content::verdictCacheBytes() const {
+    if (!body) return 0;
+    lock_guard<mutex> lock(body->verdictLock);
+    size_t bytes = memory::hashMapNodes(body->verdicts);
+    for (const auto& v : body->verdicts) bytes += memory::errorsHeap(v.second);
+    return bytes;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include "FormatSniffer.h"
+
+// Immutable document body. Identical bodies are shared between documents
+// (see DocumentStorage::internContent), so per-body caches such as
+// validator verdicts are computed once for every copy.
+struct ContentBody {
+    std::string data;      // plain text, or a compressed block when `compressed`
+    size_t size = 0;       // length of the plain text
+    bool compressed = false;
+    uint64_t hash = 0;     // hash of the plain text
+    mutable std::atomic<int> sniffed{ -1 }; // SniffedFormat, -1 until first asked
+
+    mutable std::mutex verdictLock;
+    mutable std::unordered_map<uint64_t, std::vector<std::string>> verdicts; // by Validator::verdictKey() or a key derived from it
+};
+
+// Document body that may be kept LZ-compressed in memory.
+// Length and emptiness are cached, so validators that only need them never
+// pay for decompression; str()/preview() decompress on demand.
+// Copies share the same body.
+class Content {
+private:
+    std::shared_ptr<const ContentBody> body;
+
+public:
+    Content() = default;
+    Content(std::string text);
+
+    // False, leaving `out` alone, unless `packed` decodes to exactly
+    // `originalSize` bytes.
+    static bool fromCompressed(std::string packed, size_t originalSize, Content& out);
+
+    bool empty() const { return length() == 0; }
+    size_t length() const { return body ? body->size : 0; }
+    bool isCompressed() const { return body && body->compressed; }
+    uint64_t hash() const { return body ? body->hash : 0; }
+
+    std::string str() const;
+    // Plain text without a copy when stored uncompressed; otherwise the
+    // body is decompressed into `scratch` and that is returned.
+    const std::string& text(std::string& scratch) const;
+    std::string preview(size_t maxBytes) const;
+    // Sniffed from the first kSniffBytes once per body, then cached.
+    SniffedFormat sniffedFormat() const;
+
+    // Stored representation: the compressed block, or the text itself.
+    const std::string& stored() const;
+
+    // Keeps the compressed form only if it is actually smaller.
+    void compress();
+    void decompress();
+
+    // Identity of the shared body, used for deduplication bookkeeping.
+    const ContentBody* identity() const { return body.get(); }
+    bool sameText(const Content& other) const;
+
+    // Verdict cache of the body; no-ops for empty content.
+    bool findVerdict(uint64_t key, std::vector<std::string>& errors) const;
+    void storeVerdict(uint64_t key, const std::vector<std::string>& errors) const;
+    void clearVerdicts() const;
+
+    // Heap bytes of the shared body (without its control block), and of
+    // its verdict cache; 0 for empty content.
+    size_t bodyBytes() const;
+    size_t verdictCacheBytes() const;
+};
@@ -0,0 +1,90 @@
+#include "CorpusStatistics.h"
+#include <fstream>
+#include <algorithm>
+#include <utility>
+#include "DocumentStorage.h"
+#include "WorkStealingScheduler.h"
+
+using namespace std;
+
+void CorpusStatistics::setLinks(vector<string> names, const ErrorPolicy& policy) {
+    if (!linkNames.empty()) return; // a sharded pass sets them once per shard
+    errorPolicy = policy;
+    linkNames = move(names);
+    linkFailures.assign(linkNames.size(), 0);
+}
+
+void CorpusStatistics::add(const Document& doc, bool invalid) {
+    ++total;
+    if (doc.isSigned) ++signedCount;
+    if (invalid) ++invalidCount;
+
+    const size_t length = doc.content.length();
+    bytes += length;
+    sizeSketch.add(static_cast<double>(length));
+
+    const unsigned errors = detectErrors(doc, errorPolicy);
+    for (int bit = 0; bit < DocumentErrorCount; ++bit) {
+        if (errors & (1u << bit)) ++categories[bit];
+    }
+    ++formatCounts[doc.format];
+}
+
+vector<pair<string, uint64_t>> CorpusStatistics::formats() const {
+    vector<pair<string, uint64_t>> sorted(formatCounts.begin(), formatCounts.end());
+    stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    return sorted;
+}
+
+bool collectFileStatistics(const string& path, const shared_ptr<Validator>& chain,
+                           CorpusStatistics& stats, vector<MalformedRecord>* malformed) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) return false;
+
+    vector<string> names;
+    for (Validator* link = chain.get(); link; link = link->nextLink()) {
+        names.push_back(linkLabel(*link, names.size()));
+    }
+    stats.setLinks(names, errorPolicyOf(chain.get()));
+    const size_t links = names.size();
+
+    const size_t kBatch = 4096;
+    WorkStealingScheduler& scheduler = WorkStealingScheduler::shared();
+    vector<shared_ptr<Document>> batch;
+    vector<char> failed; // batch index * links + link
+    batch.reserve(kBatch);
+
+    for (;;) {
+        batch.clear();
+        while (batch.size() < kBatch) {
+            auto doc = DocumentStorage::readDocumentRecord(in, malformed);
+            if (!doc) break;
+            batch.push_back(move(doc));
+        }
+        if (batch.empty()) break;
+
+        // Link by link rather than validate(), to know which links failed.
+        failed.assign(batch.size() * links, 0);
+        TaskGroup group;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            scheduler.spawn(group, [&, i] {
+                size_t j = 0;
+                for (Validator* link = chain.get(); link; link = link->nextLink(), ++j) {
+                    ErrorSet errors;
+                    link->validateLink(*batch[i], errors, &scheduler);
+                    failed[i * links + j] = !errors.empty();
+                }
+            });
+        }
+        scheduler.wait(group);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const char* row = failed.data() + i * links;
+            stats.add(*batch[i], find(row, row + links, 1) != row + links);
+            for (size_t j = 0; j < links; ++j) {
+                if (row[j]) stats.addLinkFailure(j);
+            }
+        }
+    }
+    return true;
+}
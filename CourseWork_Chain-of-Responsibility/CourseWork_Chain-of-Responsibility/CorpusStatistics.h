@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "Document.h"
+#include "Validator.h"
+#include "KllSketch.h"
+
+struct MalformedRecord;
+
+// Corpus-level facts gathered in one streaming pass: exact counters for
+// formats, signatures and errors (per DocumentError category and per chain
+// link), and a KLL sketch for the content sizes. Memory depends on the
+// number of distinct formats and links, not on the number of documents.
+class CorpusStatistics {
+public:
+    // Chain links in order, as named by linkLabel(), and the error
+    // categories the chain checks; set once per pass.
+    void setLinks(std::vector<std::string> names, const ErrorPolicy& policy);
+    const std::vector<std::string>& links() const { return linkNames; }
+
+    // `invalid`: the chain reported any error for the document.
+    void add(const Document& doc, bool invalid);
+    void addLinkFailure(size_t link) { ++linkFailures[link]; }
+
+    uint64_t documents() const { return total; }
+    uint64_t signedDocuments() const { return signedCount; }
+    uint64_t invalidDocuments() const { return invalidCount; }
+    uint64_t contentBytes() const { return bytes; }
+    uint64_t errorCategory(int bit) const { return categories[bit]; }
+    uint64_t linkFailureCount(size_t link) const { return linkFailures[link]; }
+    // Most frequent first, ties by name.
+    std::vector<std::pair<std::string, uint64_t>> formats() const;
+    const KllSketch& sizes() const { return sizeSketch; }
+
+private:
+    uint64_t total = 0;
+    uint64_t signedCount = 0;
+    uint64_t invalidCount = 0;
+    uint64_t bytes = 0;
+    uint64_t categories[DocumentErrorCount] = {};
+    ErrorPolicy errorPolicy;
+    std::map<std::string, uint64_t> formatCounts;
+    std::vector<std::string> linkNames;
+    std::vector<uint64_t> linkFailures;
+    KllSketch sizeSketch;
+};
+
+// Streams a documents file record by record, validates each batch on the
+// shared scheduler link by link, and adds it to `stats`; nothing but the
+// current batch is held in memory. False if the file cannot be opened.
+bool collectFileStatistics(const std::string& path, const std::shared_ptr<Validator>& chain,
+    CorpusStatistics& stats, std::vector<MalformedRecord>* malformed = nullptr);
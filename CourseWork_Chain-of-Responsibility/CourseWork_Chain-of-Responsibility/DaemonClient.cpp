@@ -0,0 +1,235 @@
+#include "DaemonClient.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+using namespace daemon_protocol;
+
+DaemonClient::~DaemonClient() {
+    if (fd >= 0) close(fd);
+}
+
+bool DaemonClient::fail(const string& message) {
+    lastError = message;
+    return false;
+}
+
+bool DaemonClient::connect(const string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        return fail("Недопустимий шлях сокета: " + socketPath);
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    if (fd >= 0) close(fd);
+    received.clear();
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return fail(string("socket: ") + strerror(errno));
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        string message = string("connect: ") + strerror(errno);
+        close(fd);
+        fd = -1;
+        return fail(message);
+    }
+    return true;
+}
+
+bool DaemonClient::call(Opcode opcode, const FrameWriter& body) {
+    if (fd < 0) return fail("Немає з'єднання з демоном");
+
+    const uint32_t tag = ++nextTag;
+    FrameWriter request;
+    request.u8(opcode);
+    request.u32(tag);
+    request.append(body);
+    const string framed = request.finish();
+
+    for (size_t sent = 0; sent < framed.size();) {
+        ssize_t n = send(fd, framed.data() + sent, framed.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return fail(string("send: ") + strerror(errno));
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    size_t frameSize;
+    while ((frameSize = completeFrame(received.data(), received.size())) == 0) {
+        char buffer[64 * 1024];
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n == 0) return fail("Демон закрив з'єднання");
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return fail(string("read: ") + strerror(errno));
+        }
+        received.append(buffer, static_cast<size_t>(n));
+    }
+    if (frameSize == SIZE_MAX) return fail("Завелика відповідь демона");
+
+    FrameReader header(received.data() + 4, frameSize - 4);
+    uint8_t status = 0;
+    uint32_t answeredTag = 0;
+    header.u8(status);
+    if (!header.u32(answeredTag) || answeredTag != tag) return fail("Відповідь не на цей запит");
+    response.assign(received, 9, frameSize - 9);
+    received.erase(0, frameSize);
+
+    if (status != StatusOk) {
+        string message;
+        FrameReader(response.data(), response.size()).str(message);
+        return fail("Демон відхилив запит: " + message);
+    }
+    return true;
+}
+
+namespace {
+    FrameWriter idList(const vector<DocumentId>& ids) {
+        FrameWriter body;
+        body.u32(static_cast<uint32_t>(ids.size()));
+        for (DocumentId id : ids) body.u64(id);
+        return body;
+    }
+
+    bool readErrors(FrameReader& in, ErrorSet& errors) {
+        uint32_t count = 0;
+        if (!in.u32(count)) return false;
+        errors.resize(count);
+        for (auto& error : errors) {
+            if (!in.str(error)) return false;
+        }
+        return true;
+    }
+
+    bool readFlags(FrameReader& in, size_t count, vector<bool>& flags) {
+        flags.assign(count, false);
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t flag = 0;
+            if (!in.u8(flag)) return false;
+            flags[i] = flag != 0;
+        }
+        return true;
+    }
+}
+
+bool DaemonClient::readVerdicts(vector<Verdict>& results) {
+    FrameReader in(response.data(), response.size());
+    for (auto& result : results) {
+        uint8_t status = 0;
+        if (!in.u8(status) || status > ItemNotValidated || !readErrors(in, result.errors)) {
+            return fail("Обрізана відповідь демона");
+        }
+        result.status = static_cast<ItemStatus>(status);
+    }
+    return true;
+}
+
+bool DaemonClient::validate(const vector<DocumentId>& ids, vector<Verdict>& results, uint32_t timeoutMs) {
+    FrameWriter body;
+    body.u32(timeoutMs);
+    body.append(idList(ids));
+    if (!call(OpValidate, body)) return false;
+    results.assign(ids.size(), Verdict{});
+    return readVerdicts(results);
+}
+
+bool DaemonClient::validateDocuments(const vector<Document>& docs, vector<Verdict>& results, uint32_t timeoutMs) {
+    FrameWriter body;
+    body.u32(timeoutMs);
+    body.u32(static_cast<uint32_t>(docs.size()));
+    for (const auto& doc : docs) body.document(doc);
+    if (!call(OpValidateDocument, body)) return false;
+    results.assign(docs.size(), Verdict{});
+    return readVerdicts(results);
+}
+
+bool DaemonClient::add(const vector<Document>& docs, vector<DocumentId>& ids) {
+    FrameWriter body;
+    body.u32(static_cast<uint32_t>(docs.size()));
+    for (const auto& doc : docs) body.document(doc);
+    if (!call(OpAdd, body)) return false;
+
+    FrameReader in(response.data(), response.size());
+    ids.assign(docs.size(), 0);
+    for (auto& id : ids) {
+        if (!in.u64(id)) return fail("Обрізана відповідь демона");
+    }
+    return true;
+}
+
+bool DaemonClient::edit(const vector<pair<DocumentId, DocumentPatch>>& patches, vector<bool>& done) {
+    FrameWriter body;
+    body.u32(static_cast<uint32_t>(patches.size()));
+    for (const auto& [id, patch] : patches) body.patch(id, patch);
+    if (!call(OpEdit, body)) return false;
+
+    FrameReader in(response.data(), response.size());
+    return readFlags(in, patches.size(), done) || fail("Обрізана відповідь демона");
+}
+
+bool DaemonClient::remove(const vector<DocumentId>& ids, vector<bool>& done) {
+    if (!call(OpRemove, idList(ids))) return false;
+    FrameReader in(response.data(), response.size());
+    return readFlags(in, ids.size(), done) || fail("Обрізана відповідь демона");
+}
+
+bool DaemonClient::query(unsigned errorMask, uint32_t limit, vector<DocumentId>& ids, DocumentId after) {
+    FrameWriter body;
+    body.u32(errorMask);
+    body.u32(limit);
+    body.u64(after);
+    if (!call(OpQuery, body)) return false;
+
+    FrameReader in(response.data(), response.size());
+    uint32_t count = 0;
+    if (!in.u32(count) || count > response.size() / 8) return fail("Обрізана відповідь демона");
+    ids.assign(count, 0);
+    for (auto& id : ids) {
+        if (!in.u64(id)) return fail("Обрізана відповідь демона");
+    }
+    return true;
+}
+
+bool DaemonClient::get(const vector<DocumentId>& ids, vector<optional<Document>>& docs) {
+    docs.assign(ids.size(), nullopt);
+    // Documents left out to keep an answer within a frame are asked for
+    // again, until a batch brings none of them.
+    vector<size_t> pending(ids.size());
+    for (size_t i = 0; i < pending.size(); ++i) pending[i] = i;
+    while (!pending.empty()) {
+        vector<DocumentId> batch;
+        batch.reserve(pending.size());
+        for (size_t i : pending) batch.push_back(ids[i]);
+        if (!call(OpGet, idList(batch))) return false;
+
+        FrameReader in(response.data(), response.size());
+        vector<size_t> omitted;
+        for (size_t i : pending) {
+            uint8_t status = 0;
+            if (!in.u8(status) || status > GetOmitted) return fail("Обрізана відповідь демона");
+            if (status == GetOmitted) omitted.push_back(i);
+            if (status != GetFound) continue;
+            Document doc("", false, "");
+            if (!in.document(doc)) return fail("Обрізана відповідь демона");
+            docs[i] = move(doc);
+        }
+        if (omitted.size() == pending.size()) return fail("Документ не вміщається у відповідь демона");
+        pending = move(omitted);
+    }
+    return true;
+}
+
+bool DaemonClient::save(const string& filename, bool& saved) {
+    FrameWriter body;
+    body.str(filename);
+    if (!call(OpSave, body)) return false;
+
+    FrameReader in(response.data(), response.size());
+    uint8_t flag = 0;
+    if (!in.u8(flag)) return fail("Обрізана відповідь демона");
+    saved = flag != 0;
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include "DaemonProtocol.h"
+
+// Blocking client for ValidationDaemon. Each call sends one batch and
+// waits for its answer; on false, error() says why (a refused request,
+// or a broken connection, after which the client has to reconnect).
+class DaemonClient {
+public:
+    DaemonClient() = default;
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    bool connect(const std::string& socketPath);
+    const std::string& error() const { return lastError; }
+
+    struct Verdict {
+        daemon_protocol::ItemStatus status = daemon_protocol::ItemNotFound;
+        ErrorSet errors;
+    };
+
+    // A timeout (0 = none) bounds the whole batch; see DaemonProtocol.h.
+    bool validate(const std::vector<DocumentId>& ids, std::vector<Verdict>& results, uint32_t timeoutMs = 0);
+    bool validateDocuments(const std::vector<Document>& docs, std::vector<Verdict>& results, uint32_t timeoutMs = 0);
+    // ID 0 marks a document the store refused.
+    bool add(const std::vector<Document>& docs, std::vector<DocumentId>& ids);
+    bool edit(const std::vector<std::pair<DocumentId, DocumentPatch>>& patches, std::vector<bool>& done);
+    bool remove(const std::vector<DocumentId>& ids, std::vector<bool>& done);
+    // Mask 0 lists every document. The daemon lists at most kMaxQueryIds,
+    // also for limit 0. Only IDs above `after` are listed, so a page's last
+    // ID fetches the next page.
+    bool query(unsigned errorMask, uint32_t limit, std::vector<DocumentId>& ids, DocumentId after = 0);
+    // nullopt for an ID that does not exist. Documents the daemon leaves
+    // out of a full answer are fetched in follow-up calls; fails if one
+    // alone does not fit in a frame.
+    bool get(const std::vector<DocumentId>& ids, std::vector<std::optional<Document>>& docs);
+    // "" saves to the daemon's documents.txt.
+    bool save(const std::string& filename, bool& saved);
+
+private:
+    int fd = -1;
+    uint32_t nextTag = 0;
+    std::string received; // bytes read past the last answered frame
+    std::string response; // payload of the last answer, status and tag stripped
+    std::string lastError;
+
+    // Sends `opcode` with `body` and leaves the answer's body in `response`.
+    bool call(daemon_protocol::Opcode opcode, const daemon_protocol::FrameWriter& body);
+    bool fail(const std::string& message);
+    bool readVerdicts(std::vector<Verdict>& results);
+};
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstdlib>
+#include <csignal>
+#include <pthread.h>
+#include "DocumentStorage.h"
+#include "ShardedDocumentStorage.h"
+#include "ValidationRules.h"
+#include "ValidationDaemon.h"
+
+using namespace std;
+
+// Keeps the store and the validator chain warm between requests:
+//   document_daemon [--socket validator.sock] [--documents documents.txt]
+//                   [--rules rules.txt] [--shards <dir>] [--memory-budget <MiB>]
+// Stop it with SIGINT or SIGTERM; nothing is saved unless a client asks.
+int main(int argc, char* argv[]) {
+    // Before any thread exists, so the scheduler's workers inherit the mask
+    // and the signals reach the daemon's signalfd only.
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    string socketPath = "validator.sock";
+    string documentsFile = "documents.txt";
+    string rulesFile = "rules.txt";
+    string shardDirectory;
+    size_t memoryBudget = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        }
+        else if (arg == "--documents" && i + 1 < argc) {
+            documentsFile = argv[++i];
+        }
+        else if (arg == "--rules" && i + 1 < argc) {
+            rulesFile = argv[++i];
+        }
+        else if (arg == "--shards" && i + 1 < argc) {
+            shardDirectory = argv[++i];
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            memoryBudget = static_cast<size_t>(strtoull(argv[++i], nullptr, 10)) * 1024 * 1024;
+        }
+        else {
+            cerr << "Невідомий аргумент: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    unique_ptr<DocumentStore> store;
+    if (shardDirectory.empty()) {
+        store = make_unique<DocumentStorage>();
+    }
+    else {
+        auto sharded = make_unique<ShardedDocumentStorage>(shardDirectory);
+        if (!sharded->isOpen()) {
+            cerr << "Не вдалося відкрити каталог шардів: " << shardDirectory << "\n";
+            return 1;
+        }
+        store = move(sharded);
+    }
+    store->setMemoryBudget(memoryBudget);
+
+    ValidationRules rules;
+    string error;
+    if (loadValidationRules(rulesFile, rules, error)) {
+        store->setValidatorChain(buildValidatorChain(rules));
+    }
+    else {
+        if (ifstream(rulesFile).good()) {
+            cerr << "Помилка у файлі правил: " << error << "\n";
+            return 1;
+        }
+        store->setValidatorChain(buildDefaultValidatorChain());
+    }
+
+    // A sharded store already holds its documents; loading the file would
+    // import it again.
+    if (shardDirectory.empty() && ifstream(documentsFile).good()) {
+        vector<MalformedRecord> malformed;
+        store->loadDocumentsFromFile(documentsFile, &malformed);
+        if (!malformed.empty()) {
+            cerr << "Пропущено пошкоджених записів: " << malformed.size() << "\n";
+        }
+    }
+    cerr << "Документів: " << store->size() << "\n";
+
+    ValidationDaemon daemon(*store);
+    if (!daemon.listen(socketPath, error)) {
+        cerr << "Не вдалося відкрити сокет: " << error << "\n";
+        return 1;
+    }
+    cerr << "Демон слухає " << socketPath << "\n";
+    if (!daemon.run(error)) {
+        cerr << "Помилка циклу подій: " << error << "\n";
+        return 1;
+    }
+    cerr << "Зупинено. З'єднань: " << daemon.connectionsAccepted()
+        << ", запитів: " << daemon.requestsServed() << "\n";
+    return 0;
+}
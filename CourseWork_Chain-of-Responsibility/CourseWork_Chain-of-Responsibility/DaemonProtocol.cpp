@@ -0,0 +1,134 @@
+#include "DaemonProtocol.h"
+#include <cstring>
+
+using namespace std;
+
+namespace daemon_protocol {
+    void FrameWriter::u32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) u8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void FrameWriter::u64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) u8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void FrameWriter::str(const string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        bytes += value;
+    }
+
+    void FrameWriter::document(const Document& doc) {
+        u64(doc.id);
+        string scratch;
+        str(doc.content.text(scratch));
+        u8(doc.isSigned ? 1 : 0);
+        str(doc.format);
+        str(doc.signature);
+    }
+
+    size_t documentBytes(const Document& doc) {
+        return 8 + 4 + doc.content.length() + 1 + 4 + doc.format.size() + 4 + doc.signature.size();
+    }
+
+    void FrameWriter::patch(DocumentId id, const DocumentPatch& patch) {
+        u64(id);
+        u8((patch.content ? PatchContent : 0) | (patch.isSigned ? PatchSigned : 0) |
+            (patch.format ? PatchFormat : 0) | (patch.signature ? PatchSignature : 0));
+        if (patch.content) str(*patch.content);
+        if (patch.isSigned) u8(*patch.isSigned ? 1 : 0);
+        if (patch.format) str(*patch.format);
+        if (patch.signature) str(*patch.signature);
+    }
+
+    string FrameWriter::finish() const {
+        FrameWriter framed;
+        framed.bytes.reserve(4 + bytes.size());
+        framed.u32(static_cast<uint32_t>(bytes.size()));
+        framed.bytes += bytes;
+        return move(framed.bytes);
+    }
+
+    bool FrameReader::take(void* out, size_t size) {
+        if (static_cast<size_t>(end - pos) < size) {
+            pos = end; // stays failed
+            return false;
+        }
+        memcpy(out, pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool FrameReader::u8(uint8_t& value) {
+        return take(&value, 1);
+    }
+
+    bool FrameReader::u32(uint32_t& value) {
+        unsigned char raw[4];
+        if (!take(raw, sizeof(raw))) return false;
+        value = 0;
+        for (int i = 3; i >= 0; --i) value = value << 8 | raw[i];
+        return true;
+    }
+
+    bool FrameReader::u64(uint64_t& value) {
+        unsigned char raw[8];
+        if (!take(raw, sizeof(raw))) return false;
+        value = 0;
+        for (int i = 7; i >= 0; --i) value = value << 8 | raw[i];
+        return true;
+    }
+
+    bool FrameReader::str(string& value) {
+        uint32_t size = 0;
+        if (!u32(size) || static_cast<size_t>(end - pos) < size) {
+            pos = end;
+            return false;
+        }
+        value.assign(pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool FrameReader::document(Document& doc) {
+        uint64_t id = 0;
+        string content, format, signature;
+        uint8_t isSigned = 0;
+        if (!u64(id) || !str(content) || !u8(isSigned) || !str(format) || !str(signature)) return false;
+        doc = Document(move(content), isSigned != 0, move(format));
+        doc.id = id;
+        doc.signature = move(signature);
+        return true;
+    }
+
+    bool FrameReader::patch(DocumentId& id, DocumentPatch& patch) {
+        uint8_t fields = 0;
+        if (!u64(id) || !u8(fields)) return false;
+        string text;
+        uint8_t flag = 0;
+        if (fields & PatchContent) {
+            if (!str(text)) return false;
+            patch.content = move(text);
+        }
+        if (fields & PatchSigned) {
+            if (!u8(flag)) return false;
+            patch.isSigned = flag != 0;
+        }
+        if (fields & PatchFormat) {
+            if (!str(text)) return false;
+            patch.format = move(text);
+        }
+        if (fields & PatchSignature) {
+            if (!str(text)) return false;
+            patch.signature = move(text);
+        }
+        return true;
+    }
+
+    size_t completeFrame(const char* data, size_t size) {
+        if (size < 4) return 0;
+        uint32_t length = 0;
+        FrameReader(data, 4).u32(length);
+        if (length > kMaxFrameBytes) return SIZE_MAX;
+        return size - 4 >= length ? 4 + static_cast<size_t>(length) : 0;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Document.h"
+#include "DocumentStore.h"
+
+// Binary framing between the validation daemon and its clients. Every
+// message is a frame: u32 payload length, then the payload. All integers
+// are little-endian; a string is a u32 length plus its bytes.
+//
+// Request payload:  u8 opcode, u32 tag, body
+// Response payload: u8 status, u32 tag (echoed), body; a StatusBadRequest
+//                   body is a string saying what was wrong
+//
+// Request and response bodies, one entry per item of the batch:
+//   Validate    u32 timeoutMs, u32 n, n x u64 id -> n x (u8 item, u32 k, k x string error)
+//   ValidateDoc u32 timeoutMs, u32 n, n x document -> n x (u8 item, u32 k, k x string error)
+//   Add         u32 n, n x document        -> n x u64 id (0 = refused)
+//   Edit        u32 n, n x patch           -> n x u8 done
+//   Remove      u32 n, n x u64 id          -> n x u8 done
+//   Query       u32 errorMask, u32 limit, u64 after -> u32 n, n x u64 id
+//   Get         u32 n, n x u64 id          -> n x (u8 GetStatus, [document])
+//   Save        string filename ("" = documents.txt) -> u8 done
+//
+// document: u64 id, string content, u8 signed, string format, string signature
+// patch:    u64 id, u8 fields (PatchContent | ...), then the present fields
+//           in that order
+// A Query mask of 0 matches every document (see DocumentError); it lists
+// IDs above `after` in order, so the last ID of a page fetches the next.
+// timeoutMs (0 = none) bounds the batch: items not validated by then come
+// back as ItemNotValidated with no errors. In a large Validate batch that
+// also covers IDs that turn out not to exist, since the run stopped first.
+//
+// No answer is longer than kMaxFrameBytes: Query lists at most kMaxQueryIds
+// (limit 0 included), and a batch item that would not fit comes back as
+// ItemNotValidated (Validate, ValidateDoc) or GetOmitted (Get), to be asked
+// for again in a smaller batch.
+namespace daemon_protocol {
+    enum Opcode : uint8_t {
+        OpValidate = 1,
+        OpValidateDocument = 2,
+        OpAdd = 3,
+        OpEdit = 4,
+        OpRemove = 5,
+        OpQuery = 6,
+        OpGet = 7,
+        OpSave = 8,
+    };
+
+    enum Status : uint8_t {
+        StatusOk = 0,
+        StatusBadRequest = 1, // malformed body or unknown opcode
+    };
+
+    enum ItemStatus : uint8_t {
+        ItemNotFound = 0,
+        ItemValidated = 1,
+        ItemNotValidated = 2, // the request's timeout passed first
+    };
+
+    enum GetStatus : uint8_t {
+        GetNotFound = 0,
+        GetFound = 1,     // the document follows
+        GetOmitted = 2,   // did not fit in the answer
+    };
+
+    enum PatchField : uint8_t {
+        PatchContent = 1,
+        PatchSigned = 2,
+        PatchFormat = 4,
+        PatchSignature = 8,
+    };
+
+    // Frames above this are refused, so a bad length cannot make the
+    // daemon allocate gigabytes.
+    const uint32_t kMaxFrameBytes = 64u << 20;
+    // Most IDs in one Query answer (u32 count, 8 bytes each, plus status
+    // and tag).
+    const uint32_t kMaxQueryIds = (kMaxFrameBytes - 9) / 8;
+
+    // Bytes FrameWriter::document writes for `doc`.
+    size_t documentBytes(const Document& doc);
+
+    // Appends fields to a payload; finish() prefixes the length.
+    class FrameWriter {
+    public:
+        void u8(uint8_t value) { bytes.push_back(static_cast<char>(value)); }
+        void u32(uint32_t value);
+        void u64(uint64_t value);
+        void str(const std::string& value);
+        void document(const Document& doc);
+        void patch(DocumentId id, const DocumentPatch& patch);
+        void append(const FrameWriter& other) { bytes += other.bytes; }
+
+        std::string finish() const;
+        const std::string& payload() const { return bytes; }
+
+    private:
+        std::string bytes;
+    };
+
+    // Reads fields from a payload; every getter returns false, and leaves
+    // the reader failed, once the payload is exhausted.
+    class FrameReader {
+    public:
+        FrameReader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+        bool u8(uint8_t& value);
+        bool u32(uint32_t& value);
+        bool u64(uint64_t& value);
+        bool str(std::string& value);
+        bool document(Document& doc);
+        bool patch(DocumentId& id, DocumentPatch& patch);
+
+        bool atEnd() const { return pos == end; }
+
+    private:
+        const char* pos;
+        const char* end;
+
+        bool take(void* out, size_t size);
+    };
+
+    // Length of the complete frame at `data` (prefix included), 0 if more
+    // bytes are needed, SIZE_MAX if the length is over kMaxFrameBytes.
+    size_t completeFrame(const char* data, size_t size);
+}
@@ -0,0 +1,80 @@
+#include "DirectoryCrawler.h"
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <utility>
+#include "AsyncIO.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    string declaredFormat(const fs::path& path) {
+        string format = path.extension().string();
+        if (!format.empty() && format[0] == '.') format.erase(0, 1);
+        transform(format.begin(), format.end(), format.begin(), [](char c) {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        });
+        return format;
+    }
+}
+
+Task<CrawlResult> crawlDirectoryAsync(DocumentStore& store, string root, CrawlOptions options) {
+    CrawlResult result;
+    error_code ec;
+    if (!fs::is_directory(root, ec)) co_return result;
+    result.opened = true;
+
+    // Listed and sorted first, so documents get IDs in a stable order.
+    vector<fs::path> files;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        error_code entryError;
+        if (!it->is_regular_file(entryError)) continue;
+        uintmax_t size = it->file_size(entryError);
+        if (entryError || size > options.maxFileBytes) {
+            result.skipped.push_back(it->path().string() + ": " + (entryError ? "недоступний" : "завеликий"));
+            continue;
+        }
+        files.push_back(it->path());
+    }
+    if (ec) result.skipped.push_back(root + ": обхід перервано (" + ec.message() + ")");
+    sort(files.begin(), files.end());
+
+    deque<pair<size_t, IoOperation<optional<string>>>> inFlight;
+    size_t nextFile = 0;
+    const size_t limit = max<size_t>(options.maxInFlight, 1);
+    auto issueReads = [&] {
+        for (; inFlight.size() < limit && nextFile < files.size(); ++nextFile) {
+            inFlight.emplace_back(nextFile, readFileAsync(files[nextFile].string(), options.maxFileBytes));
+        }
+    };
+
+    issueReads();
+    while (!inFlight.empty()) {
+        optional<string> data = co_await inFlight.front().second;
+        const fs::path& path = files[inFlight.front().first];
+        inFlight.pop_front();
+        issueReads(); // keep the pool busy while this one is added
+
+        if (!data) {
+            result.skipped.push_back(path.string() + ": не вдалося прочитати");
+            continue;
+        }
+        const size_t rejected = store.rejectedByBudget();
+        if (store.add(Document(move(*data), false, declaredFormat(path))) != 0) {
+            ++result.added;
+        }
+        else if (store.rejectedByBudget() != rejected) {
+            result.budgetExceeded = true;
+            break;
+        }
+    }
+    // Reads still queued finish on their own; nothing awaits them.
+    co_return result;
+}
+
+CrawlResult crawlDirectory(DocumentStore& store, const string& root, CrawlOptions options) {
+    return syncWait(crawlDirectoryAsync(store, root, options));
+}
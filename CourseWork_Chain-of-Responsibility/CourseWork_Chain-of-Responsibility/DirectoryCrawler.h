@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "DocumentStore.h"
+#include "AsyncTask.h"
+
+struct CrawlOptions {
+    size_t maxInFlight = 8;          // file reads queued on the I/O pool at once
+    size_t maxFileBytes = 64 << 20;  // larger files are skipped
+};
+
+struct CrawlResult {
+    bool opened = false;             // the root is a directory
+    size_t added = 0;
+    bool budgetExceeded = false;     // stopped at the memory budget
+    std::vector<std::string> skipped; // "path: reason", in path order
+};
+
+// Ingests a directory tree of real files: every regular file below `root`
+// becomes an unsigned document with the file's bytes as content and its
+// lowercased extension as the declared format (so SniffedFormatValidator
+// and ErrorFormatMismatch can tell renamed files apart). Files are read
+// whole on the I/O pool, at most maxInFlight at a time, and added in path
+// order while the next reads are in flight. The store must not be used by
+// anything else until the task completes.
+Task<CrawlResult> crawlDirectoryAsync(DocumentStore& store, std::string root, CrawlOptions options = {});
+// Blocking wrapper.
+CrawlResult crawlDirectory(DocumentStore& store, const std::string& root, CrawlOptions options = {});
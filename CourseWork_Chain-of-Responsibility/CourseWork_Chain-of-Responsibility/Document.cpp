@@ -1,8 +1,45 @@
 #include "Document.h"
-
-int Document::nextId = 1;
+#include <utility>
+#include <algorithm>
 
 Document::Document(std::string c, bool s, std::string f) 
-    : content(c), isSigned(s), format(f) {
-    id = nextId++;
+    : content(std::move(c)), isSigned(s), format(std::move(f)) {}
+
+void ErrorPolicy::allowFormats(const std::vector<std::string>& allowed) {
+    if (!formats) {
+        formats = allowed;
+        return;
+    }
+    std::erase_if(*formats, [&](const std::string& f) {
+        return std::find(allowed.begin(), allowed.end(), f) == allowed.end();
+    });
+}
+
+// FNV-1a over the settings; the format list is sorted first, as its order
+// changes no flag.
+uint64_t ErrorPolicy::hash() const {
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](unsigned char c) { h = (h ^ c) * 1099511628211ull; };
+    mix(formatMismatch ? 1 : 0);
+    mix(formats ? 1 : 0);
+    if (formats) {
+        std::vector<std::string> sorted = *formats;
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto& f : sorted) {
+            for (unsigned char c : f) mix(c);
+            mix(0xFF);
+        }
+    }
+    return h;
+}
+
+unsigned detectErrors(const Document& doc, const ErrorPolicy& policy) {
+    unsigned flags = 0;
+    if (doc.content.empty()) flags |= ErrorEmptyContent;
+    if (!doc.isSigned) flags |= ErrorNotSigned;
+    if (policy.formats && std::find(policy.formats->begin(), policy.formats->end(), doc.format) == policy.formats->end()) {
+        flags |= ErrorInvalidFormat;
+    }
+    if (policy.formatMismatch && !formatMatches(doc.format, doc.content.sniffedFormat())) flags |= ErrorFormatMismatch;
+    return flags;
 }
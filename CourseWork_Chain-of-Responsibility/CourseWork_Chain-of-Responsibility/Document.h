@@ -1,19 +1,64 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "Content.h"
+
+// 0 means "not assigned yet"; DocumentStorage assigns IDs on add.
+using DocumentId = uint64_t;
 
 struct Document {
-    int id;
-    std::string content;
+    DocumentId id = 0;
+    Content content;
     bool isSigned;
     std::string format;
-    static int nextId;
+    // Hex HMAC-SHA-256 of the content, "" if the document carries none.
+    // Only HmacSignatureValidator checks it; isSigned is merely a claim.
+    std::string signature;
 
     Document(std::string c, bool s, std::string f);
 };
 
+// Error categories used by the filters and the on-disk index.
+enum DocumentError : unsigned {
+    ErrorEmptyContent = 1u << 0,
+    ErrorNotSigned = 1u << 1,
+    ErrorInvalidFormat = 1u << 2,
+    ErrorFormatMismatch = 1u << 3, // declared format contradicts the sniffed one
+};
+const int DocumentErrorCount = 4;
+const unsigned DocumentErrorAll = (1u << DocumentErrorCount) - 1;
+
+// Which categories detectErrors() reports: a store derives it from its
+// validator chain (errorPolicyOf), so the filters, the statistics and the
+// index only count what the active rules check.
+struct ErrorPolicy {
+    // Formats accepted by every format link; nullopt if no link checks the
+    // format, and then no document has ErrorInvalidFormat.
+    std::optional<std::vector<std::string>> formats;
+    bool formatMismatch = false; // only with the "sniff" link in the chain
+
+    // A format link accepting only `allowed`.
+    void allowFormats(const std::vector<std::string>& allowed);
+
+    // Stored in the index, which is stale once the policy changes.
+    uint64_t hash() const;
+};
+
+unsigned detectErrors(const Document& doc, const ErrorPolicy& policy);
+
 struct DocumentComparator {
+    using is_transparent = void; // allows set::find by ID
+
     bool operator()(const std::shared_ptr<Document>& a, const std::shared_ptr<Document>& b) const {
         return a->id < b->id;
     }
+    bool operator()(const std::shared_ptr<Document>& a, DocumentId id) const {
+        return a->id < id;
+    }
+    bool operator()(DocumentId id, const std::shared_ptr<Document>& b) const {
+        return id < b->id;
+    }
 };
@@ -0,0 +1,732 @@
+#include "DocumentConsole.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <sstream>
+#include <atomic>
+#include <csignal>
+#include "Console.h"
+#include "DocumentIndex.h"
+#include "FilterExpression.h"
+#include "DirectoryCrawler.h"
+
+using namespace std;
+
+namespace {
+    string formatBytes(size_t bytes) {
+        ostringstream out;
+        out << fixed << setprecision(1);
+        if (bytes < 1024) out << bytes << " Б";
+        else if (bytes < 1024 * 1024) out << bytes / 1024.0 << " КіБ";
+        else out << bytes / (1024.0 * 1024.0) << " МіБ";
+        return out.str();
+    }
+
+    // setw counts bytes, which misaligns Cyrillic; pad by code points.
+    string padRight(const string& text, size_t width) {
+        size_t chars = count_if(text.begin(), text.end(), [](char c) { return (c & 0xC0) != 0x80; });
+        return chars < width ? text + string(width - chars, ' ') : text;
+    }
+
+    // Token of the validation run Ctrl+C should stop, if one is running.
+    atomic<CancellationToken*> activeRun{ nullptr };
+
+    extern "C" void cancelActiveRun(int) {
+        signal(SIGINT, cancelActiveRun); // the MSVC runtime resets the handler
+        if (CancellationToken* token = activeRun.load()) token->cancel();
+    }
+
+    // Routes Ctrl+C to `token` while in scope.
+    class CancelOnInterrupt {
+    public:
+        explicit CancelOnInterrupt(CancellationToken& token) {
+            activeRun.store(&token);
+            previous = signal(SIGINT, cancelActiveRun);
+        }
+        ~CancelOnInterrupt() {
+            signal(SIGINT, previous);
+            activeRun.store(nullptr);
+        }
+        CancelOnInterrupt(const CancelOnInterrupt&) = delete;
+        CancelOnInterrupt& operator=(const CancelOnInterrupt&) = delete;
+
+    private:
+        void (*previous)(int);
+    };
+
+    void printStoppedRun(const ValidationProgress& progress, chrono::milliseconds timeLimit) {
+        if (progress.stopped == StopReason::Cancelled) cout << "Перевірку скасовано.";
+        else cout << "Перевірку зупинено: вичерпано ліміт часу " << timeLimit.count() << " мс.";
+        cout << " Перевірено документів: " << progress.validated << ".\n";
+        cout << "Не перевірено: ";
+        const size_t kShown = 10;
+        for (size_t i = 0; i < min(progress.interrupted.size(), kShown); ++i) {
+            cout << "ID " << progress.interrupted[i] << ", ";
+        }
+        if (progress.interrupted.size() > kShown) {
+            cout << "ще " << progress.interrupted.size() - kShown << " з поточного пакета, ";
+        }
+        cout << "усі документи з ID понад " << progress.resumeAfter << ".\n";
+    }
+
+    // Prompt after a page ending at `last`: false to stop, otherwise
+    // `after` is where the next page starts.
+    bool askNextPage(size_t page, DocumentId last, DocumentId& after) {
+        cout << "Сторінка " << page << ", останній ID " << last
+            << ". Enter - наступна, ID - продовжити після нього, 0 - досить: ";
+        string answer;
+        if (!getline(cin, answer) || answer == "0") return false;
+        after = last;
+        if (!answer.empty()) {
+            try {
+                size_t used = 0;
+                after = stoull(answer, &used);
+                if (used != answer.size()) after = last;
+            }
+            catch (...) {
+                cout << "Некоректний ID, показую наступну сторінку.\n";
+            }
+        }
+        return true;
+    }
+
+    void printDocumentListHeader() {
+        cout << "+----+--------------------------+--------+--------+\n";
+        cout << "| ID |          Зміст           | Підпис | Формат |\n";
+        cout << "+----+--------------------------+--------+--------+\n";
+    }
+
+    void printDocumentListRow(const Document& doc) {
+        string displayContent = doc.content.preview(26);
+        replace(displayContent.begin(), displayContent.end(), '\n', ' ');
+        if (displayContent.length() > 25) {
+            displayContent = displayContent.substr(0, 20) + "...";
+        }
+
+        cout << "| " << left << setw(2) << doc.id << " | "
+            << left << setw(25) << displayContent << "| "
+            << left << setw(6) << (doc.isSigned ? "Yes" : "No") << " | "
+            << left << setw(6) << doc.format << " |\n";
+    }
+
+    void printDocumentListFooter() {
+        cout << "+----+--------------------------+--------+--------+\n";
+    }
+
+    string percentOf(uint64_t part, uint64_t whole) {
+        ostringstream out;
+        out << part << " (" << fixed << setprecision(1)
+            << (whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0) << "%)";
+        return out.str();
+    }
+}
+
+DocumentConsole::DocumentConsole(DocumentStore& documentStorage)
+    : storage(documentStorage) {}
+
+void DocumentConsole::printErrorTableHeader(const string& header) {
+    cout << header << "\n";
+    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
+    cout << "| ID  | Content                 | Підпис | Формат | Проблеми                      |\n";
+    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
+}
+
+void DocumentConsole::printErrorTableRow(const Document& doc) {
+    string errorStr;
+    // Re-validating here to get the error strings is consistent.
+    ErrorSet errors;
+    if (storage.hasValidatorChain()) {
+        errors = storage.validate(doc);
+    } else {
+         // Fallback if no chain (shouldn't happen with correct usage)
+         if (doc.content.empty()) errors.push_back("- Вміст");
+         if (!doc.isSigned) errors.push_back("- Підпис");
+         if (doc.format != "txt" && doc.format != "pdf") errors.push_back("- Формат");
+         if (detectErrors(doc, storage.errorPolicy()) & ErrorFormatMismatch) errors.push_back("- Формат не відповідає вмісту");
+    }
+
+    for (const auto& err : errors) {
+        errorStr += err + "; ";
+    }
+
+    cout << "| " << left << setw(3) << doc.id << " | "
+        << left << setw(24) << (doc.content.length() > 22 ? doc.content.preview(19) + "..." : doc.content.str()) << "| "
+        << left << setw(7) << (doc.isSigned ? "Так" : "Ні") << "| "
+        << left << setw(7) << doc.format << "| "
+        << left << setw(30) << errorStr << "|\n";
+}
+
+void DocumentConsole::printErrorTableFooter() {
+    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
+}
+
+void DocumentConsole::showErrorFilterMenu() {
+    cout << "+-------------------------------------------------+\n";
+    cout << "|       Оберіть тип помилки для фільтрації:       |\n";
+    cout << "+-------------------------------------------------+\n";
+    cout << "| 1 | Документи без вмісту                        |\n";
+    cout << "| 2 | Документи без підпису                       |\n";
+    cout << "| 3 | Документи з недійсним форматом              |\n";
+    cout << "| 4 | Формат не відповідає вмісту                 |\n";
+    cout << "| 5 | Усі документи з будь-якими помилками        |\n";
+    cout << "| 0 | Повернутись до головного меню               |\n";
+    cout << "+-------------------------------------------------+\n";
+}
+
+void DocumentConsole::addDocumentManually() {
+    string content, formatInput;
+    bool signedFlag = false;
+
+    cout << "Введіть вміст документа. Введіть `::end` на окремому рядку, щоб завершити:\n";
+
+    // Clear input buffer if needed (simple approximation)
+    // cin.ignore(); // can be risky depending on previous input
+
+    while (true) {
+        string line;
+        getline(cin, line);
+        if (line == "::end") break;
+        content += line;
+        content += '\n';
+    }
+
+    string flagInput;
+    while (true) {
+        cout << "Документ підписано? (1 – так, 0 – ні): ";
+        getline(cin, flagInput);
+
+        if (flagInput == "1" || flagInput == "0") {
+            signedFlag = (flagInput == "1");
+            break;
+        }
+        else {
+            cout << "Некоректне значення. Введіть 1 або 0\n";
+        }
+    }
+
+    cout << "Введіть формат документа (txt/pdf): ";
+    getline(cin, formatInput);
+
+    const size_t rejected = storage.rejectedByBudget();
+    DocumentId id = storage.add(Document(move(content), signedFlag, move(formatInput)));
+    if (id == 0 && storage.rejectedByBudget() != rejected) {
+        cout << "Документ не додано: перевищено ліміт пам'яті\n";
+        return;
+    }
+
+    cout << "Документ успішно додано!\n";
+    logResult("Додано новий документ вручну (ID: " + to_string(id) + ")");
+}
+
+void DocumentConsole::deleteDocumentById(DocumentId targetId) {
+    if (storage.remove(targetId)) {
+        cout << "Документ з ID " << targetId << " успішно видалено!\n";
+    }
+    else {
+        cout << "\nДокумент з ID " << targetId << " не знайдено.\n";
+    }
+}
+
+void DocumentConsole::editDocumentById() {
+    DocumentId editId;
+    while (!getValidatedId("Введіть ID документа, який хочете редагувати: ", editId)) {}
+
+    auto doc = storage.find(editId);
+    if (!doc) {
+        cout << "Документ з таким ID не знайдено\n";
+        return;
+    }
+
+    string displayContent = doc->content.preview(23);
+    replace(displayContent.begin(), displayContent.end(), '\n', ' ');
+    if (displayContent.length() > 22)
+        displayContent = displayContent.substr(0, 19) + "...";
+
+    cout << "\n+-----+-------------------------+--------+--------+\n";
+    cout << "| ID  | Зміст                   | Підпис | Формат |\n";
+    cout << "+-----+-------------------------+--------+--------+\n";
+    cout << "| " << left << setw(3) << doc->id << " | "
+        << setw(25) << displayContent << "| "
+        << setw(7) << (doc->isSigned ? "Так" : "Ні") << "| "
+        << setw(7) << doc->format << " |\n";
+    cout << "+-----+-------------------------+--------+--------+\n";
+
+    cout << "+----+--------------------------------------------+\n";
+    cout << "|            Оберіть пункт редагування            |\n";
+    cout << "+----+--------------------------------------------+\n";
+    cout << "| 1  | Змінити вміст документа                    |\n";
+    cout << "| 2  | Змінити формат (txt/pdf)                   |\n";
+    cout << "| 3  | Змінити статус підпису                     |\n";
+    cout << "+----+--------------------------------------------+\n";
+
+    int choice;
+    while (!getValidatedInt("Ваш вибір: ", choice, 1, 3)) {}
+
+    bool updated = false;
+    switch (choice) {
+    case 1: {
+        cout << "Введіть новий вміст документа. Введіть `::end` на окремому рядку, щоб завершити:\n";
+        string newContent, line;
+        // cin.ignore(); // Carefully used in main logic
+        while (true) {
+            getline(cin, line);
+            if (line == "::end") break;
+            newContent += line;
+            newContent += '\n';
+        }
+        updated = storage.edit(editId, { move(newContent), nullopt, nullopt });
+        break;
+    }
+    case 2: {
+        cout << "Новий формат (txt/pdf): ";
+        string newFormat;
+        // cin.ignore();
+        getline(cin, newFormat);
+        updated = storage.edit(editId, { nullopt, nullopt, move(newFormat) });
+        break;
+    }
+    case 3: {
+        int flag;
+        while (!getValidatedInt("Новий статус (1 - підписано, 0 - не підписано): ", flag, 0, 1)) {}
+        updated = storage.edit(editId, { nullopt, flag == 1, nullopt });
+        break;
+    }
+    }
+
+    if (!updated) {
+        cout << "Документ не змінено: перевищено ліміт пам'яті\n";
+        return;
+    }
+    cout << "Документ оновлено!\n";
+    logResult("Документ з ID " + to_string(editId) + " відредаговано.");
+}
+
+bool DocumentConsole::printPages(const function<void()>& header, const DocumentVisitor& row,
+                                 const function<void()>& footer, const QueryPlan& plan) {
+    DocumentId after = 0;
+    size_t page = 1;
+    bool found = false;
+    for (;;) {
+        bool started = false;
+        PageCursor cursor = plan.forEachPage([&](const Document& doc) {
+            if (!started) header();
+            started = true;
+            row(doc);
+        }, after, pageSize);
+        if (!started) break; // a sharded walk can end on an empty page
+        found = true;
+        footer();
+        if (!cursor.more || !askNextPage(page++, cursor.last, after)) break;
+    }
+    return found;
+}
+
+void DocumentConsole::printAllDocuments() {
+    if (storage.empty()) {
+        cout << "Список документів порожній!\n";
+        return;
+    }
+
+    cout << "Список документів\n";
+    printPages(printDocumentListHeader, printDocumentListRow, printDocumentListFooter,
+        QueryPlan(storage, FilterExpression()));
+
+    cout << padRight("| Всього документів: " + to_string(storage.size()), 49) << " |\n";
+    cout << padRight("| Пам'ять: " + formatBytes(storage.memoryUsage().total()), 49) << " |\n";
+
+    cout << "+-------------------------------------------------+\n";
+}
+
+void DocumentConsole::searchDocumentsByText() {
+    cout << "Запит (слова, \"фраза\", префікс*): ";
+    string query;
+    if (!getline(cin, query)) return;
+
+    const auto started = chrono::steady_clock::now();
+    const vector<DocumentId> ids = storage.searchText(query);
+    const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    ostringstream elapsed;
+    elapsed << fixed << setprecision(1) << ms;
+    cout << "Знайдено документів: " << ids.size() << " (" << elapsed.str() << " мс)\n";
+    if (ids.empty()) return;
+
+    // Pages start after an ID, as in printPages, so a typed ID works here too.
+    const size_t rows = pageSize == 0 ? ids.size() : pageSize;
+    DocumentId after = 0;
+    size_t page = 1;
+    for (;;) {
+        auto first = upper_bound(ids.begin(), ids.end(), after);
+        if (first == ids.end()) break;
+        auto last = first + min<size_t>(rows, ids.end() - first);
+        printDocumentListHeader();
+        for (auto it = first; it != last; ++it) {
+            if (auto doc = storage.find(*it)) printDocumentListRow(*doc);
+        }
+        printDocumentListFooter();
+        if (last == ids.end() || !askNextPage(page++, *(last - 1), after)) break;
+    }
+}
+
+void DocumentConsole::verifyAllDocuments() {
+    cout << "Перевірка документів";
+    cout << "\n+-----+-------------------------+--------+--------+--------------------------------+\n";
+    cout << "| ID  | Content                 | Підпис | Формат | Статус перевірки               |\n";
+    cout << "+-----+-------------------------+--------+--------+--------------------------------+\n";
+
+    CancellationToken cancel;
+    CancelOnInterrupt interrupt(cancel);
+    const bool hasChain = storage.hasValidatorChain();
+    ValidationProgress progress = storage.validateEach([hasChain](const Document& doc, const ErrorSet& found) {
+        ErrorSet errors = found;
+        if (!hasChain) {
+            // Should prompt error if no chain
+            errors.push_back("SYSTEM ERROR: No validator chain");
+        }
+
+        string status;
+        if (errors.empty()) {
+            status = "+ Успішно перевірено";
+        } else {
+            for (const auto& err : errors) {
+                status += err + "; ";
+            }
+        }
+
+        string displayContent = doc.content.preview(24);
+        replace(displayContent.begin(), displayContent.end(), '\n', ' ');
+        if (displayContent.length() > 23) {
+            displayContent = displayContent.substr(0, 20) + "...";
+        }
+
+        cout << "| " << left << setw(3) << doc.id << " | "
+            << left << setw(24) << displayContent << "| "
+            << left << setw(7) << (doc.isSigned ? "Так" : "Ні") << "| "
+            << left << setw(7) << doc.format << "| "
+            << left << setw(31) << status << "|\n";
+    }, nullptr, runDeadline(cancel));
+
+    cout << "+-----+-------------------------+--------+--------+--------------------------------+\n";
+    if (!progress.complete()) printStoppedRun(progress, timeLimit);
+}
+
+ValidationDeadline DocumentConsole::runDeadline(const CancellationToken& cancel) const {
+    return timeLimit.count() > 0
+        ? ValidationDeadline::after(timeLimit, &cancel)
+        : ValidationDeadline::cancelledBy(cancel);
+}
+
+void DocumentConsole::printCorpusStatistics() {
+    CorpusStatistics stats;
+    CancellationToken cancel;
+    ValidationProgress progress;
+    {
+        CancelOnInterrupt interrupt(cancel);
+        progress = storage.collectStatistics(stats, runDeadline(cancel));
+    }
+    printStatistics(stats);
+    if (!progress.complete()) {
+        cout << "Статистика неповна.\n";
+        printStoppedRun(progress, timeLimit);
+    }
+}
+
+void DocumentConsole::printStatistics(const CorpusStatistics& stats) {
+    const uint64_t total = stats.documents();
+    auto row = [](const string& name, const string& value) {
+        cout << "| " << padRight(name, 24) << "| " << padRight(value, 22) << "|\n";
+    };
+    auto section = [](const string& title) {
+        cout << "+-------------------------+-----------------------+\n";
+        cout << "| " << padRight(title, 48) << "|\n";
+        cout << "+-------------------------+-----------------------+\n";
+    };
+
+    section("Статистика корпусу");
+    row("Документів", to_string(total));
+    row("Підписаних", percentOf(stats.signedDocuments(), total));
+    row("З помилками", percentOf(stats.invalidDocuments(), total));
+    row("Обсяг вмісту", formatBytes(stats.contentBytes()));
+
+    // The sketch's rank error is about 1% of the count; min and max are exact.
+    section("Розмір вмісту (±1% рангу)");
+    const KllSketch& sizes = stats.sizes();
+    const pair<const char*, double> quantiles[] = {
+        { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p99.9", 0.999 },
+    };
+    row("Мінімум", formatBytes(static_cast<size_t>(sizes.min())));
+    for (const auto& q : quantiles) {
+        row(q.first, formatBytes(static_cast<size_t>(sizes.quantile(q.second))));
+    }
+    row("Максимум", formatBytes(static_cast<size_t>(sizes.max())));
+    row("Середній", formatBytes(total ? static_cast<size_t>(stats.contentBytes() / total) : 0));
+
+    section("Формати");
+    const size_t kShownFormats = 20;
+    const auto formats = stats.formats();
+    uint64_t others = 0;
+    for (size_t i = 0; i < formats.size(); ++i) {
+        if (i < kShownFormats) {
+            string name = formats[i].first.empty() ? "(порожній)" : formats[i].first;
+            if (name.size() > 23) name = name.substr(0, 20) + "...";
+            row(name, percentOf(formats[i].second, total));
+        }
+        else {
+            others += formats[i].second;
+        }
+    }
+    if (formats.size() > kShownFormats) {
+        row("Інші (" + to_string(formats.size() - kShownFormats) + ")", percentOf(others, total));
+    }
+
+    section("Помилки за категоріями");
+    // In DocumentError bit order.
+    const char* const categories[DocumentErrorCount] = {
+        "Порожній вміст", "Без підпису", "Невірний формат", "Формат не збігається",
+    };
+    for (int bit = 0; bit < DocumentErrorCount; ++bit) {
+        row(categories[bit], percentOf(stats.errorCategory(bit), total));
+    }
+
+    section("Відмови за валідаторами");
+    for (size_t i = 0; i < stats.links().size(); ++i) {
+        string name = stats.links()[i];
+        if (name.size() > 23) name = name.substr(0, 20) + "...";
+        row(name, percentOf(stats.linkFailureCount(i), total));
+    }
+    cout << "+-------------------------+-----------------------+\n";
+}
+
+void DocumentConsole::traceAllDocuments(const string& tracePath) {
+    auto trace = make_shared<ValidationTrace>();
+    storage.setTrace(trace);
+    verifyAllDocuments();
+    storage.setTrace(nullptr);
+
+    cout << "Найповільніші документи (усього перевірено: " << trace->documentCount() << ")";
+    cout << "\n+-----+------------+-------------+------------------+-------------+\n";
+    cout << "| ID  | Розмір, Б  | Усього, мкс | Валідатор        | Його, мкс   |\n";
+    cout << "+-----+------------+-------------+------------------+-------------+\n";
+    for (const auto& slow : trace->slowest()) {
+        cout << "| " << left << setw(3) << slow.id << " | "
+            << right << setw(10) << slow.bytes << " | "
+            << fixed << setprecision(1)
+            << setw(11) << slow.totalNanoseconds / 1000.0 << " | "
+            << left << setw(16) << slow.slowestValidator << " | "
+            << right << setw(11) << slow.slowestNanoseconds / 1000.0 << " |\n";
+    }
+    cout << defaultfloat << left << "+-----+------------+-------------+------------------+-------------+\n";
+
+    if (trace->writeChromeTrace(tracePath)) {
+        cout << "Трасу збережено у " << tracePath << " (chrome://tracing, Perfetto)\n";
+    }
+    else {
+        cerr << "Не вдалося записати " << tracePath << "\n";
+    }
+}
+
+void DocumentConsole::printMemoryUsage() {
+    MemoryUsage usage = storage.memoryUsage();
+    const pair<const char*, size_t> rows[] = {
+        { "Документи", usage.documents },
+        { "Вміст", usage.content },
+        { "Формати й підписи", usage.formats },
+        { "Вузли контейнерів", usage.nodes },
+        { "Блоки shared_ptr", usage.controlBlocks },
+        { "Кеші перевірок", usage.caches },
+        { "Текстовий індекс", usage.indexes },
+        { "Усього", usage.total() },
+    };
+
+    cout << "+-------------------------+-----------------------+\n";
+    cout << "| Використання пам'яті    |                       |\n";
+    cout << "+-------------------------+-----------------------+\n";
+    for (const auto& row : rows) {
+        cout << "| " << padRight(row.first, 24) << "| " << padRight(formatBytes(row.second), 22) << "|\n";
+    }
+    cout << "+-------------------------+-----------------------+\n";
+    if (storage.memoryBudget() > 0) {
+        cout << "Ліміт: " << formatBytes(storage.memoryBudget())
+            << ", відхилено документів: " << storage.rejectedByBudget() << "\n";
+    }
+}
+
+void DocumentConsole::clearAllDocuments() {
+    char confirm;
+    cout << "Увага! Ви впевнені, що хочете видалити всі документи? (y/n): ";
+    cin >> confirm;
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    if (confirm == 'y' || confirm == 'Y') {
+        storage.clear();
+        cout << "Усі документи успішно видалено.\n";
+        logResult("Користувач видалив усі документи.");
+    }
+    else {
+        cout << "Очищення скасовано.\n";
+    }
+}
+
+void DocumentConsole::saveDocumentsToFile(const string& filename) {
+    if (storage.saveDocumentsToFile(filename)) {
+        cout << "Документи збережено!" << endl;
+    }
+    else {
+        cerr << "Не вдалося відкрити файл для запису.\n";
+    }
+}
+
+void DocumentConsole::loadDocumentsFromFile(const string& filename) {
+    const size_t rejected = storage.rejectedByBudget();
+    vector<MalformedRecord> malformed;
+    if (storage.loadDocumentsFromFile(filename, &malformed)) {
+        cout << "Документи завантажено!" << endl;
+        if (storage.rejectedByBudget() != rejected) {
+            cout << "Завантаження зупинено: перевищено ліміт пам'яті\n";
+        }
+        if (!malformed.empty()) {
+            const size_t kShown = 10;
+            cout << "Пропущено пошкоджених записів: " << malformed.size() << "\n";
+            for (size_t i = 0; i < malformed.size() && i < kShown; ++i) {
+                cout << "  байт " << malformed[i].offset << ": " << malformed[i].reason << "\n";
+            }
+            if (malformed.size() > kShown) cout << "  ...\n";
+        }
+    }
+    else {
+        cerr << "Файл документів не знайдено.\n";
+    }
+}
+
+void DocumentConsole::importDirectory(const string& root) {
+    CrawlResult result = crawlDirectory(storage, root);
+    if (!result.opened) {
+        cerr << "Каталог не знайдено: " << root << "\n";
+        return;
+    }
+
+    cout << "Імпортовано файлів: " << result.added << "\n";
+    if (result.budgetExceeded) {
+        cout << "Імпорт зупинено: перевищено ліміт пам'яті\n";
+    }
+    if (!result.skipped.empty()) {
+        const size_t kShown = 10;
+        cout << "Пропущено: " << result.skipped.size() << "\n";
+        for (size_t i = 0; i < result.skipped.size() && i < kShown; ++i) {
+            cout << "  " << result.skipped[i] << "\n";
+        }
+        if (result.skipped.size() > kShown) cout << "  ...\n";
+    }
+}
+
+void DocumentConsole::handleErrorSearch(int option) {
+    // The menu filters are predefined filter expressions; the error
+    // categories come from direct property checks (detectErrors), since
+    // the validators only append strings, which are hard to parse back.
+    struct Preset {
+        const char* title;
+        const char* query;
+    };
+    static const Preset presets[] = {
+        { "Вміст", "error = empty_content" },
+        { "Підпис", "error = not_signed" },
+        { "Формат", "error = invalid_format" },
+        { "Формат не відповідає вмісту", "error = format_mismatch" },
+        { "Всі", "invalid" },
+    };
+    if (option < 1 || option > 5) {
+        cout << "Невірний вибір фільтра!\n";
+        return;
+    }
+
+    const Preset& preset = presets[option - 1];
+    printFilteredDocuments(string("Документи з помилками: ") + preset.title,
+        QueryPlan(storage, *FilterExpression::parse(preset.query)));
+}
+
+void DocumentConsole::findInvalidDocumentsByError(const string& errorType) {
+    // errorType is an error category of the filter language, such as
+    // "empty_content" or "not_signed".
+    string error;
+    auto filter = FilterExpression::parse("error = " + errorType, &error);
+    if (!filter) {
+        cout << "Невідомий тип помилки: " << errorType << "\n";
+        return;
+    }
+    QueryPlan(storage, *filter).forEach([&errorType](const Document& doc) {
+        cout << "Знайдено документ з помилкою " << errorType << ". (ID: " << doc.id << ")\n";
+    });
+}
+
+bool DocumentConsole::printFilteredDocuments(const string& header, const QueryPlan& plan) {
+    bool found = printPages([&] { printErrorTableHeader(header); },
+        [this](const Document& doc) { printErrorTableRow(doc); },
+        [this] { printErrorTableFooter(); },
+        plan);
+
+    if (!found) {
+        cout << "Документів за вибраним критерієм не знайдено\n";
+    }
+    return found;
+}
+
+void DocumentConsole::queryDocuments() {
+    cout << "Фільтр (напр. unsigned AND format=docx AND length > 1MB AND id in [1000, 5000]): ";
+    string text;
+    if (!getline(cin, text)) return;
+
+    string error;
+    auto filter = FilterExpression::parse(text, &error);
+    if (!filter) {
+        cout << "Помилка в запиті, " << error << "\n";
+        return;
+    }
+
+    QueryPlan plan(storage, *filter);
+    cout << "План: " << plan.describe() << "\n";
+    printFilteredDocuments("Документи за запитом: " + filter->text(), plan);
+}
+
+void DocumentConsole::queryIndexWithoutLoading(const string& filename) {
+    DocumentIndex index;
+    if (!index.open(filename, storage.errorPolicy())) {
+        cout << "Індекс не знайдено або він застарів. Збережіть документи у файл.\n";
+        return;
+    }
+
+    cout << "Документів в індексі: " << index.size() << "\n";
+    for (const auto& f : index.formatHistogram()) {
+        cout << "  " << f.first << ": " << f.second << "\n";
+    }
+
+    showErrorFilterMenu();
+    int option = getValidatedMenuChoice("Ваш вибір: ", 0, 5);
+    if (option != 0) {
+        const unsigned masks[] = { 0, ErrorEmptyContent, ErrorNotSigned, ErrorInvalidFormat,
+                                   ErrorFormatMismatch, DocumentErrorAll };
+        vector<DocumentId> ids = index.idsWithErrors(masks[option]);
+        if (ids.empty()) {
+            cout << "Документів за вибраним критерієм не знайдено\n";
+        }
+        else {
+            cout << "ID:";
+            for (DocumentId id : ids) cout << " " << id;
+            cout << "\n";
+        }
+    }
+
+    DocumentId id;
+    while (!getValidatedId("Введіть ID документа для перегляду (0 - пропустити): ", id, true)) {}
+    if (id == 0) return;
+
+    auto doc = index.fetch(id);
+    if (!doc) {
+        cout << "Документ з таким ID не знайдено\n";
+        return;
+    }
+    cout << "ID: " << doc->id << "\n"
+        << "Зміст: " << doc->content.str() << "\n"
+        << "Підпис: " << (doc->isSigned ? "Так" : "Ні") << "\n"
+        << "Формат: " << doc->format << "\n";
+}
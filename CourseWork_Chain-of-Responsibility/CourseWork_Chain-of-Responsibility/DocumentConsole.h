@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "DocumentStore.h"
+#include "FilterExpression.h"
+
+// Interactive (std::cin/std::cout) front end over any DocumentStore.
+class DocumentConsole {
+private:
+    DocumentStore& storage;
+    std::chrono::milliseconds timeLimit{ 0 };
+    size_t pageSize = 20;
+
+    // Rows are printed while the store is walked, so a sharded store never
+    // has to keep the matching documents in memory.
+    void printErrorTableHeader(const std::string& header);
+    void printErrorTableRow(const Document& doc);
+    void printErrorTableFooter();
+    // Shows the matches of `plan` pageSize rows at a time, each page
+    // framed by `header` and `footer`, and asks before the next one; the
+    // store is only walked as far as the pages shown. False if nothing
+    // matched.
+    bool printPages(const std::function<void()>& header, const DocumentVisitor& row,
+        const std::function<void()>& footer, const QueryPlan& plan);
+    // printPages with the error table; says so if nothing matched.
+    bool printFilteredDocuments(const std::string& header, const QueryPlan& plan);
+    // Bounded by timeLimit and by `cancel`, which Ctrl+C trips.
+    ValidationDeadline runDeadline(const CancellationToken& cancel) const;
+
+public:
+    explicit DocumentConsole(DocumentStore& documentStorage);
+
+    void addDocumentManually();
+    void deleteDocumentById(DocumentId targetId);
+    void editDocumentById();
+    void printAllDocuments();
+    // Full-text search (see FullTextIndex.h), results paged like the list.
+    void searchDocumentsByText();
+    // Rows per page of printAllDocuments and handleErrorSearch, 0 for all.
+    void setPageSize(size_t rows) { pageSize = rows; }
+    // Ctrl+C stops a run in progress; the documents left unvalidated are
+    // listed rather than the process being killed.
+    void verifyAllDocuments();
+    // Upper bound on each verifyAllDocuments run, 0 for none.
+    void setValidationTimeLimit(std::chrono::milliseconds limit) { timeLimit = limit; }
+    // verifyAllDocuments with tracing on: prints the slowest documents and
+    // writes a Chrome trace-event file.
+    void traceAllDocuments(const std::string& tracePath = "trace.json");
+    void clearAllDocuments();
+    void printMemoryUsage();
+    // Format histogram, size quantiles and error rates from one validation
+    // pass over the store; Ctrl+C and the time limit stop it early.
+    void printCorpusStatistics();
+    static void printStatistics(const CorpusStatistics& stats);
+    void saveDocumentsToFile(const std::string& filename = "documents.txt");
+    void loadDocumentsFromFile(const std::string& filename = "documents.txt");
+    // Adds every file below `root` (see crawlDirectory) and reports what
+    // was skipped.
+    void importDirectory(const std::string& root);
+
+    // Filtering
+    void showErrorFilterMenu();
+    void handleErrorSearch(int option);
+    // `errorType` is an error category of the filter language, e.g.
+    // "empty_content" (see FilterExpression.h).
+    void findInvalidDocumentsByError(const std::string& errorType);
+    // Reads a filter expression, prints its plan and pages the matches.
+    void queryDocuments();
+
+    // Answers filter and lookup queries from the index sidecar alone,
+    // without reading the documents into memory.
+    void queryIndexWithoutLoading(const std::string& filename = "documents.txt");
+};
@@ -0,0 +1,179 @@
+#include "DocumentIndex.h"
+#include "DocumentStorage.h"
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    // DIX3 added the format-mismatch bitmap, DIX4 the error policy hash,
+    // DIX5 the data file's modification time.
+    const char kMagic[4] = { 'D', 'I', 'X', '5' };
+
+    // Size and modification time of the data file; an edit that keeps the
+    // size still moves the time.
+    struct DataStamp {
+        uint64_t size = 0;
+        int64_t modified = 0;
+    };
+
+    bool stampOf(const string& dataFile, DataStamp& stamp) {
+        error_code ec;
+        stamp.size = fs::file_size(dataFile, ec);
+        if (ec) return false;
+        const fs::file_time_type time = fs::last_write_time(dataFile, ec);
+        if (ec) return false;
+        stamp.modified = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    template <typename T>
+    void writeValue(ofstream& out, T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readValue(ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+string DocumentIndex::pathFor(const string& dataFile) {
+    return dataFile + ".idx";
+}
+
+// Layout: magic, data size, data modification time, policy hash, count,
+// count x (id, offset), DocumentErrorCount bitmaps of ceil(count / 64)
+// words, format histogram.
+bool DocumentIndex::write(const string& dataFile, const vector<Entry>& entries, const ErrorPolicy& policy) {
+    DataStamp stamp;
+    if (!stampOf(dataFile, stamp)) return false;
+    ofstream out(pathFor(dataFile), ios::binary);
+    if (!out.is_open()) return false;
+
+    vector<const Entry*> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& e : entries) sorted.push_back(&e);
+    sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->id < b->id; });
+
+    out.write(kMagic, sizeof(kMagic));
+    writeValue<uint64_t>(out, stamp.size);
+    writeValue<int64_t>(out, stamp.modified);
+    writeValue<uint64_t>(out, policy.hash());
+    writeValue<uint32_t>(out, static_cast<uint32_t>(sorted.size()));
+    for (const Entry* e : sorted) {
+        writeValue<uint64_t>(out, e->id);
+        writeValue<uint64_t>(out, e->offset);
+    }
+
+    const size_t words = (sorted.size() + 63) / 64;
+    map<string, size_t> histogram;
+    for (int bit = 0; bit < DocumentErrorCount; ++bit) {
+        vector<uint64_t> bitmap(words, 0);
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (sorted[i]->errors & (1u << bit)) bitmap[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        for (uint64_t w : bitmap) writeValue<uint64_t>(out, w);
+    }
+
+    for (const Entry* e : sorted) histogram[e->format]++;
+    writeValue<uint32_t>(out, static_cast<uint32_t>(histogram.size()));
+    for (const auto& f : histogram) {
+        writeValue<uint32_t>(out, static_cast<uint32_t>(f.first.size()));
+        out.write(f.first.data(), f.first.size());
+        writeValue<uint64_t>(out, f.second);
+    }
+
+    return static_cast<bool>(out);
+}
+
+bool DocumentIndex::open(const string& dataFile, const ErrorPolicy& policy) {
+    ids.clear();
+    offsets.clear();
+    bitmaps.clear();
+    formats.clear();
+
+    DataStamp stamp;
+    if (!stampOf(dataFile, stamp)) return false;
+    ifstream in(pathFor(dataFile), ios::binary | ios::ate);
+    if (!in.is_open()) return false;
+    // Counts and lengths come from the file, so every allocation is first
+    // checked against the bytes actually left in it.
+    const uint64_t indexSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    auto remaining = [&] { return indexSize - static_cast<uint64_t>(in.tellg()); };
+
+    char magic[4];
+    uint64_t dataSize = 0, policyHash = 0;
+    int64_t modified = 0;
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(magic)) != 0) return false;
+    if (!readValue(in, dataSize) || dataSize != stamp.size) return false;
+    if (!readValue(in, modified) || modified != stamp.modified) return false;
+    if (!readValue(in, policyHash) || policyHash != policy.hash()) return false;
+    if (!readValue(in, count)) return false;
+    const uint64_t words = (uint64_t(count) + 63) / 64;
+    if (uint64_t(count) * 16 + words * 8 * DocumentErrorCount > remaining()) return false;
+
+    ids.resize(count);
+    offsets.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!readValue(in, ids[i]) || !readValue(in, offsets[i])) return false;
+    }
+
+    bitmaps.assign(DocumentErrorCount, vector<uint64_t>(static_cast<size_t>(words)));
+    for (auto& bitmap : bitmaps) {
+        for (auto& w : bitmap) {
+            if (!readValue(in, w)) return false;
+        }
+    }
+
+    uint32_t formatCount = 0;
+    if (!readValue(in, formatCount)) return false;
+    for (uint32_t i = 0; i < formatCount; ++i) {
+        uint32_t len = 0;
+        uint64_t n = 0;
+        if (!readValue(in, len) || len > remaining()) return false;
+        string name(len, '\0');
+        if (!in.read(&name[0], len) || !readValue(in, n)) return false;
+        formats[name] = static_cast<size_t>(n);
+    }
+
+    dataPath = dataFile;
+    return true;
+}
+
+vector<DocumentId> DocumentIndex::idsWithErrors(unsigned errorMask) const {
+    vector<DocumentId> result;
+    if (bitmaps.empty()) return result;
+
+    for (size_t w = 0; w < bitmaps[0].size(); ++w) {
+        uint64_t word = 0;
+        for (int bit = 0; bit < DocumentErrorCount; ++bit) {
+            if (errorMask & (1u << bit)) word |= bitmaps[bit][w];
+        }
+        while (word) {
+            int b = 0;
+            while (!(word & (uint64_t(1) << b))) ++b;
+            result.push_back(ids[w * 64 + b]);
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+shared_ptr<Document> DocumentIndex::fetch(DocumentId id) const {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id) return nullptr;
+
+    ifstream in(dataPath);
+    if (!in.is_open()) return nullptr;
+    in.seekg(static_cast<streamoff>(offsets[it - ids.begin()]));
+    // A malformed record would be skipped in favour of the next one.
+    auto doc = DocumentStorage::readDocumentRecord(in);
+    return doc && doc->id == id ? doc : nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include "Document.h"
+
+// Sidecar index written next to the documents file ("documents.txt.idx").
+// It maps every ID to the byte offset of its record and keeps one bitmap
+// per DocumentError plus a format histogram, so filters and single-document
+// lookups can be answered without loading the whole file.
+class DocumentIndex {
+public:
+    struct Entry {
+        DocumentId id;
+        uint64_t offset;
+        unsigned errors;     // DocumentError flags
+        std::string format;
+    };
+
+    static std::string pathFor(const std::string& dataFile);
+    // Writes pathFor(dataFile) for the data file as it is now on disk, so
+    // call it once that file is complete. `policy` is the one the entries'
+    // error flags were detected with.
+    static bool write(const std::string& dataFile, const std::vector<Entry>& entries, const ErrorPolicy& policy);
+
+    // Fails if the index is missing or corrupt, if the data file's size or
+    // modification time differs from the ones recorded, or if the index
+    // was written under another error policy.
+    bool open(const std::string& dataFile, const ErrorPolicy& policy);
+
+    size_t size() const { return ids.size(); }
+    std::vector<DocumentId> idsWithErrors(unsigned errorMask) const;
+    const std::map<std::string, size_t>& formatHistogram() const { return formats; }
+
+    // Seeks straight to the record; nullptr if the ID is not indexed.
+    std::shared_ptr<Document> fetch(DocumentId id) const;
+
+private:
+    std::string dataPath;
+    std::vector<DocumentId> ids;          // sorted
+    std::vector<uint64_t> offsets;
+    std::vector<std::vector<uint64_t>> bitmaps; // one per DocumentError bit
+    std::map<std::string, size_t> formats;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <set>
+#include <memory>
+#include <iterator>
+#include <functional>
+#include <utility>
+#include <cstddef>
+#include "Document.h"
+
+using DocumentSet = std::set<std::shared_ptr<Document>, DocumentComparator>;
+using DocumentFilter = std::function<bool(const Document&)>;
+
+// Lazy view over the documents matching a filter, in ID order, optionally
+// starting after a given ID (found in O(log n), for cursor pagination).
+// Nothing is copied: iterating walks the storage and skips non-matches.
+// Iterators refer to the query object and to the storage, so keep the
+// query alive while iterating and do not modify the storage meanwhile.
+class DocumentQuery {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        iterator() = default;
+        iterator(DocumentSet::const_iterator position, DocumentSet::const_iterator last, const DocumentFilter* predicate)
+            : pos(position), end(last), filter(predicate) {
+            skip();
+        }
+
+        reference operator*() const { return **pos; }
+        pointer operator->() const { return pos->get(); }
+
+        iterator& operator++() {
+            ++pos;
+            skip();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const { return pos == other.pos; }
+        bool operator!=(const iterator& other) const { return pos != other.pos; }
+
+    private:
+        void skip() {
+            while (pos != end && filter && *filter && !(*filter)(**pos)) ++pos;
+        }
+
+        DocumentSet::const_iterator pos;
+        DocumentSet::const_iterator end;
+        const DocumentFilter* filter = nullptr;
+    };
+
+    DocumentQuery(const DocumentSet& documents, DocumentFilter predicate, DocumentId afterId = 0)
+        : docs(&documents), filter(std::move(predicate)), after(afterId) {}
+
+    iterator begin() const {
+        return iterator(after == 0 ? docs->begin() : docs->upper_bound(after), docs->end(), &filter);
+    }
+    iterator end() const { return iterator(docs->end(), docs->end(), &filter); }
+
+    bool empty() const { return begin() == end(); }
+    size_t count() const {
+        size_t n = 0;
+        for (auto it = begin(); it != end(); ++it) ++n;
+        return n;
+    }
+
+private:
+    const DocumentSet* docs;
+    DocumentFilter filter;
+    DocumentId after;
+};
@@ -1,400 +1,1015 @@
 #include "DocumentStorage.h"
-#include <iostream>
-#include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
 #include <algorithm>
+#include <utility>
+#include <unordered_set>
+#include <deque>
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+#include "Compression.h"
+#include "AsyncIO.h"
 
 using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    // Start of the first record at or after `pos`: 0, the byte after a
+    // "---" line, or the file size if no record starts there.
+    uint64_t recordStartFrom(istream& in, uint64_t pos, uint64_t fileSize) {
+        if (pos == 0) return 0;
+        const size_t kProbe = 64 * 1024;
+        const size_t kMarker = 6; // longest boundary, "\n---\r\n"
+
+        // Back off so a boundary ending exactly at `pos` is found too.
+        uint64_t from = pos > kMarker ? pos - kMarker : 0;
+        string window;
+        while (from < fileSize) {
+            window.resize(static_cast<size_t>(min<uint64_t>(kProbe, fileSize - from)));
+            in.clear();
+            in.seekg(static_cast<streamoff>(from));
+            in.read(&window[0], static_cast<streamsize>(window.size()));
+            window.resize(static_cast<size_t>(in.gcount()));
+            if (window.empty()) break;
+
+            for (size_t at = window.find("\n---"); at != string::npos; at = window.find("\n---", at + 1)) {
+                size_t after = at + 4;
+                if (after < window.size() && window[after] == '\r') ++after;
+                if (after >= window.size()) break; // cut off, seen again in the next window
+                if (window[after] == '\n' && from + after + 1 >= pos) return from + after + 1;
+            }
+            if (from + window.size() >= fileSize) break;
+            from += window.size() - kMarker;
+        }
+        return fileSize;
+    }
 
-// Helper function declarations (can be moved to a utils file later, but keeping local for now)
-extern bool getValidatedInt(const string& prompt, int& result, int min, int max);
-extern void logResult(const string& message);
+    // Just past the last "---" line ("\n---\n" or "\n---\r\n") of `text`,
+    // npos if it has none.
+    size_t lastRecordEnd(const string& text) {
+        for (size_t at = text.rfind("\n---"); at != string::npos; at = at == 0 ? string::npos : text.rfind("\n---", at - 1)) {
+            size_t after = at + 4;
+            if (after < text.size() && text[after] == '\r') ++after;
+            if (after < text.size() && text[after] == '\n') return after + 1;
+        }
+        return string::npos;
+    }
+
+    bool isDecimal(const string& text, size_t from) {
+        // 19 digits always fit in a DocumentId.
+        return text.size() > from && text.size() - from <= 19 &&
+            all_of(text.begin() + from, text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+}
 
 DocumentStorage::DocumentStorage() {}
 
 void DocumentStorage::setValidatorChain(shared_ptr<Validator> chain) {
-    validatorChain = chain;
-}
-
-void DocumentStorage::printErrorTable(const vector<shared_ptr<Document>>& docs, const string& header) {
-    cout << header << "\n";
-    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
-    cout << "| ID  | Content                 | Підпис | Формат | Проблеми                      |\n";
-    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
-
-    for (const auto& doc : docs) {
-        string errorStr;
-        // Use the chain to get errors just for display construction in this filtered view?
-        // The original code passed in docs that were ALREADY filtered.
-        // Re-validating here to get the error strings is consistent.
-        
-        vector<string> errors;
-        if (validatorChain) {
-            validatorChain->validate(*doc, errors);
-        } else {
-             // Fallback if no chain (shouldn't happen with correct usage)
-             if (doc->content.empty()) errors.push_back("- Вміст");
-             if (!doc->isSigned) errors.push_back("- Підпис");
-             if (doc->format != "txt" && doc->format != "pdf") errors.push_back("- Формат");
+    vector<LinkVerdicts> updated;
+    for (Validator* link = chain.get(); link; link = link->nextLink()) {
+        LinkVerdicts entry;
+        entry.link = link;
+
+        const string id = link->stableId();
+        auto old = find_if(linkVerdicts.begin(), linkVerdicts.end(), [&id](const LinkVerdicts& v) {
+            return !id.empty() && v.link && v.link->stableId() == id;
+        });
+        if (old != linkVerdicts.end()) {
+            if (old->link->configHash() == link->configHash()) {
+                entry.verdicts = move(old->verdicts);
+                entry.bytes = old->bytes;
+            }
+            else {
+                for (auto& v : old->verdicts) {
+                    auto doc = documents.find(v.first);
+                    if (doc != documents.end() && link->sameVerdict(*old->link, **doc, v.second)) {
+                        entry.bytes += verdictFootprint(v.second);
+                        entry.verdicts.emplace(v.first, move(v.second));
+                    }
+                }
+            }
+            old->link = nullptr; // one new link per old one
         }
+        updated.push_back(move(entry));
+    }
 
-        for (const auto& err : errors) {
-            errorStr += err + "; ";
+    linkVerdicts = move(updated);
+    validatorChain = chain; // the old links were needed until here
+
+    // Verdicts of the old chain can never be hit again, drop them.
+    cacheBytes = 0;
+    for (const auto& lv : linkVerdicts) cacheBytes += lv.bytes;
+    for (const auto& bucket : contentPool) {
+        for (const auto& entry : bucket.second) {
+            entry.content.clearVerdicts();
+            entry.cacheBytes = 0;
         }
+    }
+    for (const auto& doc : documents) corpusJoined(*doc);
+}
 
-        cout << "| " << left << setw(3) << doc->id << " | "
-            << left << setw(24) << (doc->content.length() > 22 ? doc->content.substr(0, 19) + "..." : doc->content) << "| "
-            << left << setw(7) << (doc->isSigned ? "Так" : "Ні") << "| "
-            << left << setw(7) << doc->format << "| "
-            << left << setw(30) << errorStr << "|\n";
+void DocumentStorage::setCompressionThreshold(size_t minBytes) {
+    compressionThreshold = minBytes;
+    for (const auto& bucket : contentPool) {
+        for (const auto& entry : bucket.second) cacheBytes -= entry.cacheBytes;
+    }
+
+    // Convert every shared body once and hand the result to all of its users.
+    // The old body is kept alive in the map so its address cannot be reused.
+    contentPool.clear();
+    unordered_map<const ContentBody*, pair<Content, Content>> converted;
+    for (const auto& doc : documents) {
+        auto it = converted.find(doc->content.identity());
+        if (it != converted.end()) {
+            doc->content = it->second.second;
+            internContent(*doc); // same body: only counts the document
+            continue;
+        }
+        Content before = doc->content;
+        applyCompression(*doc);
+        internContent(*doc);
+        converted.emplace(before.identity(), make_pair(before, doc->content));
     }
+    recountTrackedBytes();
+}
 
-    cout << "+-----+-------------------------+--------+--------+-------------------------------+\n";
+void DocumentStorage::corpusLeft(const Document& doc, unsigned changed) {
+    for (auto& lv : linkVerdicts) {
+        if (!lv.link->tracksCorpus() || !(lv.link->inputs() & changed)) continue;
+        lv.link->corpusRemoved(doc);
+        dropVerdicts(lv);
+    }
 }
 
-void DocumentStorage::showErrorFilterMenu() {
-    cout << "+-------------------------------------------------+\n";
-    cout << "|       Оберіть тип помилки для фільтрації:       |\n";
-    cout << "+-------------------------------------------------+\n";
-    cout << "| 1 | Документи без вмісту                        |\n";
-    cout << "| 2 | Документи без підпису                       |\n";
-    cout << "| 3 | Документи з недійсним форматом              |\n";
-    cout << "| 4 | Усі документи з будь-якими помилками        |\n";
-    cout << "| 0 | Повернутись до головного меню               |\n";
-    cout << "+-------------------------------------------------+\n";
+void DocumentStorage::corpusJoined(const Document& doc, unsigned changed) {
+    for (auto& lv : linkVerdicts) {
+        if (!lv.link->tracksCorpus() || !(lv.link->inputs() & changed)) continue;
+        lv.link->corpusAdded(doc);
+        dropVerdicts(lv);
+    }
 }
 
-void DocumentStorage::addDocumentManually() {
-    string content, formatInput;
-    bool signedFlag = false;
+void DocumentStorage::attachTextIndex(shared_ptr<FullTextIndex> index) const {
+    textIndex = move(index);
+    textIndexShared = true;
+    for (const auto& doc : documents) textIndex->add(doc->id, doc->content);
+}
 
-    cout << "Введіть вміст документа. Введіть `::end` на окремому рядку, щоб завершити:\n";
+vector<DocumentId> DocumentStorage::searchText(const string& query, size_t limit) const {
+    if (!textIndex) {
+        textIndex = make_shared<FullTextIndex>();
+        for (const auto& doc : documents) textIndex->add(doc->id, doc->content);
+    }
+    vector<DocumentId> ids = textIndex->search(query);
+    if (limit != 0 && ids.size() > limit) ids.resize(limit);
+    return ids;
+}
 
-    // Clear input buffer if needed (simple approximation)
-    // cin.ignore(); // can be risky depending on previous input
+void DocumentStorage::forgetCorpusVerdicts() const {
+    for (auto& lv : linkVerdicts) {
+        if (lv.link->tracksCorpus()) dropVerdicts(lv);
+    }
+}
 
-    while (true) {
-        string line;
-        getline(cin, line);
-        if (line == "::end") break;
-        content += line + "\n";
+size_t DocumentStorage::uniqueContentCount() const {
+    size_t count = 0;
+    for (const auto& bucket : contentPool) {
+        count += bucket.second.size();
     }
+    return count;
+}
 
-    string flagInput;
-    while (true) {
-        cout << "Документ підписано? (1 – так, 0 – ні): ";
-        getline(cin, flagInput);
+void DocumentStorage::internContent(Document& doc) {
+    if (doc.content.empty()) return;
 
-        if (flagInput == "1" || flagInput == "0") {
-            signedFlag = (flagInput == "1");
-            break;
-        }
-        else {
-            cout << "Некоректне значення. Введіть 1 або 0\n";
+    auto& bucket = contentPool[doc.content.hash()];
+    for (auto& existing : bucket) {
+        if (existing.content.sameText(doc.content)) {
+            doc.content = existing.content;
+            ++existing.documents;
+            return;
         }
     }
+    bucket.push_back({ doc.content, 1 });
+    trackedBytes += pooledBodyFootprint(doc.content);
+}
 
-    cout << "Введіть формат документа (txt/pdf): ";
-    getline(cin, formatInput);
+void DocumentStorage::releaseContent(const Content& content) {
+    if (content.empty()) return;
 
-    auto doc = make_shared<Document>(content, signedFlag, formatInput);
-    documents.insert(doc);
+    auto it = contentPool.find(content.hash());
+    if (it == contentPool.end()) return;
 
-    cout << "Документ успішно додано!\n";
-    logResult("Додано новий документ вручну (ID: " + to_string(doc->id) + ")");
+    auto& bucket = it->second;
+    for (auto entry = bucket.begin(); entry != bucket.end(); ++entry) {
+        if (entry->content.identity() == content.identity()) {
+            if (--entry->documents == 0) {
+                trackedBytes -= pooledBodyFootprint(entry->content);
+                cacheBytes -= entry->cacheBytes;
+                bucket.erase(entry);
+            }
+            break;
+        }
+    }
+    if (bucket.empty()) contentPool.erase(it);
 }
 
-void DocumentStorage::deleteDocumentById(int targetId) {
-    bool found = false;
-    for (auto it = documents.begin(); it != documents.end(); ++it) {
-        if ((*it)->id == targetId) {
-            documents.erase(it);
-            cout << "Документ з ID " << targetId << " успішно видалено!\n";
-            found = true;
-            break;
+size_t DocumentStorage::internGrowth(const Content& content) const {
+    if (content.empty()) return 0;
+    auto it = contentPool.find(content.hash());
+    if (it != contentPool.end()) {
+        for (const auto& existing : it->second) {
+            if (existing.content.sameText(content)) return 0;
         }
     }
-    if (!found) {
-        cout << "\nДокумент з ID " << targetId << " не знайдено.\n";
-    }
-}
-
-void DocumentStorage::editDocumentById() {
-    int editId;
-    while (!getValidatedInt("Введіть ID документа, який хочете редагувати: ", editId, 1, INT_MAX)) {}
-
-    for (auto& doc : documents) {
-        if (doc->id == editId) {
-            string displayContent = doc->content;
-            replace(displayContent.begin(), displayContent.end(), '\n', ' ');
-            if (displayContent.length() > 22)
-                displayContent = displayContent.substr(0, 19) + "...";
-
-            cout << "\n+-----+-------------------------+--------+--------+\n";
-            cout << "| ID  | Зміст                   | Підпис | Формат |\n";
-            cout << "+-----+-------------------------+--------+--------+\n";
-            cout << "| " << left << setw(3) << doc->id << " | "
-                << setw(25) << displayContent << "| "
-                << setw(7) << (doc->isSigned ? "Так" : "Ні") << "| "
-                << setw(7) << doc->format << " |\n";
-            cout << "+-----+-------------------------+--------+--------+\n";
-
-            cout << "+----+--------------------------------------------+\n";
-            cout << "|            Оберіть пункт редагування            |\n";
-            cout << "+----+--------------------------------------------+\n";
-            cout << "| 1  | Змінити вміст документа                    |\n";
-            cout << "| 2  | Змінити формат (txt/pdf)                   |\n";
-            cout << "| 3  | Змінити статус підпису                     |\n";
-            cout << "+----+--------------------------------------------+\n";
-
-            int choice;
-            while (!getValidatedInt("Ваш вибір: ", choice, 1, 3)) {}
-
-            switch (choice) {
-            case 1: {
-                cout << "Введіть новий вміст документа. Введіть `::end` на окремому рядку, щоб завершити:\n";
-                string newContent, line;
-                // cin.ignore(); // Carefully used in main logic
-                while (true) {
-                    getline(cin, line);
-                    if (line == "::end") break;
-                    newContent += line + "\n";
-                }
-                doc->content = newContent;
-                break;
-            }
-            case 2: {
-                cout << "Новий формат (txt/pdf): ";
-                string newFormat;
-                // cin.ignore();
-                getline(cin, newFormat);
-                doc->format = newFormat;
-                break;
-            }
-            case 3: {
-                int flag;
-                while (!getValidatedInt("Новий статус (1 - підписано, 0 - не підписано): ", flag, 0, 1)) {}
-                doc->isSigned = (flag == 1);
-                break;
-            }
-            }
+    return pooledBodyFootprint(content);
+}
+
+size_t DocumentStorage::releaseSavings(const Content& content) const {
+    if (content.empty()) return 0;
+    auto it = contentPool.find(content.hash());
+    if (it == contentPool.end()) return 0;
+    for (const auto& entry : it->second) {
+        if (entry.content.identity() == content.identity()) {
+            return entry.documents == 1 ? pooledBodyFootprint(entry.content) : 0;
+        }
+    }
+    return 0;
+}
 
-            cout << "Документ оновлено!\n";
-            logResult("Документ з ID " + to_string(editId) + " відредаговано.");
+void DocumentStorage::applyCompression(Document& doc) const {
+    if (compressionThreshold > 0 && doc.content.length() >= compressionThreshold) {
+        doc.content.compress();
+    }
+    else {
+        doc.content.decompress();
+    }
+}
+
+size_t DocumentStorage::documentFootprint(const Document& doc) {
+    return sizeof(Document) + memory::kControlBlock + memory::kTreeNode + sizeof(shared_ptr<Document>)
+        + memory::stringHeap(doc.format) + memory::stringHeap(doc.signature);
+}
+
+size_t DocumentStorage::pooledBodyFootprint(const Content& content) {
+    return content.bodyBytes() + memory::kControlBlock + sizeof(PooledContent);
+}
+
+size_t DocumentStorage::verdictFootprint(const ErrorSet& errors) {
+    return memory::kHashNode + sizeof(pair<const DocumentId, ErrorSet>) + memory::errorsHeap(errors);
+}
+
+size_t DocumentStorage::budgetedBytes() const {
+    // The hash tables themselves are O(1) to measure, so they are not tracked.
+    size_t bytes = trackedBytes + cacheBytes + memory::hashMapNodes(contentPool);
+    for (const auto& lv : linkVerdicts) bytes += lv.verdicts.bucket_count() * sizeof(void*);
+    if (textIndex && !textIndexShared) bytes += textIndex->memoryBytes();
+    return bytes;
+}
+
+void DocumentStorage::eraseVerdict(LinkVerdicts& lv, DocumentId id) const {
+    auto it = lv.verdicts.find(id);
+    if (it == lv.verdicts.end()) return;
+    const size_t bytes = verdictFootprint(it->second);
+    lv.bytes -= bytes;
+    cacheBytes -= bytes;
+    lv.verdicts.erase(it);
+}
+
+void DocumentStorage::dropVerdicts(LinkVerdicts& lv) const {
+    if (lv.verdicts.empty()) return; // clear() touches every bucket
+    cacheBytes -= lv.bytes;
+    lv.bytes = 0;
+    lv.verdicts.clear();
+}
+
+void DocumentStorage::recountBodyCache(const Content& content) const {
+    if (content.empty()) return;
+    auto it = contentPool.find(content.hash());
+    if (it == contentPool.end()) return;
+    for (const auto& entry : it->second) {
+        if (entry.content.identity() == content.identity()) {
+            const size_t bytes = entry.content.verdictCacheBytes();
+            cacheBytes = cacheBytes - entry.cacheBytes + bytes;
+            entry.cacheBytes = bytes;
             return;
         }
     }
+}
 
-    cout << "Документ з таким ID не знайдено\n";
+void DocumentStorage::recountTrackedBytes() {
+    trackedBytes = 0;
+    for (const auto& doc : documents) trackedBytes += documentFootprint(*doc);
+    for (const auto& bucket : contentPool) {
+        for (const auto& entry : bucket.second) trackedBytes += pooledBodyFootprint(entry.content);
+    }
 }
 
-void DocumentStorage::printAllDocuments() {
-    if (documents.empty()) {
-        cout << "Список документів порожній!\n";
-        return;
+// The budget is checked before an ID is allocated, so a refused document
+// does not use one up.
+bool DocumentStorage::insert(const shared_ptr<Document>& doc) {
+    applyCompression(*doc);
+    internContent(*doc); // a new body is counted from here on
+    const size_t footprint = documentFootprint(*doc);
+    if (budgetBytes > 0 && budgetedBytes() + footprint > budgetBytes) {
+        releaseContent(doc->content);
+        ++budgetRejections;
+        return false;
     }
 
-    cout << "Список документів";
-    cout << "\n+----+--------------------------+--------+--------+\n";
-    cout << "| ID |          Зміст           | Підпис | Формат |\n";
-    cout << "+----+--------------------------+--------+--------+\n";
+    if (doc->id == 0) {
+        doc->id = idAllocator.allocate(); // 0 once every ID is taken
+    }
+    else if (!idAllocator.observe(doc->id)) {
+        doc->id = 0;
+    }
+    if (doc->id == 0 || !documents.insert(doc).second) {
+        releaseContent(doc->content); // ID already present, keep this copy out
+        return false;
+    }
+    trackedBytes += footprint;
+    corpusJoined(*doc);
+    if (textIndex) textIndex->add(doc->id, doc->content);
+    return true;
+}
 
-    for (const auto& doc : documents) {
-        string displayContent = doc->content;
-        replace(displayContent.begin(), displayContent.end(), '\n', ' ');
-        if (displayContent.length() > 25) {
-            displayContent = displayContent.substr(0, 20) + "...";
-        }
+DocumentId DocumentStorage::add(Document&& doc) {
+    auto stored = make_shared<Document>(move(doc));
+    return insert(stored) ? stored->id : 0;
+}
 
-        cout << "| " << left << setw(2) << doc->id << " | "
-            << left << setw(25) << displayContent << "| "
-            << left << setw(6) << (doc->isSigned ? "Yes" : "No") << " | "
-            << left << setw(6) << doc->format << " |\n";
+bool DocumentStorage::edit(DocumentId id, DocumentPatch patch) {
+    auto it = documents.find(id);
+    if (it == documents.end()) return false;
+
+    Document& doc = **it;
+    // The new body is prepared (and compressed) first, so the budget can
+    // refuse the edit before anything changes.
+    Document replacement(patch.content ? move(*patch.content) : string(), false, string());
+    if (patch.content) applyCompression(replacement);
+    if (budgetBytes > 0) {
+        const size_t current = budgetedBytes();
+        size_t grown = current;
+        if (patch.content && !replacement.content.sameText(doc.content)) {
+            grown = grown - releaseSavings(doc.content) + internGrowth(replacement.content);
+        }
+        if (patch.format) grown = grown - memory::stringHeap(doc.format) + memory::stringHeap(*patch.format);
+        if (patch.signature) grown = grown - memory::stringHeap(doc.signature) + memory::stringHeap(*patch.signature);
+        if (grown > budgetBytes && grown > current) {
+            ++budgetRejections;
+            return false;
+        }
     }
 
-    cout << "+----+--------------------------+--------+--------+\n";
+    const unsigned changed = (patch.content ? InputContent : 0u)
+        | (patch.isSigned || patch.signature ? InputSigned : 0u)
+        | (patch.format ? InputFormat : 0u);
+    corpusLeft(doc, changed);
+    if (patch.content) {
+        releaseContent(doc.content);
+        doc.content = move(replacement.content);
+        internContent(doc);
+        if (textIndex) textIndex->add(id, doc.content);
+    }
+    if (patch.isSigned) doc.isSigned = *patch.isSigned;
+    if (patch.format) {
+        trackedBytes -= memory::stringHeap(doc.format);
+        doc.format = move(*patch.format);
+        trackedBytes += memory::stringHeap(doc.format);
+    }
+    if (patch.signature) {
+        trackedBytes -= memory::stringHeap(doc.signature);
+        doc.signature = move(*patch.signature);
+        trackedBytes += memory::stringHeap(doc.signature);
+    }
 
-    string countLine = "| Всього документів: " + to_string(documents.size());
-    int totalLength = 49;
-    int padding = totalLength - static_cast<int>(countLine.length());
-    cout << countLine << string(std::max(0, padding), ' ') << " |\n"; // safe max
+    for (auto& lv : linkVerdicts) {
+        if (lv.link->inputs() & changed) eraseVerdict(lv, id);
+    }
+    corpusJoined(doc, changed);
+    return true;
+}
 
-    cout << "+-------------------------------------------------+\n";
+bool DocumentStorage::remove(DocumentId id) {
+    auto it = documents.find(id);
+    if (it == documents.end()) return false;
+
+    corpusLeft(**it);
+    if (textIndex) textIndex->remove(id);
+    releaseContent((*it)->content);
+    trackedBytes -= documentFootprint(**it);
+    documents.erase(it);
+    for (auto& lv : linkVerdicts) eraseVerdict(lv, id);
+    return true;
 }
 
-void DocumentStorage::verifyAllDocuments() {
-    cout << "Перевірка документів";
-    cout << "\n+-----+-------------------------+--------+--------+--------------------------------+\n";
-    cout << "| ID  | Content                 | Підпис | Формат | Статус перевірки               |\n";
-    cout << "+-----+-------------------------+--------+--------+--------------------------------+\n";
+void DocumentStorage::clear() {
+    // One by one: a shard's clear must leave the other shards indexed.
+    for (const auto& doc : documents) {
+        corpusLeft(*doc);
+        if (textIndex) textIndex->remove(doc->id);
+    }
+    documents.clear();
+    contentPool.clear();
+    for (auto& lv : linkVerdicts) dropVerdicts(lv);
+    trackedBytes = 0;
+    cacheBytes = 0;
+}
 
+MemoryUsage DocumentStorage::memoryUsage() const {
+    MemoryUsage usage;
+    usage.documents = documents.size() * sizeof(Document);
+    usage.controlBlocks = documents.size() * memory::kControlBlock;
+    usage.nodes = documents.size() * (memory::kTreeNode + sizeof(shared_ptr<Document>));
     for (const auto& doc : documents) {
-        vector<string> errors;
-        if (validatorChain) {
-            validatorChain->validate(*doc, errors);
-        } else {
-            // Should prompt error if no chain
-            errors.push_back("SYSTEM ERROR: No validator chain");
-        }
-
-        string status;
-        if (errors.empty()) {
-            status = "+ Успішно перевірено";
-        } else {
-            for (const auto& err : errors) {
-                status += err + "; ";
-            }
-        }
+        usage.formats += memory::stringHeap(doc->format) + memory::stringHeap(doc->signature);
+    }
 
-        string displayContent = doc->content;
-        replace(displayContent.begin(), displayContent.end(), '\n', ' ');
-        if (displayContent.length() > 23) {
-            displayContent = displayContent.substr(0, 20) + "...";
+    usage.nodes += memory::hashMapNodes(contentPool);
+    for (const auto& bucket : contentPool) {
+        usage.nodes += bucket.second.capacity() * sizeof(PooledContent);
+        for (const auto& entry : bucket.second) {
+            usage.content += entry.content.bodyBytes();
+            usage.controlBlocks += memory::kControlBlock;
+            usage.caches += entry.content.verdictCacheBytes();
         }
+    }
 
-        cout << "| " << left << setw(3) << doc->id << " | "
-            << left << setw(24) << displayContent << "| "
-            << left << setw(7) << (doc->isSigned ? "Так" : "Ні") << "| "
-            << left << setw(7) << doc->format << "| "
-            << left << setw(31) << status << "|\n";
+    usage.caches += linkVerdicts.capacity() * sizeof(LinkVerdicts);
+    for (const auto& lv : linkVerdicts) {
+        usage.caches += memory::hashMapNodes(lv.verdicts);
+        for (const auto& v : lv.verdicts) usage.caches += memory::errorsHeap(v.second);
     }
+    if (textIndex && !textIndexShared) usage.indexes += textIndex->memoryBytes();
+    return usage;
+}
+
+shared_ptr<const Document> DocumentStorage::find(DocumentId id) const {
+    auto it = documents.find(id);
+    return it == documents.end() ? nullptr : *it;
+}
+
+ErrorSet DocumentStorage::validate(const Document& doc) const {
+    ErrorSet errors;
+    if (!validatorChain) return errors;
 
-    cout << "+-----+-------------------------+--------+--------+--------------------------------+\n";
+    if (!isStored(doc)) {
+        validatorChain->validate(doc, errors);
+        return errors;
+    }
+    FreshVerdicts fresh;
+    collectErrors(doc, nullptr, fresh, errors);
+    storeVerdicts(doc, fresh);
+    return errors;
 }
 
-void DocumentStorage::clearAllDocuments() {
-    char confirm;
-    cout << "Увага! Ви впевнені, що хочете видалити всі документи? (y/n): ";
-    cin >> confirm;
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+optional<ErrorSet> DocumentStorage::validateWithin(const Document& doc, const ValidationDeadline& deadline) const {
+    ErrorSet errors;
+    if (!validatorChain) return errors;
 
-    if (confirm == 'y' || confirm == 'Y') {
-        documents.clear();
-        cout << "Усі документи успішно видалено.\n";
-        logResult("Користувач видалив усі документи.");
+    bool finished;
+    if (!isStored(doc)) {
+        finished = validatorChain->validateWithin(doc, errors, deadline);
     }
     else {
-        cout << "Очищення скасовано.\n";
+        FreshVerdicts fresh;
+        finished = collectErrors(doc, nullptr, fresh, errors, &deadline);
+        storeVerdicts(doc, fresh);
     }
+    if (!finished) return nullopt;
+    return errors;
 }
 
-void DocumentStorage::saveDocumentsToFile(const string& filename) {
-    ofstream out(filename);
-    if (!out.is_open()) {
-        cerr << "Не вдалося відкрити файл для запису.\n";
-        return;
-    }
+bool DocumentStorage::isStored(const Document& doc) const {
+    auto it = documents.find(doc.id);
+    return it != documents.end() && it->get() == &doc;
+}
 
-    for (const auto& doc : documents) {
-        out << "ID: " << doc->id << "\n";
-        out << "Content: " << doc->content << "\n";
-        out << "Signed: " << (doc->isSigned ? "Yes" : "No") << "\n";
-        out << "Format: " << doc->format << "\n";
-        out << "---\n";
+bool DocumentStorage::collectErrors(const Document& doc, WorkStealingScheduler* scheduler, FreshVerdicts& fresh,
+                                    ErrorSet& errors, const ValidationDeadline* deadline) const {
+    ValidationTrace* tracing = trace.get();
+    vector<ValidationTrace::LinkTiming> timings;
+
+    for (size_t i = 0; i < linkVerdicts.size(); ++i) {
+        const LinkVerdicts& lv = linkVerdicts[i];
+        const auto started = tracing ? ValidationTrace::Clock::now() : ValidationTrace::Clock::time_point();
+
+        auto known = lv.verdicts.find(doc.id);
+        if (known != lv.verdicts.end()) {
+            errors.insert(errors.end(), known->second.begin(), known->second.end());
+        }
+        else {
+            ErrorSet found;
+            if (!lv.link->validateLink(doc, found, scheduler, deadline)) return false;
+            errors.insert(errors.end(), found.begin(), found.end());
+            fresh.emplace_back(i, move(found));
+        }
+
+        if (tracing) {
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(ValidationTrace::Clock::now() - started);
+            timings.push_back({ linkLabel(*lv.link, i), started, static_cast<uint64_t>(elapsed.count()) });
+        }
     }
 
-    out.close();
+    if (tracing) tracing->record(doc.id, doc.content.length(), timings);
+    return true;
 }
 
-void DocumentStorage::loadDocumentsFromFile(const string& filename) {
-    ifstream in(filename);
-    if (!in.is_open()) {
-        cerr << "Файл документів не знайдено.\n";
-        return;
+void DocumentStorage::storeVerdicts(const Document& doc, FreshVerdicts& fresh) const {
+    if (fresh.empty()) return;
+    for (auto& f : fresh) {
+        LinkVerdicts& lv = linkVerdicts[f.first];
+        const size_t bytes = verdictFootprint(f.second);
+        auto stored = lv.verdicts.try_emplace(doc.id);
+        if (!stored.second) {
+            const size_t old = verdictFootprint(stored.first->second);
+            lv.bytes -= old;
+            cacheBytes -= old;
+        }
+        stored.first->second = move(f.second);
+        lv.bytes += bytes;
+        cacheBytes += bytes;
     }
+    fresh.clear();
+    recountBodyCache(doc.content);
+}
 
-    string line;
-    string content, format;
-    bool isSigned = false;
-    int id = 0; // Initialize id
-    int maxId = 0;
+optional<ErrorSet> DocumentStorage::validate(DocumentId id) const {
+    auto it = documents.find(id);
+    if (it == documents.end()) return nullopt;
+    return validate(**it);
+}
 
-    // A simple parsing loop state machine could be better, but sticking to logic close to original
-    while (getline(in, line)) {
-        if (line.rfind("ID: ", 0) == 0) {
-            id = stoi(line.substr(4));
-            if (id > maxId) maxId = id;
+DocumentQuery DocumentStorage::query(DocumentFilter filter, DocumentId after) const {
+    return DocumentQuery(documents, move(filter), after);
+}
+
+void DocumentStorage::forEach(const DocumentVisitor& visit, const DocumentFilter& filter) const {
+    for (const auto& doc : documents) {
+        if (!filter || filter(*doc)) visit(*doc);
+    }
+}
+
+PageCursor DocumentStorage::forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit,
+                                       const DocumentFilter& filter) const {
+    PageCursor cursor{ after, false };
+    size_t visited = 0;
+    for (const Document& doc : query(filter, after)) {
+        if (limit != 0 && visited == limit) {
+            cursor.more = true; // found without visiting it
+            break;
         }
-        else if (line.rfind("Content: ", 0) == 0) {
-            content = line.substr(9);
+        visit(doc);
+        cursor.last = doc.id;
+        ++visited;
+    }
+    return cursor;
+}
+
+// Documents are validated in batches, so a huge storage needs no result
+// list for all of it; a document large enough is split further by its links.
+// A deadline is checked before each batch and by every task; tasks that
+// find it passed give up, and the batch's finished documents are still
+// visited.
+ValidationProgress DocumentStorage::validateEach(const ValidationVisitor& visit, const DocumentFilter& filter,
+                                                 const ValidationDeadline& deadline) const {
+    const size_t kBatch = 4096;
+    WorkStealingScheduler& scheduler = WorkStealingScheduler::shared();
+    const ValidationDeadline* bound = deadline.unbounded() ? nullptr : &deadline;
+
+    ValidationProgress progress;
+    vector<const Document*> batch;
+    vector<ErrorSet> results;
+    vector<FreshVerdicts> fresh;
+    vector<char> finished;
+    batch.reserve(kBatch);
+
+    DocumentId scanned = 0; // every document up to this ID has been dealt with
+    auto it = documents.begin();
+    while (it != documents.end()) {
+        if (bound && (progress.stopped = bound->reason()) != StopReason::None) break;
+
+        batch.clear();
+        for (; it != documents.end() && batch.size() < kBatch; ++it) {
+            if (!filter || filter(**it)) batch.push_back(it->get());
+            scanned = (*it)->id;
         }
-        else if (line.rfind("Signed: ", 0) == 0) {
-            isSigned = (line.substr(8) == "Yes");
+
+        results.assign(batch.size(), ErrorSet());
+        finished.assign(batch.size(), 1);
+        if (validatorChain) {
+            // Verdicts are only read while the workers run and stored after.
+            fresh.assign(batch.size(), FreshVerdicts());
+            TaskGroup group;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                scheduler.spawn(group, [this, &batch, &results, &fresh, &finished, &scheduler, bound, i] {
+                    finished[i] = collectErrors(*batch[i], &scheduler, fresh[i], results[i], bound);
+                });
+            }
+            scheduler.wait(group);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                storeVerdicts(*batch[i], fresh[i]);
+            }
         }
-        else if (line.rfind("Format: ", 0) == 0) {
-            format = line.substr(8);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!finished[i]) {
+                progress.interrupted.push_back(batch[i]->id);
+                continue;
+            }
+            visit(*batch[i], results[i]);
+            ++progress.validated;
         }
-        else if (line == "---") {
-            auto doc = make_shared<Document>(content, isSigned, format);
-            doc->id = id;
-            documents.insert(doc);
+        if (!progress.interrupted.empty()) {
+            progress.stopped = bound->reason(); // passed while the batch ran, and stays so
+            break;
         }
     }
 
-    Document::nextId = maxId + 1;
-    in.close();
+    if (!progress.complete()) progress.resumeAfter = scanned;
+    return progress;
+}
+
+// Verdicts are stored before a batch is visited, so the per-link ones of
+// each document are there to read when it reaches the visitor.
+ValidationProgress DocumentStorage::collectStatistics(CorpusStatistics& stats, const ValidationDeadline& deadline) const {
+    vector<string> names;
+    for (size_t i = 0; i < linkVerdicts.size(); ++i) names.push_back(linkLabel(*linkVerdicts[i].link, i));
+    stats.setLinks(move(names), errorPolicy());
+
+    return validateEach([this, &stats](const Document& doc, const ErrorSet& errors) {
+        stats.add(doc, !errors.empty());
+        for (size_t i = 0; i < linkVerdicts.size(); ++i) {
+            auto verdict = linkVerdicts[i].verdicts.find(doc.id);
+            if (verdict != linkVerdicts[i].verdicts.end() && !verdict->second.empty()) stats.addLinkFailure(i);
+        }
+    }, nullptr, deadline);
 }
 
-void DocumentStorage::handleErrorSearch(int option) {
-    vector<shared_ptr<Document>> result;
+bool DocumentStorage::saveTo(ostream& out, vector<DocumentIndex::Entry>* index) const {
+    if (index) index->reserve(index->size() + documents.size());
+    const ErrorPolicy policy = errorPolicy();
 
     for (const auto& doc : documents) {
-        // Collect errors using chain or local logic?
-        // Since search is by specific type, it's easier to check specific properties manually 
-        // OR rely on the chain returning specific error strings. 
-        // The original code checked properties directly. 
-        // To use the pattern properly, we should ideally ask the chain, but checking property is faster/simpler here.
-        // I will keep direct property checks for filtering efficiency as the Validators just append strings which is hard to parse back.
-        
-        bool invalidContent = doc->content.empty();
-        bool invalidSign = !doc->isSigned;
-        bool invalidFormat = (doc->format != "txt" && doc->format != "pdf");
-
-        switch (option) {
-        case 1:
-            if (invalidContent) result.push_back(doc);
-            break;
-        case 2:
-            if (invalidSign) result.push_back(doc);
-            break;
-        case 3:
-            if (invalidFormat) result.push_back(doc);
-            break;
-        case 4:
-            if (invalidContent || invalidSign || invalidFormat) result.push_back(doc);
-            break;
-        default:
-            cout << "Невірний вибір фільтра!\n";
-            return;
+        if (index) {
+            index->push_back({ doc->id, static_cast<uint64_t>(out.tellp()), detectErrors(*doc, policy), doc->format });
         }
+        writeRecord(out, *doc);
     }
+    return static_cast<bool>(out);
+}
 
-    if (result.empty()) {
-        cout << "Документів за вибраним критерієм не знайдено\n";
+void DocumentStorage::writeRecord(ostream& out, const Document& doc) {
+    out << "ID: " << doc.id << "\n";
+    if (doc.content.isCompressed()) {
+        out << "ContentLZ: " << doc.content.length() << " " << encodeBase64(doc.content.stored()) << "\n";
+    }
+    else if (doc.content.stored().find_first_of(string("\n\r\0", 3)) != string::npos) {
+        // Multi-line or binary bodies (crawled files) would break the record.
+        out << "ContentB64: " << encodeBase64(doc.content.stored()) << "\n";
     }
     else {
-        string header = "Документи з помилками: ";
-        if (option == 1) header += "Вміст";
-        else if (option == 2) header += "Підпис";
-        else if (option == 3) header += "Формат";
-        else header += "Всі";
-        printErrorTable(result, header);
+        out << "Content: " << doc.content.stored() << "\n";
+    }
+    out << "Signed: " << (doc.isSigned ? "Yes" : "No") << "\n";
+    if (!doc.signature.empty()) out << "Signature: " << doc.signature << "\n";
+    out << "Format: " << doc.format << "\n";
+    out << "---\n";
+}
+
+size_t DocumentStorage::loadFrom(istream& in, vector<MalformedRecord>* malformed) {
+    size_t loaded = 0;
+    while (auto doc = readDocumentRecord(in, malformed)) {
+        const size_t rejected = budgetRejections;
+        if (insert(doc)) ++loaded;
+        else if (budgetRejections != rejected) break;
+    }
+    return loaded;
+}
+
+bool DocumentStorage::saveDocumentsToFile(const string& filename) const {
+    return syncWait(saveAsync(filename));
+}
+
+// loadParallel cuts the file by its size, which a pipe or a device does
+// not have; those are streamed through loadAsync.
+bool DocumentStorage::loadDocumentsFromFile(const string& filename, vector<MalformedRecord>* malformed) {
+    error_code ec;
+    const bool streamed = fs::exists(filename, ec) && !fs::is_regular_file(filename, ec);
+    LoadResult result = streamed ? syncWait(loadAsync(filename)) : loadParallel(filename);
+    if (malformed) {
+        malformed->insert(malformed->end(), result.malformed.begin(), result.malformed.end());
+    }
+    return result.opened;
+}
+
+LoadResult DocumentStorage::loadParallel(const string& filename, size_t chunkBytes) {
+    LoadResult result;
+    uint64_t fileSize = 0;
+    {
+        ifstream in(filename, ios::binary | ios::ate);
+        if (!in.is_open()) return result;
+        fileSize = static_cast<uint64_t>(in.tellg());
+    }
+    result.opened = true;
+    chunkBytes = max<size_t>(chunkBytes, 1);
+
+    // Ranges are parsed on the scheduler at most `window` ahead of the one
+    // being added, and added in file order as each completes: the budget
+    // is checked from the first range on, and once it refuses a document
+    // nothing after it is parsed. Every range reads its own bytes.
+    struct Range {
+        TaskGroup parsed;
+        vector<shared_ptr<Document>> documents;
+        vector<MalformedRecord> malformed;
+    };
+    const size_t rangeCount = static_cast<size_t>((fileSize + chunkBytes - 1) / chunkBytes);
+    WorkStealingScheduler& scheduler = WorkStealingScheduler::shared();
+    const size_t window = 2 * (scheduler.workerCount() + 1);
+    deque<Range> ranges; // in flight, in file order
+    atomic<bool> stop{ false };
+    size_t spawned = 0;
+    auto spawnNext = [&] {
+        const size_t i = spawned++;
+        Range& range = ranges.emplace_back();
+        scheduler.spawn(range.parsed, [&filename, &range, &stop, fileSize, chunkBytes, rangeCount, i] {
+            if (stop.load(memory_order_relaxed)) return;
+            ifstream in(filename, ios::binary);
+            if (!in.is_open()) {
+                range.malformed.push_back({ uint64_t(i) * chunkBytes, "не вдалося прочитати частину файлу" });
+                return;
+            }
+            uint64_t begin = recordStartFrom(in, uint64_t(i) * chunkBytes, fileSize);
+            uint64_t end = i + 1 == rangeCount ? fileSize : recordStartFrom(in, uint64_t(i + 1) * chunkBytes, fileSize);
+            if (begin >= end) return;
+
+            string text(static_cast<size_t>(end - begin), '\0');
+            in.clear();
+            in.seekg(static_cast<streamoff>(begin));
+            in.read(&text[0], static_cast<streamsize>(text.size()));
+            text.resize(static_cast<size_t>(in.gcount()));
+
+            istringstream records(move(text));
+            while (!stop.load(memory_order_relaxed)) {
+                auto doc = readDocumentRecord(records, &range.malformed, begin);
+                if (!doc) break;
+                range.documents.push_back(move(doc));
+            }
+        });
+    };
+    while (spawned < rangeCount && spawned < window) spawnNext();
+
+    const bool validating = validateOnLoad && validatorChain;
+    const size_t before = documents.size();
+    unordered_set<DocumentId> added;
+    // False once the budget refuses `doc`.
+    auto add = [&](const shared_ptr<Document>& doc) {
+        const size_t rejected = budgetRejections;
+        if (!insert(doc)) return budgetRejections == rejected;
+        ++result.loaded;
+        if (validating && before > 0) added.insert(doc->id);
+        return true;
+    };
+
+    // Records without an ID go last, so their fresh IDs cannot take one
+    // that a later record carries. Until then they are held, and counted
+    // against the budget at their full (not deduplicated) size.
+    vector<shared_ptr<Document>> unnumbered;
+    size_t unnumberedBytes = 0;
+    while (!ranges.empty()) {
+        Range& range = ranges.front();
+        scheduler.wait(range.parsed);
+        if (!result.budgetExceeded) {
+            move(range.malformed.begin(), range.malformed.end(), back_inserter(result.malformed));
+            for (auto& doc : range.documents) {
+                if (doc->id == 0) {
+                    unnumberedBytes += documentFootprint(*doc) + pooledBodyFootprint(doc->content);
+                    if (budgetBytes > 0 && budgetedBytes() + unnumberedBytes > budgetBytes) {
+                        ++budgetRejections;
+                        result.budgetExceeded = true;
+                        break;
+                    }
+                    unnumbered.push_back(move(doc));
+                }
+                else if (!add(doc)) {
+                    result.budgetExceeded = true; // fail fast, the rest would not fit either
+                    break;
+                }
+            }
+            if (result.budgetExceeded) stop = true;
+        }
+        ranges.pop_front();
+        if (spawned < rangeCount && !stop) spawnNext();
+    }
+    for (const auto& doc : unnumbered) {
+        if (!add(doc)) {
+            result.budgetExceeded = true;
+            break;
+        }
+    }
+    unnumbered.clear();
+
+    if (validating && result.loaded > 0) {
+        DocumentFilter onlyAdded;
+        if (before > 0) onlyAdded = [&added](const Document& doc) { return added.count(doc.id) > 0; };
+        validateEach([&result](const Document&, const ErrorSet& errors) {
+            if (!errors.empty()) ++result.invalid;
+        }, onlyAdded);
+    }
+    return result;
+}
+
+Task<LoadResult> DocumentStorage::loadAsync(string filename, size_t chunkBytes) {
+    LoadResult result;
+    auto in = make_shared<ifstream>(filename);
+    if (!in->is_open()) co_return result;
+    result.opened = true;
+
+    string pending; // bytes after the last complete record
+    uint64_t pendingOffset = 0; // where `pending` starts, as read in text mode
+    auto reading = readChunkAsync(in, chunkBytes);
+    while (true) {
+        string chunk = co_await reading;
+        bool last = chunk.size() < chunkBytes;
+        if (!last) reading = readChunkAsync(in, chunkBytes);
+
+        pending += chunk;
+        // "---" lines only ever end a record, cut after the last one.
+        const size_t cut = last ? pending.size() : lastRecordEnd(pending);
+        if (cut == string::npos) continue;
+
+        string tail = pending.substr(cut);
+        pending.resize(cut);
+        istringstream records(move(pending));
+        pending = move(tail);
+        const uint64_t base = pendingOffset;
+        pendingOffset += cut;
+
+        while (auto doc = readDocumentRecord(records, &result.malformed, base)) {
+            const size_t rejected = budgetRejections;
+            if (!insert(doc)) {
+                if (budgetRejections == rejected) continue;
+                result.budgetExceeded = true; // fail fast, the rest would not fit either
+                co_return result;
+            }
+            ++result.loaded;
+            if (validateOnLoad && validatorChain && !validate(*doc).empty()) ++result.invalid;
+        }
+        if (last) break;
+    }
+    co_return result;
+}
+
+Task<bool> DocumentStorage::saveAsync(string filename, size_t chunkBytes) const {
+    // Binary, so the index offsets are the byte counts produced here. The
+    // records go to a temporary file that replaces `filename` only once it
+    // is complete, so a failed save leaves the old file as it was.
+    const string temporary = filename + ".tmp";
+    auto out = make_shared<ofstream>(temporary, ios::binary);
+    if (!out->is_open()) co_return false;
+    error_code ec;
+    auto fail = [&] {
+        out->close();
+        fs::remove(temporary, ec);
+        return false;
+    };
+
+    vector<DocumentIndex::Entry> entries;
+    entries.reserve(documents.size());
+    const ErrorPolicy policy = errorPolicy();
+    uint64_t flushed = 0; // bytes handed to the writer so far
+
+    ostringstream chunk;
+    optional<IoOperation<bool>> writing;
+    auto it = documents.begin();
+    while (it != documents.end()) {
+        for (; it != documents.end() && static_cast<size_t>(chunk.tellp()) < chunkBytes; ++it) {
+            const Document& doc = **it;
+            entries.push_back({ doc.id, flushed + static_cast<uint64_t>(chunk.tellp()), detectErrors(doc, policy), doc.format });
+            writeRecord(chunk, doc);
+        }
+
+        if (writing && !co_await *writing) co_return fail();
+        string data = move(chunk).str();
+        chunk.str(string());
+        flushed += data.size();
+        writing.emplace(writeChunkAsync(out, move(data)));
     }
+    if (writing && !co_await *writing) co_return fail();
+
+    out->close();
+    if (!*out) co_return fail();
+    fs::rename(temporary, filename, ec);
+    if (ec) co_return fail();
+    co_return DocumentIndex::write(filename, entries, policy);
 }
 
-void DocumentStorage::findInvalidDocumentsByError(const string& errorType) {
-    // Legacy helper? Or just unused. Keeping for interface compatibility if needed.
-    // It was public in original.
-     for (const auto& doc : documents) {
-        if (errorType == "empty_content" && doc->content.empty()) {
-            cout << "Знайдено документ без вмісту. (ID: " << doc->id << ")\n";
+// Bodies are never copied here: the field prefix is erased in place and
+// the line buffer itself is moved into the document.
+shared_ptr<Document> DocumentStorage::readDocumentRecord(istream& in, vector<MalformedRecord>* malformed, uint64_t baseOffset) {
+    string line;
+    string content, format, signature;
+    Content unpacked; // a ContentLZ body, already checked
+    bool packed = false;
+    bool isSigned = false;
+    bool seenField = false;
+    bool seenId = false;
+    string problem; // first defect of the current record
+    DocumentId id = 0;
+    streamoff recordStart = 0;
+
+    auto skipRecord = [&] {
+        if (malformed) {
+            malformed->push_back({ baseOffset + static_cast<uint64_t>(max<streamoff>(recordStart, 0)), move(problem) });
         }
-        else if (errorType == "not_signed" && !doc->isSigned) {
-            cout << "Знайдено не підписаний документ. (ID: " << doc->id << ")\n";
+        content.clear();
+        unpacked = Content();
+        format.clear();
+        signature.clear();
+        packed = isSigned = seenField = seenId = false;
+        problem.clear();
+        id = 0;
+    };
+
+    while (true) {
+        // Only needed for reports, and only at the first line of a record.
+        if (malformed && !seenField) recordStart = in.tellg();
+        if (!getline(in, line)) break;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (line.rfind("ID: ", 0) == 0) {
+            if (isDecimal(line, 4)) {
+                id = strtoull(line.c_str() + 4, nullptr, 10);
+                seenId = true;
+            }
+            else if (problem.empty()) {
+                problem = "некоректний ID: \"" + line.substr(4, 32) + "\"";
+            }
+            seenField = true;
         }
-        else if (errorType == "invalid_format" && doc->format != "txt" && doc->format != "pdf") {
-            cout << "Знайдено документ з недійсним форматом: " << doc->format << " (ID: " << doc->id << ")\n";
+        else if (line.rfind("Content: ", 0) == 0) {
+            line.erase(0, 9);
+            content = move(line);
+            packed = false;
+            seenField = true;
         }
+        else if (line.rfind("ContentLZ: ", 0) == 0) {
+            // "ContentLZ: <original size> <base64 block>". The block is
+            // decoded once here, so a size that does not match it (or that
+            // it could never expand to) rejects the record, not the load.
+            const size_t sizeEnd = line.find(' ', 11);
+            const bool sized = sizeEnd != string::npos && isDecimal(line.substr(0, sizeEnd), 11);
+            const unsigned long long declared = sized ? strtoull(line.c_str() + 11, nullptr, 10) : 0;
+            line.erase(0, sized ? sizeEnd : line.size());
+            line.erase(0, line.find_first_not_of(' '));
+            packed = sized && decodeBase64(line, content)
+                && declared <= maxDecompressedSize(content.size())
+                && Content::fromCompressed(move(content), static_cast<size_t>(declared), unpacked);
+            content.clear();
+            if (!packed && problem.empty()) problem = "пошкоджений блок ContentLZ";
+            seenField = true;
+        }
+        else if (line.rfind("ContentB64: ", 0) == 0) {
+            line.erase(0, 12);
+            packed = false;
+            if (!decodeBase64(line, content)) {
+                content.clear();
+                if (problem.empty()) problem = "пошкоджений блок ContentB64";
+            }
+            seenField = true;
+        }
+        else if (line.rfind("Signed: ", 0) == 0) {
+            isSigned = line.compare(8, string::npos, "Yes") == 0;
+            seenField = true;
+        }
+        else if (line.rfind("Signature: ", 0) == 0) {
+            line.erase(0, 11);
+            signature = move(line);
+            seenField = true;
+        }
+        else if (line.rfind("Format: ", 0) == 0) {
+            line.erase(0, 8);
+            format = move(line);
+            seenField = true;
+        }
+        else if (line == "---" && seenField) {
+            if (problem.empty() && !seenId) problem = "запис без рядка ID";
+            if (!problem.empty()) {
+                skipRecord();
+                continue;
+            }
+            auto doc = make_shared<Document>(string(), isSigned, move(format));
+            doc->content = packed ? move(unpacked) : Content(move(content));
+            doc->id = id;
+            doc->signature = move(signature);
+            return doc;
+        }
+    }
+    if (seenField) {
+        problem = "запис не завершено рядком ---";
+        skipRecord();
     }
+    return nullptr;
 }
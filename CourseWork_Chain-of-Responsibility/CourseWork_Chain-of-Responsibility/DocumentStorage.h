@@ -3,32 +3,205 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <optional>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
 #include "Document.h"
 #include "Validator.h"
+#include "DocumentIndex.h"
+#include "DocumentQuery.h"
+#include "DocumentStore.h"
+#include "IdAllocator.h"
+#include "AsyncTask.h"
+#include "FullTextIndex.h"
 
-class DocumentStorage {
+struct LoadResult {
+    bool opened = false;
+    size_t loaded = 0;   // documents added
+    size_t invalid = 0;  // of those, rejected by the chain; 0 unless validated on load
+    bool budgetExceeded = false; // stopped at the memory budget
+    std::vector<MalformedRecord> malformed; // skipped, in file order
+};
+
+// Document engine: owns the documents and the validator chain.
+// Never touches the terminal; the interactive menu (DocumentConsole) is
+// just one client of this API.
+class DocumentStorage : public DocumentStore {
 private:
-    std::set<std::shared_ptr<Document>, DocumentComparator> documents;
+    DocumentSet documents;
     std::shared_ptr<Validator> validatorChain;
+    IdAllocator idAllocator;
+    size_t compressionThreshold = 0; // 0 keeps every body as plain text
+    bool validateOnLoad = true;
+
+    // One entry per distinct body, bucketed by content hash, with the
+    // number of stored documents using it; the entry goes at zero. Copies
+    // held outside the store (find() results, patches) do not count.
+    struct PooledContent {
+        Content content;
+        size_t documents = 0;
+        mutable size_t cacheBytes = 0; // of the body's verdict cache, as last counted
+    };
+    std::unordered_map<uint64_t, std::vector<PooledContent>> contentPool;
+
+    // Verdicts of one chain link for the stored documents; no entry means
+    // not checked yet. setValidatorChain carries them over to the new chain
+    // as far as the link's stableId()/configHash() allow, and edits drop
+    // only the verdicts of links that read the changed fields.
+    struct LinkVerdicts {
+        Validator* link = nullptr; // owned by validatorChain
+        std::unordered_map<DocumentId, ErrorSet> verdicts;
+        size_t bytes = 0; // verdictFootprint() of every entry
+    };
+    mutable std::vector<LinkVerdicts> linkVerdicts;
+    std::shared_ptr<ValidationTrace> trace;
+
+    // Null until the first search; from then on every add, edit and remove
+    // updates it. A shared one (attachTextIndex) is accounted by its owner.
+    mutable std::shared_ptr<FullTextIndex> textIndex;
+    mutable bool textIndexShared = false;
+
+    size_t budgetBytes = 0;
+    size_t budgetRejections = 0;
+    // Running estimate of everything in memoryUsage() but the caches,
+    // kept up to date by insert/edit/remove so the budget check is O(1).
+    size_t trackedBytes = 0;
+    // The same for the per-link verdicts and the body verdict caches; the
+    // text index keeps its own count.
+    mutable size_t cacheBytes = 0;
+    using FreshVerdicts = std::vector<std::pair<size_t, ErrorSet>>; // link index, errors
+
+    void applyCompression(Document& doc) const;
+    // Both keep trackedBytes and the document counts in step with the
+    // pool; every internContent is matched by one releaseContent.
+    void internContent(Document& doc);
+    void releaseContent(const Content& content);
+    // What internContent would add and releaseContent would free, for
+    // checking an edit against the budget before making it.
+    size_t internGrowth(const Content& content) const;
+    size_t releaseSavings(const Content& content) const;
+    static size_t documentFootprint(const Document& doc);
+    static size_t pooledBodyFootprint(const Content& content);
+    static size_t verdictFootprint(const ErrorSet& errors);
+    void recountTrackedBytes();
+    // What the budget is checked against: trackedBytes, cacheBytes and the
+    // text index unless it is shared.
+    size_t budgetedBytes() const;
+    // Keep cacheBytes in step with the per-link verdicts.
+    void eraseVerdict(LinkVerdicts& lv, DocumentId id) const;
+    void dropVerdicts(LinkVerdicts& lv) const;
+    // Counts what the body verdict cache of a stored document grew by.
+    void recountBodyCache(const Content& content) const;
+    bool insert(const std::shared_ptr<Document>& doc);
+    static void writeRecord(std::ostream& out, const Document& doc);
+    bool isStored(const Document& doc) const;
+    // Read-only on linkVerdicts (safe from worker threads); verdicts it had
+    // to compute are returned in `fresh` for storeVerdicts(). False if
+    // `deadline` passed before every link ran; `fresh` still holds the
+    // verdicts of the links that did.
+    bool collectErrors(const Document& doc, WorkStealingScheduler* scheduler, FreshVerdicts& fresh,
+        ErrorSet& errors, const ValidationDeadline* deadline = nullptr) const;
+    void storeVerdicts(const Document& doc, FreshVerdicts& fresh) const;
+    // Tells the corpus-tracking links (Validator::tracksCorpus) that `doc`
+    // left or joined the corpus, as far as their inputs saw `changed`.
+    void corpusLeft(const Document& doc, unsigned changed = InputAll);
+    void corpusJoined(const Document& doc, unsigned changed = InputAll);
 
 public:
     DocumentStorage();
-    void setValidatorChain(std::shared_ptr<Validator> chain);
-
-    void addDocumentManually();
-    void deleteDocumentById(int targetId);
-    void editDocumentById();
-    void printAllDocuments();
-    void verifyAllDocuments(); // Uses the chain now!
-    void clearAllDocuments();
-    void saveDocumentsToFile(const std::string& filename = "documents.txt");
-    void loadDocumentsFromFile(const std::string& filename = "documents.txt");
-    
-    // Filtering
-    void showErrorFilterMenu();
-    void handleErrorSearch(int option);
-    void findInvalidDocumentsByError(const std::string& errorType);
-    
-    // Helpers
-    void printErrorTable(const std::vector<std::shared_ptr<Document>>& docs, const std::string& header);
+    // Re-checks lazily: only links that are new or reconfigured, and of
+    // those only on documents whose verdict may have changed.
+    void setValidatorChain(std::shared_ptr<Validator> chain) override;
+    bool hasValidatorChain() const override { return validatorChain != nullptr; }
+    ErrorPolicy errorPolicy() const override { return errorPolicyOf(validatorChain.get()); }
+    void setCompressionThreshold(size_t minBytes) override;
+    size_t uniqueContentCount() const;
+    // Off: loadParallel and loadAsync only add the documents and leave
+    // `invalid` at 0; verdicts are then computed when something asks. The
+    // shards of a ShardedDocumentStorage load this way, so paging in a
+    // shard costs a parse, not a validation of the whole shard.
+    void setValidateOnLoad(bool enabled) { validateOnLoad = enabled; }
+    // For a store sharing its chain with others (the shards of a
+    // ShardedDocumentStorage): drops the verdicts of corpus-tracking links
+    // after another store's corpus changed.
+    void forgetCorpusVerdicts() const;
+    // Indexes the documents into `index` (one shared by several stores) and
+    // keeps it up to date; unchanged documents already in it are skipped.
+    void attachTextIndex(std::shared_ptr<FullTextIndex> index) const;
+
+    // Block of IDs for parallel ingest: each thread reserves a range once and
+    // passes documents with preassigned IDs to add(). Shorter than `count`
+    // once the ID space runs out.
+    IdAllocator::Range reserveIds(size_t count) { return idAllocator.reserve(count); }
+
+    DocumentId add(Document&& doc) override;
+    bool edit(DocumentId id, DocumentPatch patch) override;
+    bool remove(DocumentId id) override;
+    void clear() override;
+
+    std::shared_ptr<const Document> find(DocumentId id) const override;
+    size_t size() const override { return documents.size(); }
+
+    // Uses and fills the per-link verdicts for stored documents, so calls
+    // must not overlap; validateEach parallelises on its own.
+    ErrorSet validate(const Document& doc) const override;
+    std::optional<ErrorSet> validate(DocumentId id) const override;
+    std::optional<ErrorSet> validateWithin(const Document& doc, const ValidationDeadline& deadline) const override;
+
+    // Lazy, ID-ordered view; an empty filter matches every document.
+    DocumentQuery query(DocumentFilter filter = nullptr, DocumentId after = 0) const;
+    void forEach(const DocumentVisitor& visit, const DocumentFilter& filter = nullptr) const override;
+    PageCursor forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit,
+        const DocumentFilter& filter = nullptr) const override;
+    ValidationProgress validateEach(const ValidationVisitor& visit, const DocumentFilter& filter = nullptr,
+        const ValidationDeadline& deadline = {}) const override;
+    ValidationProgress collectStatistics(CorpusStatistics& stats, const ValidationDeadline& deadline = {}) const override;
+    std::vector<DocumentId> searchText(const std::string& query, size_t limit = 0) const override;
+    void setTrace(std::shared_ptr<ValidationTrace> validationTrace) override { trace = move(validationTrace); }
+
+    MemoryUsage memoryUsage() const override;
+    void setMemoryBudget(size_t bytes) override { budgetBytes = bytes; }
+    size_t memoryBudget() const override { return budgetBytes; }
+    size_t rejectedByBudget() const override { return budgetRejections; }
+    // Estimate of memoryUsage() in O(1), as the budget sees it.
+    size_t trackedMemory() const { return budgetedBytes(); }
+
+    // Record format: "ID/Content|ContentLZ|ContentB64/Signed/[Signature/]Format/---".
+    // `index`, when given, receives one entry per record with its offset
+    // in `out`.
+    bool saveTo(std::ostream& out, std::vector<DocumentIndex::Entry>* index = nullptr) const;
+    // Returns the number of documents added; stops at the memory budget.
+    size_t loadFrom(std::istream& in, std::vector<MalformedRecord>* malformed = nullptr);
+
+    // Blocking wrapper around saveAsync; loading uses loadParallel for
+    // regular files and loadAsync for anything else (a pipe, a device).
+    bool saveDocumentsToFile(const std::string& filename = "documents.txt") const override;
+    bool loadDocumentsFromFile(const std::string& filename = "documents.txt",
+        std::vector<MalformedRecord>* malformed = nullptr) override;
+
+    // Cuts the file into byte ranges of about `chunkBytes`, each moved
+    // forward to the next record boundary (a "---" line), and reads and
+    // parses the ranges on the shared scheduler, a few ahead of the range
+    // being added. Documents are added in file order (records without an
+    // ID last), so parsing stops where the memory budget does, and then,
+    // unless setValidateOnLoad(false), validated in parallel. Offsets of
+    // malformed records are byte offsets into the file.
+    LoadResult loadParallel(const std::string& filename, size_t chunkBytes = 4 << 20);
+
+    // The file is read in chunks on the I/O pool; while chunk N+1 is being
+    // read, the records of chunk N are added and run through the chain (so
+    // content verdicts are cached by the time anyone asks; not with
+    // setValidateOnLoad(false)). Saving likewise
+    // formats the next chunk while the previous one is written. The storage
+    // must not be used by anything else until the task completes.
+    Task<LoadResult> loadAsync(std::string filename, size_t chunkBytes = 1 << 20);
+    Task<bool> saveAsync(std::string filename, size_t chunkBytes = 1 << 20) const;
+
+    // Parses the next well-formed record, nullptr at end of input. Malformed
+    // records (bad ID, no ID, corrupt ContentLZ block, no closing "---") are
+    // skipped and reported to `malformed` with their position in `in` plus
+    // `baseOffset`.
+    static std::shared_ptr<Document> readDocumentRecord(std::istream& in,
+        std::vector<MalformedRecord>* malformed = nullptr, uint64_t baseOffset = 0);
 };
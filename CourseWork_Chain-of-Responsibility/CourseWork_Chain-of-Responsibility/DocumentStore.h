@@ -0,0 +1,134 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <optional>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include "Document.h"
+#include "Validator.h"
+#include "DocumentQuery.h"
+#include "ValidationTrace.h"
+#include "MemoryUsage.h"
+#include "Cancellation.h"
+#include "CorpusStatistics.h"
+
+// Fields left empty are not changed by DocumentStore::edit.
+struct DocumentPatch {
+    std::optional<std::string> content;
+    std::optional<bool> isSigned;
+    std::optional<std::string> format;
+    std::optional<std::string> signature;
+};
+
+// A record a load skipped; `offset` is the byte where it starts.
+struct MalformedRecord {
+    uint64_t offset;
+    std::string reason;
+};
+
+// How far a bounded validateEach got. The documents it visited were
+// validated; if it stopped early, exactly the matching documents listed in
+// `interrupted` and all those with an ID above `resumeAfter` were not.
+struct ValidationProgress {
+    StopReason stopped = StopReason::None;
+    size_t validated = 0;
+    std::vector<DocumentId> interrupted; // in flight when the run stopped, ID order
+    DocumentId resumeAfter = 0;
+
+    bool complete() const { return stopped == StopReason::None; }
+};
+
+// Where a forEachPage call stopped: pass `last` as `after` for the next
+// page. `more` is false once no later document can match.
+struct PageCursor {
+    DocumentId last = 0;
+    bool more = false;
+};
+
+using DocumentVisitor = std::function<void(const Document&)>;
+using ValidationVisitor = std::function<void(const Document&, const ErrorSet&)>;
+
+// Operations every document engine offers, whether all documents live in
+// memory (DocumentStorage) or are paged in shard by shard
+// (ShardedDocumentStorage). Clients such as DocumentConsole only use this.
+class DocumentStore {
+public:
+    virtual ~DocumentStore() = default;
+
+    virtual void setValidatorChain(std::shared_ptr<Validator> chain) = 0;
+    virtual bool hasValidatorChain() const = 0;
+    // The error categories the chain checks, for detectErrors().
+    virtual ErrorPolicy errorPolicy() const = 0;
+    // Bodies of at least `minBytes` are stored compressed (0 disables).
+    virtual void setCompressionThreshold(size_t minBytes) = 0;
+
+    // Documents with id 0 get the next free ID; a preassigned ID (from a
+    // reserved range or another store) is kept. Returns the stored ID, or
+    // 0 if that ID is already taken or outside 1..IdAllocator::kMaxId.
+    virtual DocumentId add(Document&& doc) = 0;
+    // False if there is no such document, or if the budget refuses the
+    // edit; nothing is changed then.
+    virtual bool edit(DocumentId id, DocumentPatch patch) = 0;
+    virtual bool remove(DocumentId id) = 0;
+    virtual void clear() = 0;
+
+    virtual std::shared_ptr<const Document> find(DocumentId id) const = 0;
+    virtual size_t size() const = 0;
+    bool empty() const { return size() == 0; }
+
+    // Runs the chain; without a chain every document is reported clean.
+    virtual ErrorSet validate(const Document& doc) const = 0;
+    virtual std::optional<ErrorSet> validate(DocumentId id) const = 0;
+    // Like validate(doc), but nullopt if `deadline` passes first. Links
+    // that finished before it keep their cached verdicts.
+    virtual std::optional<ErrorSet> validateWithin(const Document& doc, const ValidationDeadline& deadline) const = 0;
+
+    // Calls `visit` for every document matching `filter`, in ID order.
+    // The document reference is only valid during the call, and `visit`
+    // must not modify the store.
+    virtual void forEach(const DocumentVisitor& visit, const DocumentFilter& filter = nullptr) const = 0;
+    // One page of forEach: at most `limit` matching documents (0 = no
+    // limit) with an ID above `after`. It stops at the page's last row, so
+    // its cost is the page plus the non-matches skipped on the way.
+    virtual PageCursor forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit,
+        const DocumentFilter& filter = nullptr) const = 0;
+
+    // Validates the documents matching `filter` on the shared work-stealing
+    // scheduler and reports each with its errors, in ID order, on the
+    // calling thread. Same rules for `visit` as forEach. Once `deadline`
+    // passes, documents not yet finished are skipped instead of visited,
+    // and the returned progress says which ones those are.
+    virtual ValidationProgress validateEach(const ValidationVisitor& visit, const DocumentFilter& filter = nullptr,
+        const ValidationDeadline& deadline = {}) const = 0;
+
+    // Validates every document like validateEach and adds it to `stats`,
+    // with the chain links that reported errors for it.
+    virtual ValidationProgress collectStatistics(CorpusStatistics& stats, const ValidationDeadline& deadline = {}) const = 0;
+
+    // IDs of the documents matching a full-text query (syntax in
+    // FullTextIndex.h), ascending; 0 for `limit` means all. The index is
+    // built on the first search and kept up to date from then on.
+    virtual std::vector<DocumentId> searchText(const std::string& query, size_t limit = 0) const = 0;
+
+    // While a trace is attached, every validation of a stored document is
+    // timed per chain link into it; nullptr switches tracing off.
+    virtual void setTrace(std::shared_ptr<ValidationTrace> trace) = 0;
+
+    virtual MemoryUsage memoryUsage() const = 0;
+    // 0 means no limit. A DocumentStorage refuses add() and growing edits
+    // (and stops a load) rather than go past the budget;
+    // ShardedDocumentStorage spills shards.
+    virtual void setMemoryBudget(size_t bytes) = 0;
+    virtual size_t memoryBudget() const = 0;
+    // Documents refused because of the budget so far.
+    virtual size_t rejectedByBudget() const = 0;
+
+    // Also writes the DocumentIndex sidecar next to the file.
+    virtual bool saveDocumentsToFile(const std::string& filename = "documents.txt") const = 0;
+    // Malformed records are skipped, not fatal; `malformed`, when given,
+    // receives one entry per skipped record. False only if the file
+    // cannot be opened.
+    virtual bool loadDocumentsFromFile(const std::string& filename = "documents.txt",
+        std::vector<MalformedRecord>* malformed = nullptr) = 0;
+};
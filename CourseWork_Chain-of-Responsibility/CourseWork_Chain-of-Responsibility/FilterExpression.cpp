@@ -0,0 +1,731 @@
+#include "FilterExpression.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    const size_t kBatch = 1024;
+
+    struct ErrorName {
+        const char* name;
+        unsigned mask;
+    };
+    const ErrorName kErrorNames[] = {
+        { "empty_content", ErrorEmptyContent },
+        { "not_signed", ErrorNotSigned },
+        { "invalid_format", ErrorInvalidFormat },
+        { "format_mismatch", ErrorFormatMismatch },
+        { "any", DocumentErrorAll },
+    };
+
+    bool sameWord(const string& word, const char* keyword) {
+        size_t i = 0;
+        for (; i < word.size() && keyword[i]; ++i) {
+            if (tolower(static_cast<unsigned char>(word[i])) != keyword[i]) return false;
+        }
+        return i == word.size() && !keyword[i];
+    }
+
+    // Sets bit i of `out` where `predicate(i)` holds; written without
+    // branches so the compiler can vectorize it.
+    template <class Predicate>
+    void fillMask(vector<uint64_t>& out, size_t n, Predicate predicate) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i >> 6] |= static_cast<uint64_t>(predicate(i)) << (i & 63);
+        }
+    }
+
+    template <class Op>
+    void compareColumn(const vector<uint64_t>& column, Op op, vector<uint64_t>& out) {
+        const uint64_t* values = column.data();
+        fillMask(out, column.size(), [&](size_t i) { return op(values[i]); });
+    }
+}
+
+// Recursive descent over a token stream; the first error wins.
+class FilterExpression::Parser {
+public:
+    Parser(const string& text, FilterExpression& target) : input(text), expression(target) {
+        advance();
+    }
+
+    bool run(string* error) {
+        parseOr(); // every node follows its operands, so the root ends up last
+        if (failure.empty() && token.type != Token::End) fail("очікувалося AND, OR або кінець запиту");
+        if (!failure.empty()) {
+            if (error) *error = failure;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Token {
+        enum Type { Word, String, Open, Close, OpenRange, CloseRange, Comma, Operator, End } type = End;
+        string text;
+        Compare op = Compare::Eq;
+        size_t offset = 0;
+    };
+
+    static bool isWordChar(char c) {
+        return !isspace(static_cast<unsigned char>(c)) && !strchr("()[],\"=!<>", c);
+    }
+
+    void advance() {
+        while (pos < input.size() && isspace(static_cast<unsigned char>(input[pos]))) ++pos;
+        token = Token();
+        token.offset = pos;
+        if (pos >= input.size()) return;
+
+        const char c = input[pos];
+        auto two = [&](char next) { return pos + 1 < input.size() && input[pos + 1] == next; };
+        switch (c) {
+        case '(': token.type = Token::Open; ++pos; return;
+        case ')': token.type = Token::Close; ++pos; return;
+        case '[': token.type = Token::OpenRange; ++pos; return;
+        case ']': token.type = Token::CloseRange; ++pos; return;
+        case ',': token.type = Token::Comma; ++pos; return;
+        case '"': {
+            size_t close = input.find('"', pos + 1);
+            if (close == string::npos) {
+                fail("незакриті лапки");
+                pos = input.size();
+                return;
+            }
+            token.type = Token::String;
+            token.text = input.substr(pos + 1, close - pos - 1);
+            pos = close + 1;
+            return;
+        }
+        case '=':
+            token.type = Token::Operator;
+            token.op = Compare::Eq;
+            pos += two('=') ? 2 : 1;
+            return;
+        case '!':
+            if (!two('=')) break;
+            token.type = Token::Operator;
+            token.op = Compare::Ne;
+            pos += 2;
+            return;
+        case '<':
+            token.type = Token::Operator;
+            token.op = two('=') ? Compare::Le : two('>') ? Compare::Ne : Compare::Lt;
+            pos += two('=') || two('>') ? 2 : 1;
+            return;
+        case '>':
+            token.type = Token::Operator;
+            token.op = two('=') ? Compare::Ge : Compare::Gt;
+            pos += two('=') ? 2 : 1;
+            return;
+        default:
+            break;
+        }
+        if (!isWordChar(c)) {
+            fail(string("невідомий символ '") + c + "'");
+            pos = input.size();
+            return;
+        }
+        token.type = Token::Word;
+        while (pos < input.size() && isWordChar(input[pos])) token.text.push_back(input[pos++]);
+    }
+
+    void fail(const string& what) { failAt(token.offset, what); }
+
+    void failAt(size_t offset, const string& what) {
+        if (failure.empty()) failure = "позиція " + to_string(offset + 1) + ": " + what;
+    }
+
+    bool keyword(const char* word) const {
+        return token.type == Token::Word && sameWord(token.text, word);
+    }
+
+    bool accept(const char* word) {
+        if (!keyword(word)) return false;
+        previous = token.text;
+        advance();
+        return true;
+    }
+
+    bool expect(Token::Type type, const char* what) {
+        if (token.type == type) {
+            advance();
+            return true;
+        }
+        fail(string("очікувалося ") + what);
+        return false;
+    }
+
+    size_t add(Node node) {
+        expression.nodes.push_back(move(node));
+        return expression.nodes.size() - 1;
+    }
+
+    size_t join(Kind kind, vector<size_t> operands) {
+        if (operands.size() == 1) return operands[0];
+        Node node;
+        node.kind = kind;
+        node.children = move(operands);
+        return add(move(node));
+    }
+
+    size_t parseOr() {
+        vector<size_t> operands{ parseAnd() };
+        while (failure.empty() && accept("or")) operands.push_back(parseAnd());
+        return join(Kind::Or, move(operands));
+    }
+
+    size_t parseAnd() {
+        vector<size_t> operands{ parseNot() };
+        while (failure.empty() && accept("and")) operands.push_back(parseNot());
+        return join(Kind::And, move(operands));
+    }
+
+    size_t parseNot() {
+        if (!accept("not")) return parsePrimary();
+        Node node;
+        node.kind = Kind::Not;
+        node.children.push_back(parseNot());
+        return add(move(node));
+    }
+
+    size_t parsePrimary() {
+        if (!failure.empty()) return 0;
+        if (token.type == Token::Open) {
+            advance();
+            size_t inner = parseOr();
+            expect(Token::Close, "')'");
+            return inner;
+        }
+        if (token.type != Token::Word) {
+            fail("очікувалася умова");
+            return 0;
+        }
+
+        Node node;
+        if (accept("signed") || accept("unsigned")) {
+            node.kind = Kind::Signed;
+            node.value = sameWord(previous, "signed") ? 1 : 0;
+            return add(move(node));
+        }
+        if (accept("valid") || accept("invalid")) {
+            node.kind = Kind::Errors;
+            node.op = sameWord(previous, "valid") ? Compare::Ne : Compare::Eq;
+            node.value = DocumentErrorAll;
+            return add(move(node));
+        }
+        if (accept("id")) return parseId();
+        if (accept("format")) return parseFormat();
+        if (accept("content")) {
+            if (!accept("length") && !accept("size")) {
+                fail("очікувалося length після content");
+                return 0;
+            }
+            return parseLength();
+        }
+        if (accept("length") || accept("size")) return parseLength();
+        if (accept("error")) return parseError();
+        if (accept("text")) {
+            if (token.type == Token::Operator && token.op == Compare::Eq) advance();
+            if (token.type != Token::String) {
+                fail("очікувався текстовий запит у лапках");
+                return 0;
+            }
+            node.kind = Kind::Text;
+            node.words.push_back(token.text);
+            advance();
+            return add(move(node));
+        }
+        fail("невідома умова '" + token.text + "'");
+        return 0;
+    }
+
+    bool readOperator(Compare& op, bool orderedAllowed) {
+        if (token.type != Token::Operator) {
+            fail("очікувався оператор порівняння");
+            return false;
+        }
+        op = token.op;
+        if (!orderedAllowed && op != Compare::Eq && op != Compare::Ne) {
+            fail("тут можливі лише = та !=");
+            return false;
+        }
+        advance();
+        return true;
+    }
+
+    bool readNumber(uint64_t& value) {
+        const string& text = token.text;
+        if (token.type != Token::Word || text.empty()
+            || !all_of(text.begin(), text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+            fail("очікувалося ціле число");
+            return false;
+        }
+        errno = 0;
+        value = strtoull(text.c_str(), nullptr, 10);
+        if (errno == ERANGE) {
+            fail("завелике число");
+            return false;
+        }
+        advance();
+        return true;
+    }
+
+    static uint64_t unitScale(const string& unit) {
+        if (unit.empty() || sameWord(unit, "b")) return 1;
+        if (sameWord(unit, "kb") || sameWord(unit, "kib")) return uint64_t(1) << 10;
+        if (sameWord(unit, "mb") || sameWord(unit, "mib")) return uint64_t(1) << 20;
+        if (sameWord(unit, "gb") || sameWord(unit, "gib")) return uint64_t(1) << 30;
+        return 0;
+    }
+
+    // "1536", "1.5KB" or "1.5 KB".
+    bool readSize(uint64_t& bytes) {
+        if (token.type != Token::Word) {
+            fail("очікувався розмір");
+            return false;
+        }
+        const string text = token.text; // advance() replaces the token
+        const size_t offset = token.offset;
+        size_t digits = 0, points = 0;
+        for (; digits < text.size(); ++digits) {
+            if (text[digits] == '.') ++points;
+            else if (!isdigit(static_cast<unsigned char>(text[digits]))) break;
+        }
+        uint64_t scale = unitScale(text.substr(digits));
+        if (digits == points || points > 1 || scale == 0) {
+            fail("очікувався розмір, напр. 512, 4KB чи 1MB");
+            return false;
+        }
+        const string number = text.substr(0, digits);
+        advance();
+        if (digits == text.size() && token.type == Token::Word && unitScale(token.text) > 1) {
+            scale = unitScale(token.text);
+            advance();
+        }
+        bool fits = true;
+        if (points == 0) {
+            // Whole numbers are scaled exactly, up to UINT64_MAX.
+            errno = 0;
+            const uint64_t whole = strtoull(number.c_str(), nullptr, 10);
+            fits = errno != ERANGE && whole <= UINT64_MAX / scale;
+            bytes = whole * scale;
+        } else {
+            // 2^64 is exact in a double; anything rounding to it or above
+            // does not fit.
+            const double scaled = round(strtod(number.c_str(), nullptr) * static_cast<double>(scale));
+            fits = scaled < 18446744073709551616.0;
+            if (fits) bytes = static_cast<uint64_t>(scaled);
+        }
+        if (!fits) {
+            failAt(offset, "завеликий розмір");
+            return false;
+        }
+        return true;
+    }
+
+    size_t parseId() {
+        Node node;
+        node.kind = Kind::Id;
+        if (accept("in")) {
+            uint64_t first = 0, last = 0;
+            if (!expect(Token::OpenRange, "'['") || !readNumber(first) || !expect(Token::Comma, "','")
+                || !readNumber(last) || !expect(Token::CloseRange, "']'")) {
+                return 0;
+            }
+            node.op = Compare::Ge;
+            node.value = first;
+            size_t from = add(node);
+            node.op = Compare::Le;
+            node.value = last;
+            size_t to = add(node);
+            return join(Kind::And, { from, to });
+        }
+        if (!readOperator(node.op, true) || !readNumber(node.value)) return 0;
+        return add(move(node));
+    }
+
+    size_t parseFormat() {
+        Node node;
+        node.kind = Kind::Format;
+        if (accept("in")) {
+            if (!expect(Token::Open, "'('")) return 0;
+            do {
+                if (token.type != Token::Word && token.type != Token::String) {
+                    fail("очікувався формат");
+                    return 0;
+                }
+                node.words.push_back(token.text);
+                advance();
+            } while (token.type == Token::Comma && (advance(), true));
+            if (!expect(Token::Close, "')'")) return 0;
+            return add(move(node));
+        }
+        if (!readOperator(node.op, false)) return 0;
+        if (token.type != Token::Word && token.type != Token::String) {
+            fail("очікувався формат");
+            return 0;
+        }
+        node.words.push_back(token.text);
+        advance();
+        return add(move(node));
+    }
+
+    size_t parseLength() {
+        Node node;
+        node.kind = Kind::Length;
+        if (!readOperator(node.op, true) || !readSize(node.value)) return 0;
+        return add(move(node));
+    }
+
+    size_t parseError() {
+        Node node;
+        node.kind = Kind::Errors;
+        if (!readOperator(node.op, false)) return 0;
+        for (const ErrorName& e : kErrorNames) {
+            if (keyword(e.name)) {
+                node.value = e.mask;
+                advance();
+                return add(move(node));
+            }
+        }
+        fail("невідомий тип помилки; можливі empty_content, not_signed, invalid_format, format_mismatch, any");
+        return 0;
+    }
+
+    const string& input;
+    FilterExpression& expression;
+    size_t pos = 0;
+    Token token;
+    string previous; // the keyword accept() consumed last
+    string failure;
+};
+
+FilterExpression::FilterExpression() : nodes(1) {}
+
+optional<FilterExpression> FilterExpression::parse(const string& text, string* error) {
+    FilterExpression expression;
+    expression.nodes.clear();
+    expression.source = text;
+    if (text.find_first_not_of(" \t\r\n") == string::npos) {
+        if (error) *error = "порожній запит";
+        return nullopt;
+    }
+    Parser parser(text, expression);
+    if (!parser.run(error)) return nullopt;
+    return expression;
+}
+
+void QueryPlan::Batch::clear() {
+    ids.clear();
+    lengths.clear();
+    signedFlags.clear();
+    formats.clear();
+    errors.clear();
+}
+
+QueryPlan::QueryPlan(const DocumentStore& documents, const FilterExpression& filter)
+    : store(documents), errorPolicy(documents.errorPolicy()),
+      nodes(filter.nodes), textMatches(filter.nodes.size()), formatAccepts(filter.nodes.size()) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& node = nodes[i];
+        if (node.kind == Kind::Text) textMatches[i] = store.searchText(node.words[0]);
+        if (node.kind == Kind::Format) {
+            for (const string& name : node.words) {
+                if (find(formatNames.begin(), formatNames.end(), name) == formatNames.end()) formatNames.push_back(name);
+            }
+        }
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].kind != Kind::Format) continue;
+        formatAccepts[i].assign(formatNames.size() + 1, 0);
+        for (const string& name : nodes[i].words) {
+            formatAccepts[i][find(formatNames.begin(), formatNames.end(), name) - formatNames.begin()] = 1;
+        }
+    }
+
+    // The terms every match must satisfy: the root's AND operands, nested
+    // ANDs flattened.
+    vector<size_t> terms;
+    vector<size_t> pending{ nodes.size() - 1 };
+    while (!pending.empty()) {
+        size_t n = pending.back();
+        pending.pop_back();
+        if (nodes[n].kind == Kind::And) {
+            pending.insert(pending.end(), nodes[n].children.rbegin(), nodes[n].children.rend());
+        }
+        else {
+            terms.push_back(n);
+        }
+    }
+
+    vector<size_t> texts;
+    for (size_t n : terms) {
+        const Node& node = nodes[n];
+        if (node.kind == Kind::All) continue;
+        if (node.kind == Kind::Text) {
+            texts.push_back(n);
+            continue;
+        }
+        if (node.kind != Kind::Id || node.op == Compare::Ne) {
+            residual.push_back(n);
+            continue;
+        }
+        const uint64_t v = node.value;
+        switch (node.op) {
+        case Compare::Eq: low = max(low, v); high = min(high, v); break;
+        case Compare::Lt: high = v == 0 ? 0 : min(high, v - 1); break;
+        case Compare::Le: high = min(high, v); break;
+        case Compare::Gt:
+            if (v == UINT64_MAX) high = 0;
+            else low = max(low, v + 1);
+            break;
+        case Compare::Ge: low = max(low, v); break;
+        case Compare::Ne: break;
+        }
+    }
+
+    if (!texts.empty()) {
+        driven = true;
+        candidates = textMatches[texts[0]];
+        for (size_t i = 1; i < texts.size(); ++i) {
+            vector<DocumentId> both;
+            const vector<DocumentId>& other = textMatches[texts[i]];
+            set_intersection(candidates.begin(), candidates.end(), other.begin(), other.end(), back_inserter(both));
+            candidates.swap(both);
+        }
+        auto first = lower_bound(candidates.begin(), candidates.end(), low);
+        auto last = upper_bound(first, candidates.end(), high);
+        candidates = vector<DocumentId>(first, last);
+    }
+
+    for (size_t n : residual) collectColumns(nodes, n);
+}
+
+void QueryPlan::collectColumns(const vector<Node>& all, size_t node) {
+    switch (all[node].kind) {
+    case Kind::Length: columns |= LengthColumn; break;
+    case Kind::Signed: columns |= SignedColumn; break;
+    case Kind::Format: columns |= FormatColumn; break;
+    case Kind::Errors: columns |= ErrorsColumn; break;
+    default: break;
+    }
+    for (size_t child : all[node].children) collectColumns(all, child);
+}
+
+void QueryPlan::addRow(Batch& batch, const Document& doc) const {
+    batch.ids.push_back(doc.id);
+    if (columns & LengthColumn) batch.lengths.push_back(doc.content.length());
+    if (columns & SignedColumn) batch.signedFlags.push_back(doc.isSigned ? 1 : 0);
+    if (columns & FormatColumn) {
+        batch.formats.push_back(static_cast<uint16_t>(find(formatNames.begin(), formatNames.end(), doc.format) - formatNames.begin()));
+    }
+    if (columns & ErrorsColumn) batch.errors.push_back(static_cast<uint8_t>(detectErrors(doc, errorPolicy)));
+}
+
+void QueryPlan::evaluate(size_t node, const Batch& batch, Mask& out) const {
+    const size_t n = batch.size();
+    out.assign((n + 63) / 64, 0);
+    const Node& term = nodes[node];
+    switch (term.kind) {
+    case Kind::All:
+        fillMask(out, n, [](size_t) { return true; });
+        break;
+    case Kind::And:
+    case Kind::Or: {
+        evaluate(term.children[0], batch, out);
+        Mask other;
+        for (size_t c = 1; c < term.children.size(); ++c) {
+            evaluate(term.children[c], batch, other);
+            if (term.kind == Kind::And) {
+                for (size_t w = 0; w < out.size(); ++w) out[w] &= other[w];
+            }
+            else {
+                for (size_t w = 0; w < out.size(); ++w) out[w] |= other[w];
+            }
+        }
+        break;
+    }
+    case Kind::Not:
+        evaluate(term.children[0], batch, out);
+        for (uint64_t& word : out) word = ~word;
+        if (n % 64) out.back() &= (uint64_t(1) << (n % 64)) - 1;
+        break;
+    case Kind::Id:
+    case Kind::Length: {
+        const vector<uint64_t>& column = term.kind == Kind::Id ? batch.ids : batch.lengths;
+        const uint64_t v = term.value;
+        switch (term.op) {
+        case Compare::Eq: compareColumn(column, [v](uint64_t x) { return x == v; }, out); break;
+        case Compare::Ne: compareColumn(column, [v](uint64_t x) { return x != v; }, out); break;
+        case Compare::Lt: compareColumn(column, [v](uint64_t x) { return x < v; }, out); break;
+        case Compare::Le: compareColumn(column, [v](uint64_t x) { return x <= v; }, out); break;
+        case Compare::Gt: compareColumn(column, [v](uint64_t x) { return x > v; }, out); break;
+        case Compare::Ge: compareColumn(column, [v](uint64_t x) { return x >= v; }, out); break;
+        }
+        break;
+    }
+    case Kind::Signed: {
+        const uint8_t* flags = batch.signedFlags.data();
+        const uint8_t wanted = static_cast<uint8_t>(term.value);
+        fillMask(out, n, [&](size_t i) { return flags[i] == wanted; });
+        break;
+    }
+    case Kind::Format: {
+        const uint8_t* accepts = formatAccepts[node].data();
+        const uint16_t* formats = batch.formats.data();
+        const uint8_t negate = term.op == Compare::Ne ? 1 : 0;
+        fillMask(out, n, [&](size_t i) { return (accepts[formats[i]] ^ negate) != 0; });
+        break;
+    }
+    case Kind::Errors: {
+        const uint8_t* errors = batch.errors.data();
+        const unsigned mask = static_cast<unsigned>(term.value);
+        const bool negate = term.op == Compare::Ne;
+        fillMask(out, n, [&](size_t i) { return ((errors[i] & mask) != 0) != negate; });
+        break;
+    }
+    case Kind::Text: {
+        // Both lists ascend, so one merge pass finds the members.
+        const vector<DocumentId>& matches = textMatches[node];
+        auto m = lower_bound(matches.begin(), matches.end(), n ? batch.ids[0] : 0);
+        for (size_t i = 0; i < n && m != matches.end(); ++i) {
+            while (m != matches.end() && *m < batch.ids[i]) ++m;
+            if (m != matches.end() && *m == batch.ids[i]) out[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+        break;
+    }
+    }
+}
+
+PageCursor QueryPlan::forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit) const {
+    PageCursor cursor{ after, false };
+    if (low > high) return cursor;
+    const DocumentId from = max(after, low - 1);
+    if (!driven && residual.empty() && high == UINT64_MAX) return store.forEachPage(visit, from, limit);
+
+    size_t visited = 0;
+    // False once the page is full and a further match has been found.
+    auto emit = [&](const Document& doc) {
+        if (limit != 0 && visited == limit) {
+            cursor.more = true;
+            return false;
+        }
+        visit(doc);
+        cursor.last = doc.id;
+        ++visited;
+        return true;
+    };
+
+    Batch batch;
+    Mask mask, other;
+    auto filterBatch = [&] {
+        if (residual.empty()) {
+            mask.assign((batch.size() + 63) / 64, 0);
+            fillMask(mask, batch.size(), [](size_t) { return true; });
+            return;
+        }
+        evaluate(residual[0], batch, mask);
+        for (size_t r = 1; r < residual.size(); ++r) {
+            evaluate(residual[r], batch, other);
+            for (size_t w = 0; w < mask.size(); ++w) mask[w] &= other[w];
+        }
+    };
+    auto selected = [&](size_t i) { return (mask[i >> 6] >> (i & 63)) & 1; };
+
+    if (driven) {
+        vector<shared_ptr<const Document>> docs;
+        auto it = upper_bound(candidates.begin(), candidates.end(), from);
+        while (it != candidates.end()) {
+            batch.clear();
+            docs.clear();
+            for (; it != candidates.end() && docs.size() < kBatch; ++it) {
+                auto doc = store.find(*it);
+                if (!doc) continue; // removed since the plan was built
+                addRow(batch, *doc);
+                docs.push_back(move(doc));
+            }
+            filterBatch();
+            for (size_t i = 0; i < docs.size(); ++i) {
+                if (selected(i) && !emit(*docs[i])) return cursor;
+            }
+        }
+        return cursor;
+    }
+
+    // A batch's rows are collected in one walk of the store; the matches
+    // are then visited in a second walk over the same stretch of IDs,
+    // which stops at the last match it needs.
+    DocumentId position = from;
+    for (;;) {
+        batch.clear();
+        PageCursor page = store.forEachPage([&](const Document& doc) { addRow(batch, doc); }, position, kBatch);
+        if (batch.size() == 0) break;
+        filterBatch();
+
+        size_t inRange = batch.size();
+        while (inRange > 0 && batch.ids[inRange - 1] > high) --inRange;
+        size_t matched = 0;
+        for (size_t i = 0; i < inRange; ++i) matched += selected(i);
+        const size_t room = limit == 0 ? matched : min(matched, limit - visited);
+        if (room > 0) {
+            size_t row = 0;
+            // Past the batch everything "matches": the store then stops at
+            // the first such row instead of looking for a further match.
+            PageCursor walked = store.forEachPage(visit, position, room, [&](const Document& doc) {
+                while (row < inRange && batch.ids[row] < doc.id) ++row;
+                return row == inRange || (batch.ids[row] == doc.id && selected(row));
+            });
+            cursor.last = walked.last;
+            visited += room;
+        }
+        if (room < matched) {
+            cursor.more = true;
+            return cursor;
+        }
+        if (!page.more || batch.ids.back() >= high) break;
+        position = batch.ids.back();
+        if (limit != 0 && visited == limit) {
+            // Full page: only say `more` if a later row matches.
+            cursor.more = forEachPage([](const Document&) {}, position, 1).last != position;
+            return cursor;
+        }
+    }
+    return cursor;
+}
+
+string QueryPlan::describe() const {
+    if (low > high) return "діапазон ID порожній, документів немає";
+
+    string plan;
+    if (driven) {
+        plan = "текстовий індекс, кандидатів: " + to_string(candidates.size());
+    }
+    else if (low > 1 || high != UINT64_MAX) {
+        plan = "діапазон ID " + to_string(low) + "–" + (high == UINT64_MAX ? string("кінець") : to_string(high));
+    }
+    else {
+        plan = "усі документи за ID";
+    }
+
+    if (residual.empty()) return plan;
+    vector<string> used;
+    if (columns & LengthColumn) used.push_back("розмір");
+    if (columns & SignedColumn) used.push_back("підпис");
+    if (columns & FormatColumn) used.push_back("формат");
+    if (columns & ErrorsColumn) used.push_back("помилки");
+    plan += "; перевірка пакетами по " + to_string(kBatch);
+    if (!used.empty()) {
+        plan += " (";
+        for (size_t i = 0; i < used.size(); ++i) plan += (i ? ", " : "") + used[i];
+        plan += ")";
+    }
+    return plan;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+#include "Document.h"
+#include "DocumentStore.h"
+
+// Filter over document metadata and error categories, written as e.g.
+//
+//     unsigned AND format=docx AND content length > 1MB AND id in [1000, 5000]
+//
+// Terms:
+//     id <op> N, id in [A, B]                  ID, the range is inclusive
+//     format = F, format != F, format in (F, ...)
+//     length <op> SIZE                         also "content length", "size";
+//                                              SIZE is bytes or 4KB, 1MB, 2GiB ... (1024-based)
+//     signed, unsigned
+//     error = E, error != E                    E: empty_content, not_signed,
+//                                              invalid_format, format_mismatch, any
+//     valid, invalid                           no / some error category
+//     text "QUERY"                             full-text query (FullTextIndex.h)
+// joined by NOT, AND and OR (binding in that order) and parentheses. <op>
+// is one of = != < <= > >=; keywords are case-insensitive. Error
+// categories are those of detectErrors(), as used by the menu filters.
+class FilterExpression {
+public:
+    // Matches every document.
+    FilterExpression();
+
+    // nullopt for a malformed expression; `error` then says where and why.
+    static std::optional<FilterExpression> parse(const std::string& text, std::string* error = nullptr);
+
+    const std::string& text() const { return source; }
+
+private:
+    friend class QueryPlan;
+
+    enum class Kind : uint8_t { All, And, Or, Not, Id, Length, Signed, Format, Errors, Text };
+    enum class Compare : uint8_t { Eq, Ne, Lt, Le, Gt, Ge };
+
+    struct Node {
+        Kind kind = Kind::All;
+        Compare op = Compare::Eq; // Format and Errors: Eq or Ne only
+        uint64_t value = 0;       // Id and Length operand, Errors mask, Signed 1/0
+        std::vector<std::string> words; // Format names, the Text query
+        std::vector<size_t> children;   // And, Or, Not
+    };
+
+    class Parser;
+
+    // Children come before their parent; the root is the last node.
+    std::vector<Node> nodes;
+    std::string source;
+};
+
+// A FilterExpression bound to a store. Top-level AND terms on the ID narrow
+// the walk to an ID range, which the store seeks to through its ordered
+// set or shard map; top-level text terms are answered by the full-text
+// index, and its sorted matches then drive the walk instead. Everything
+// else is evaluated on batches of documents: each term fills a bitmask
+// from one metadata column (ID, length, signed flag, format, error
+// categories), and NOT/AND/OR combine the masks word by word.
+//
+// Text terms are searched once, when the plan is built; build a new plan
+// after the store changes.
+class QueryPlan {
+public:
+    QueryPlan(const DocumentStore& documents, const FilterExpression& filter);
+
+    // Same contract as DocumentStore::forEachPage.
+    PageCursor forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit) const;
+    void forEach(const DocumentVisitor& visit) const { forEachPage(visit, 0, 0); }
+
+    // How the plan finds its documents, for the console.
+    std::string describe() const;
+
+private:
+    using Node = FilterExpression::Node;
+    using Kind = FilterExpression::Kind;
+    using Compare = FilterExpression::Compare;
+
+    enum Column : unsigned {
+        LengthColumn = 1u << 0,
+        SignedColumn = 1u << 1,
+        FormatColumn = 1u << 2,
+        ErrorsColumn = 1u << 3,
+    };
+
+    // Metadata of up to kBatch documents in ID order, one vector per column.
+    struct Batch {
+        std::vector<DocumentId> ids;
+        std::vector<uint64_t> lengths;
+        std::vector<uint8_t> signedFlags;
+        std::vector<uint16_t> formats; // index into formatNames, formatNames.size() for others
+        std::vector<uint8_t> errors;
+
+        void clear();
+        size_t size() const { return ids.size(); }
+    };
+    using Mask = std::vector<uint64_t>;
+
+    void collectColumns(const std::vector<Node>& nodes, size_t node);
+    void addRow(Batch& batch, const Document& doc) const;
+    void evaluate(size_t node, const Batch& batch, Mask& out) const;
+
+    const DocumentStore& store;
+    ErrorPolicy errorPolicy;          // of the store's chain when planned
+    std::vector<Node> nodes;
+    std::vector<size_t> residual;     // top-level terms left for the batches
+    DocumentId low = 1, high = UINT64_MAX;
+    bool driven = false;              // walk `candidates` instead of the store
+    std::vector<DocumentId> candidates;
+    std::vector<std::vector<DocumentId>> textMatches; // by node, for Text nodes
+    std::vector<std::string> formatNames;
+    std::vector<std::vector<uint8_t>> formatAccepts;  // by node, for Format nodes
+    unsigned columns = 0;
+};
@@ -0,0 +1,98 @@
+#include "ForbiddenTermsValidator.h"
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+ForbiddenTermsValidator::ForbiddenTermsValidator(const vector<string>& terms)
+    : automaton(terms), configuration(hashConfig(terms)) {}
+
+void ForbiddenTermsValidator::check(const Document& doc, vector<string>& errors) {
+    if (automaton.empty() || doc.content.empty()) return;
+
+    string scratch;
+    const string& text = doc.content.text(scratch);
+
+    AhoCorasick::Match match;
+    if (automaton.findFirst(text, match)) {
+        report(match, errors);
+    }
+}
+
+void ForbiddenTermsValidator::checkParallel(const Document& doc, vector<string>& errors, WorkStealingScheduler& scheduler) {
+    if (automaton.empty() || doc.content.length() < 2 * kPieceBytes) {
+        check(doc, errors);
+        return;
+    }
+
+    string scratch;
+    scanPieces(doc.content.text(scratch), errors, &scheduler, nullptr);
+}
+
+// Bodies under two pieces are scanned in one go: that takes a few
+// milliseconds at most, which is the granularity a deadline gets anyway.
+bool ForbiddenTermsValidator::checkBounded(const Document& doc, vector<string>& errors,
+                                           WorkStealingScheduler* scheduler, const ValidationDeadline& deadline) {
+    if (automaton.empty() || doc.content.length() < 2 * kPieceBytes) {
+        check(doc, errors);
+        return true;
+    }
+
+    string scratch;
+    return scanPieces(doc.content.text(scratch), errors, scheduler, &deadline);
+}
+
+bool ForbiddenTermsValidator::scanPieces(const string& text, vector<string>& errors,
+                                         WorkStealingScheduler* scheduler, const ValidationDeadline* deadline) {
+    const size_t pieces = (text.size() + kPieceBytes - 1) / kPieceBytes;
+    const size_t overlap = automaton.maxTermLength() - 1;
+
+    // Piece k reports matches ending inside it, so the first piece with a
+    // match holds the overall first one; pieces after it are skipped.
+    vector<AhoCorasick::Match> found(pieces);
+    vector<char> scanned(pieces, 0);
+    atomic<size_t> firstHit{ pieces };
+
+    auto scanPiece = [&](size_t k) {
+        if (k > firstHit.load(memory_order_relaxed)) return;
+        if (deadline && deadline->passed()) return;
+
+        size_t begin = k * kPieceBytes;
+        size_t from = begin > overlap ? begin - overlap : 0;
+        size_t end = min(text.size(), begin + kPieceBytes);
+        AhoCorasick::Match match;
+        const bool hit = automaton.findFirst(text.data() + from, end - from, match, begin - from);
+        scanned[k] = 1;
+        if (!hit) return;
+
+        match.offset += from;
+        found[k] = match;
+        size_t current = firstHit.load(memory_order_relaxed);
+        while (k < current && !firstHit.compare_exchange_weak(current, k, memory_order_relaxed)) {}
+    };
+
+    if (scheduler) {
+        TaskGroup group;
+        for (size_t k = 0; k < pieces; ++k) {
+            scheduler->spawn(group, [&scanPiece, k] { scanPiece(k); });
+        }
+        scheduler->wait(group);
+    }
+    else {
+        for (size_t k = 0; k < pieces && firstHit.load(memory_order_relaxed) == pieces; ++k) scanPiece(k);
+    }
+
+    // The verdict stands only if every piece before the first hit (or every
+    // piece, without a hit) was actually scanned.
+    const size_t hit = firstHit.load();
+    for (size_t k = 0; k < min(hit, pieces); ++k) {
+        if (!scanned[k]) return false;
+    }
+    if (hit < pieces) report(found[hit], errors);
+    return true;
+}
+
+void ForbiddenTermsValidator::report(const AhoCorasick::Match& match, vector<string>& errors) const {
+    errors.push_back("- Заборонений термін \"" + automaton.term(match.term)
+        + "\" (позиція " + to_string(match.offset) + ")");
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Validator.h"
+#include "AhoCorasick.h"
+
+// Rejects documents whose content contains any of the banned terms.
+// All terms are compiled into one automaton, so a body is scanned once
+// regardless of how many terms there are; the error names the first
+// matching term and its byte offset.
+// On a scheduler, bodies of several megabytes are scanned in 1 MiB pieces
+// by different workers; the reported match is the same as for one scan.
+// A bounded check polls its deadline before every piece.
+class ForbiddenTermsValidator : public Validator {
+private:
+    static const size_t kPieceBytes = 1 << 20;
+
+    AhoCorasick automaton;
+    uint64_t configuration; // term order decides which term is reported
+
+    void report(const AhoCorasick::Match& match, std::vector<std::string>& errors) const;
+    // Piecewise scan of a large body, parallel when `scheduler` is given.
+    // False if `deadline` passed before every piece that matters was done.
+    bool scanPieces(const std::string& text, std::vector<std::string>& errors,
+                    WorkStealingScheduler* scheduler, const ValidationDeadline* deadline);
+
+public:
+    explicit ForbiddenTermsValidator(const std::vector<std::string>& terms);
+
+    size_t termCount() const { return automaton.termCount(); }
+
+    std::string stableId() const override { return "banned-terms"; }
+    uint64_t configHash() const override { return configuration; }
+    unsigned inputs() const override { return InputContent; }
+
+protected:
+    bool cachesByContent() const override { return true; }
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+    void checkParallel(const Document& doc, std::vector<std::string>& errors, WorkStealingScheduler& scheduler) override;
+    bool checkBounded(const Document& doc, std::vector<std::string>& errors,
+                      WorkStealingScheduler* scheduler, const ValidationDeadline& deadline) override;
+};
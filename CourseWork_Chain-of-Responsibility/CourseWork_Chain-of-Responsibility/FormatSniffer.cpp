@@ -0,0 +1,115 @@
+#include "FormatSniffer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+    uint32_t readLe(const unsigned char* p, int bytes) {
+        uint32_t value = 0;
+        for (int i = bytes - 1; i >= 0; --i) value = value << 8 | p[i];
+        return value;
+    }
+
+    bool hasPrefix(const char* data, size_t size, const char* prefix) {
+        size_t length = strlen(prefix);
+        return size >= length && memcmp(data, prefix, length) == 0;
+    }
+
+    bool looksLikeText(const unsigned char* data, size_t size) {
+        size_t control = 0;
+        for (size_t i = 0; i < size; ++i) {
+            unsigned char c = data[i];
+            if (c == 0) return false;
+            if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != 0x1B) || c == 0x7F) ++control;
+        }
+        // A stray form feed or two is fine; binary data has them everywhere.
+        return control * 100 <= size;
+    }
+
+    // Walks the local file headers ("PK\3\4", name at +30) that fit in the
+    // window and classifies the container by its part names.
+    SniffedFormat sniffZip(const unsigned char* data, size_t size) {
+        size_t pos = 0;
+        while (pos + 30 <= size && memcmp(data + pos, "PK\x03\x04", 4) == 0) {
+            const uint32_t flags = readLe(data + pos + 6, 2);
+            const uint32_t packedSize = readLe(data + pos + 18, 4);
+            const uint32_t nameLength = readLe(data + pos + 26, 2);
+            const uint32_t extraLength = readLe(data + pos + 28, 2);
+            if (pos + 30 + nameLength > size) break;
+
+            const char* name = reinterpret_cast<const char*>(data + pos + 30);
+            if (hasPrefix(name, nameLength, "word/")) return SniffedFormat::Docx;
+            if (hasPrefix(name, nameLength, "ppt/")) return SniffedFormat::Pptx;
+            if (hasPrefix(name, nameLength, "xl/")) return SniffedFormat::Xlsx;
+
+            size_t next = pos + 30 + nameLength + extraLength;
+            if (next >= size) break;
+            if (flags & 0x8) {
+                // Sizes follow the data in a descriptor: look for the next header.
+                const unsigned char* found = search(data + next, data + size, data, data + 4);
+                next = static_cast<size_t>(found - data);
+            }
+            else {
+                next += packedSize;
+            }
+            if (next <= pos) break;
+            pos = next;
+        }
+        return SniffedFormat::Zip;
+    }
+
+    const char* const kTextFormats[] = { "txt", "text", "csv", "md", "log", "json", "xml", "html", "htm" };
+}
+
+SniffedFormat sniffFormat(const char* data, size_t size) {
+    if (size == 0) return SniffedFormat::Empty;
+    size = min(size, kSniffBytes);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    // Readers accept the PDF header anywhere in the first KiB.
+    const char* pdf = "%PDF-";
+    const size_t window = min<size_t>(size, 1024);
+    if (search(data, data + window, pdf, pdf + 5) != data + window) return SniffedFormat::Pdf;
+
+    if (hasPrefix(data, size, "PK\x03\x04")) return sniffZip(bytes, size);
+    if (hasPrefix(data, size, "PK\x05\x06")) return SniffedFormat::Zip; // empty archive
+
+    return looksLikeText(bytes, size) ? SniffedFormat::Text : SniffedFormat::Binary;
+}
+
+const char* sniffedFormatName(SniffedFormat format) {
+    switch (format) {
+    case SniffedFormat::Empty: return "";
+    case SniffedFormat::Text: return "txt";
+    case SniffedFormat::Pdf: return "pdf";
+    case SniffedFormat::Docx: return "docx";
+    case SniffedFormat::Pptx: return "pptx";
+    case SniffedFormat::Xlsx: return "xlsx";
+    case SniffedFormat::Zip: return "zip";
+    case SniffedFormat::Binary: return "binary";
+    }
+    return "";
+}
+
+bool formatMatches(const string& declared, SniffedFormat sniffed) {
+    string format = declared;
+    transform(format.begin(), format.end(), format.begin(), [](char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+    const bool declaredText = find(begin(kTextFormats), end(kTextFormats), format) != end(kTextFormats);
+    const bool declaredOffice = format == "docx" || format == "pptx" || format == "xlsx";
+
+    switch (sniffed) {
+    case SniffedFormat::Empty:
+        return true; // nothing to compare, emptiness is its own error
+    case SniffedFormat::Text:
+        return declaredText;
+    case SniffedFormat::Zip:
+        return format == "zip" || declaredOffice;
+    case SniffedFormat::Binary:
+        return !declaredText && format != "pdf" && format != "zip" && !declaredOffice;
+    default:
+        return format == sniffedFormatName(sniffed);
+    }
+}
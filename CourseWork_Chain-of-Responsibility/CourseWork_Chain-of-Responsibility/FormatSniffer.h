@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Type of a body as told by its first bytes, whatever its declared format.
+enum class SniffedFormat : uint8_t {
+    Empty,
+    Text,    // no NUL bytes and hardly any control characters (UTF-8 or CP1251)
+    Pdf,     // "%PDF-" within the first KiB
+    Docx,    // ZIP container with word/ parts
+    Pptx,    // ZIP container with ppt/ parts
+    Xlsx,    // ZIP container with xl/ parts
+    Zip,     // other ZIP, or an OOXML container whose parts come later
+    Binary,  // none of the above
+};
+
+// Only this much of a body is looked at.
+const size_t kSniffBytes = 4096;
+
+SniffedFormat sniffFormat(const char* data, size_t size);
+// Extension-style name: "txt", "pdf", "docx", "pptx", "xlsx", "zip",
+// "binary" ("" for Empty).
+const char* sniffedFormatName(SniffedFormat format);
+
+// False when the declared format contradicts the sniffed one. Formats the
+// sniffer cannot recognise (e.g. "png") only contradict text or a type it
+// did recognise, never an unrecognised binary.
+bool formatMatches(const std::string& declared, SniffedFormat sniffed);
@@ -0,0 +1,391 @@
+#include "FullTextIndex.h"
+#include <algorithm>
+#include <utility>
+#include "MemoryUsage.h"
+
+using namespace std;
+
+namespace {
+    void putVarint(string& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    uint32_t getVarint(const string& in, size_t& pos) {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            const unsigned char byte = static_cast<unsigned char>(in[pos++]);
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    void skipVarints(const string& in, size_t& pos, uint32_t count) {
+        while (count > 0) {
+            if (!(static_cast<unsigned char>(in[pos++]) & 0x80)) --count;
+        }
+    }
+
+    // The letters of a CP1251 byte (the console and documents.txt encoding on
+    // Windows), U+FFFD for anything else.
+    uint32_t fromCp1251(unsigned char byte) {
+        if (byte >= 0xC0) return 0x410 + (byte - 0xC0);
+        switch (byte) {
+        case 0xA8: return 0x401; // Ё
+        case 0xB8: return 0x451;
+        case 0xAA: return 0x404; // Є
+        case 0xBA: return 0x454;
+        case 0xB2: return 0x406; // І
+        case 0xB3: return 0x456;
+        case 0xAF: return 0x407; // Ї
+        case 0xBF: return 0x457;
+        case 0xA5: return 0x490; // Ґ
+        case 0xB4: return 0x491;
+        case 0x92: return 0x2019;
+        default: return 0xFFFD;
+        }
+    }
+
+    // Code point at `pos`, advancing past it. A byte that does not start a
+    // well-formed UTF-8 sequence is read as CP1251, so both encodings index.
+    uint32_t decodeUtf8(const string& s, size_t& pos) {
+        const unsigned char lead = static_cast<unsigned char>(s[pos]);
+        const size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || pos + length > s.size()) {
+            ++pos;
+            return fromCp1251(lead);
+        }
+        uint32_t cp = length == 1 ? lead : lead & (0x7F >> length);
+        for (size_t i = 1; i < length; ++i) {
+            const unsigned char next = static_cast<unsigned char>(s[pos + i]);
+            if ((next & 0xC0) != 0x80) {
+                ++pos;
+                return fromCp1251(lead);
+            }
+            cp = (cp << 6) | (next & 0x3F);
+        }
+        pos += length;
+        return cp;
+    }
+
+    void encodeUtf8(uint32_t cp, string& out) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    bool isWordChar(uint32_t cp) {
+        return (cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z')
+            || (cp >= 0xC0 && cp <= 0x24F && cp != 0xD7 && cp != 0xF7)
+            || (cp >= 0x370 && cp <= 0x3FF)
+            || (cp >= 0x400 && cp <= 0x52F);
+    }
+
+    bool isApostrophe(uint32_t cp) {
+        return cp == '\'' || cp == 0x2019 || cp == 0x02BC;
+    }
+
+    // Simple case mapping of the scripts isWordChar accepts; in the Latin
+    // Extended-A and most Cyrillic supplement blocks (Ґ, Ѣ, ...) capitals and
+    // small letters alternate.
+    uint32_t toLower(uint32_t cp) {
+        if (cp >= 'A' && cp <= 'Z') return cp + 32;
+        if (cp < 0xC0) return cp;
+        if (cp <= 0xDE) return cp == 0xD7 ? cp : cp + 32;
+        if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177)) return cp | 1;
+        if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) return cp % 2 ? cp + 1 : cp;
+        if (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) return cp + 32;
+        if (cp >= 0x400 && cp <= 0x40F) return cp + 80; // Ѐ..Џ, with Є, І, Ї
+        if (cp >= 0x410 && cp <= 0x42F) return cp + 32;
+        if ((cp >= 0x460 && cp <= 0x481) || (cp >= 0x48A && cp <= 0x4BF) || (cp >= 0x4D0 && cp <= 0x52F)) return cp | 1;
+        if (cp >= 0x4C1 && cp <= 0x4CE) return cp % 2 ? cp + 1 : cp;
+        return cp;
+    }
+
+    vector<uint32_t> intersect(const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        vector<uint32_t> both;
+        set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(both));
+        return both;
+    }
+}
+
+vector<string> FullTextIndex::tokenize(const string& text) {
+    vector<string> tokens;
+    string current;
+    bool apostrophe = false; // seen after a letter, kept if another follows
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const uint32_t cp = decodeUtf8(text, pos);
+        if (isWordChar(cp)) {
+            if (apostrophe) current.push_back('\'');
+            apostrophe = false;
+            encodeUtf8(toLower(cp), current);
+        }
+        else if (isApostrophe(cp) && !current.empty() && !apostrophe) {
+            apostrophe = true;
+        }
+        else {
+            if (!current.empty()) tokens.push_back(move(current));
+            current.clear();
+            apostrophe = false;
+        }
+    }
+    if (!current.empty()) tokens.push_back(move(current));
+    return tokens;
+}
+
+void FullTextIndex::add(DocumentId id, const Content& content) {
+    auto known = live.find(id);
+    if (known != live.end()) {
+        if (known->second.contentHash == content.hash()) return;
+        retire(id);
+    }
+    if (content.empty()) return;
+
+    string scratch;
+    const vector<string> tokens = tokenize(content.text(scratch));
+    if (tokens.empty()) return;
+
+    const uint32_t number = static_cast<uint32_t>(owners.size());
+    owners.push_back(id);
+    live.emplace(id, Version{ number, content.hash() });
+
+    unordered_map<string, vector<uint32_t>> positions;
+    for (uint32_t i = 0; i < tokens.size(); ++i) positions[tokens[i]].push_back(i);
+    for (const auto& term : positions) {
+        auto [entry, created] = terms.try_emplace(term.first);
+        Postings& list = entry->second;
+        if (!created) termBytes -= termFootprint(entry->first, list);
+        putVarint(list.bytes, number - list.last); // the first gap is from 0
+        putVarint(list.bytes, static_cast<uint32_t>(term.second.size()));
+        uint32_t previous = 0;
+        for (uint32_t position : term.second) {
+            putVarint(list.bytes, position - previous);
+            previous = position;
+        }
+        list.last = number;
+        ++list.count;
+        termBytes += termFootprint(entry->first, list);
+    }
+}
+
+void FullTextIndex::remove(DocumentId id) {
+    if (live.count(id)) retire(id);
+}
+
+void FullTextIndex::clear() {
+    terms.clear();
+    owners.clear();
+    live.clear();
+    retired = 0;
+    termBytes = 0;
+}
+
+void FullTextIndex::retire(DocumentId id) {
+    auto it = live.find(id);
+    owners[it->second.number] = 0;
+    live.erase(it);
+    if (++retired > 1024 && retired * 2 > owners.size()) compact();
+}
+
+void FullTextIndex::compact() {
+    const uint32_t kGone = UINT32_MAX;
+    vector<uint32_t> renumber(owners.size(), kGone);
+    vector<DocumentId> kept;
+    kept.reserve(live.size());
+    for (uint32_t n = 0; n < owners.size(); ++n) {
+        if (owners[n] == 0) continue;
+        renumber[n] = static_cast<uint32_t>(kept.size());
+        kept.push_back(owners[n]);
+    }
+
+    termBytes = 0;
+    for (auto it = terms.begin(); it != terms.end();) {
+        const Postings& list = it->second;
+        Postings rebuilt;
+        size_t pos = 0;
+        uint32_t number = 0;
+        for (uint32_t i = 0; i < list.count; ++i) {
+            number += getVarint(list.bytes, pos);
+            const uint32_t occurrences = getVarint(list.bytes, pos);
+            const size_t start = pos;
+            skipVarints(list.bytes, pos, occurrences);
+            if (renumber[number] == kGone) continue;
+
+            // Position gaps are per document, so they are copied as they are.
+            putVarint(rebuilt.bytes, renumber[number] - rebuilt.last);
+            putVarint(rebuilt.bytes, occurrences);
+            rebuilt.bytes.append(list.bytes, start, pos - start);
+            rebuilt.last = renumber[number];
+            ++rebuilt.count;
+        }
+        if (rebuilt.count == 0) {
+            it = terms.erase(it);
+            continue;
+        }
+        rebuilt.bytes.shrink_to_fit();
+        it->second = move(rebuilt);
+        termBytes += termFootprint(it->first, it->second);
+        ++it;
+    }
+
+    owners = move(kept);
+    for (auto& version : live) version.second.number = renumber[version.second.number];
+    retired = 0;
+}
+
+FullTextIndex::Hits FullTextIndex::decode(const Postings& postings, bool withPositions) const {
+    Hits hits;
+    hits.documents.reserve(postings.count);
+    size_t pos = 0;
+    uint32_t number = 0;
+    for (uint32_t i = 0; i < postings.count; ++i) {
+        number += getVarint(postings.bytes, pos);
+        const uint32_t occurrences = getVarint(postings.bytes, pos);
+        if (owners[number] == 0 || !withPositions) {
+            skipVarints(postings.bytes, pos, occurrences);
+            if (owners[number] != 0) hits.documents.push_back(number);
+            continue;
+        }
+        hits.documents.push_back(number);
+        hits.firstPosition.push_back(static_cast<uint32_t>(hits.positions.size()));
+        uint32_t position = 0;
+        for (uint32_t k = 0; k < occurrences; ++k) {
+            position += getVarint(postings.bytes, pos);
+            hits.positions.push_back(position);
+        }
+    }
+    if (withPositions) hits.firstPosition.push_back(static_cast<uint32_t>(hits.positions.size()));
+    return hits;
+}
+
+vector<uint32_t> FullTextIndex::matchTerm(const string& term) const {
+    auto it = terms.find(term);
+    return it == terms.end() ? vector<uint32_t>() : decode(it->second, false).documents;
+}
+
+vector<uint32_t> FullTextIndex::matchPrefix(const string& prefix) const {
+    vector<uint32_t> numbers;
+    for (auto it = terms.lower_bound(prefix); it != terms.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        vector<uint32_t> more = decode(it->second, false).documents;
+        numbers.insert(numbers.end(), more.begin(), more.end());
+    }
+    sort(numbers.begin(), numbers.end());
+    numbers.erase(unique(numbers.begin(), numbers.end()), numbers.end());
+    return numbers;
+}
+
+vector<uint32_t> FullTextIndex::matchPhrase(const vector<string>& words) const {
+    if (words.size() == 1) return matchTerm(words[0]);
+
+    vector<Hits> lists;
+    for (const auto& word : words) {
+        auto it = terms.find(word);
+        if (it == terms.end()) return vector<uint32_t>();
+        lists.push_back(decode(it->second, true));
+    }
+
+    // Merge on document number, then look for word i at position p + i.
+    vector<uint32_t> matches;
+    vector<size_t> cursor(lists.size(), 0);
+    for (size_t d = 0; d < lists[0].documents.size(); ++d) {
+        const uint32_t number = lists[0].documents[d];
+        bool inAll = true;
+        for (size_t w = 1; w < lists.size() && inAll; ++w) {
+            const auto& documents = lists[w].documents;
+            while (cursor[w] < documents.size() && documents[cursor[w]] < number) ++cursor[w];
+            inAll = cursor[w] < documents.size() && documents[cursor[w]] == number;
+        }
+        if (!inAll) continue;
+
+        auto positionsOf = [&](size_t w, size_t entry) {
+            const Hits& hits = lists[w];
+            return make_pair(hits.positions.begin() + hits.firstPosition[entry],
+                             hits.positions.begin() + hits.firstPosition[entry + 1]);
+        };
+        const auto first = positionsOf(0, d);
+        for (auto p = first.first; p != first.second; ++p) {
+            bool phrase = true;
+            for (size_t w = 1; w < lists.size() && phrase; ++w) {
+                const auto range = positionsOf(w, cursor[w]);
+                phrase = binary_search(range.first, range.second, *p + static_cast<uint32_t>(w));
+            }
+            if (phrase) {
+                matches.push_back(number);
+                break;
+            }
+        }
+    }
+    return matches;
+}
+
+vector<DocumentId> FullTextIndex::search(const string& query) const {
+    vector<vector<uint32_t>> parts;
+    size_t pos = 0;
+    while (pos < query.size()) {
+        if (static_cast<unsigned char>(query[pos]) <= ' ') {
+            ++pos;
+            continue;
+        }
+        if (query[pos] == '"') {
+            const size_t close = query.find('"', pos + 1);
+            const string inner = query.substr(pos + 1, close == string::npos ? string::npos : close - pos - 1);
+            pos = close == string::npos ? query.size() : close + 1;
+            vector<string> words = tokenize(inner);
+            if (!words.empty()) parts.push_back(matchPhrase(words));
+            continue;
+        }
+
+        size_t end = pos;
+        while (end < query.size() && static_cast<unsigned char>(query[end]) > ' ' && query[end] != '"') ++end;
+        string word = query.substr(pos, end - pos);
+        pos = end;
+        const bool prefix = word.back() == '*';
+        if (prefix) word.pop_back();
+        vector<string> words = tokenize(word);
+        if (words.empty()) continue;
+        // "e-mail" is a phrase; in "e-mai*" only the last part is a prefix.
+        if (prefix) {
+            parts.push_back(matchPrefix(words.back()));
+            words.pop_back();
+        }
+        if (!words.empty()) parts.push_back(matchPhrase(words));
+    }
+    if (parts.empty()) return vector<DocumentId>();
+
+    sort(parts.begin(), parts.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+    vector<uint32_t> numbers = parts[0];
+    for (size_t i = 1; i < parts.size() && !numbers.empty(); ++i) numbers = intersect(numbers, parts[i]);
+
+    vector<DocumentId> ids;
+    ids.reserve(numbers.size());
+    for (uint32_t number : numbers) ids.push_back(owners[number]);
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+size_t FullTextIndex::termFootprint(const string& term, const Postings& list) {
+    return memory::kTreeNode + sizeof(pair<const string, Postings>) + memory::stringHeap(term) + list.bytes.capacity() + 1;
+}
+
+size_t FullTextIndex::memoryBytes() const {
+    return owners.capacity() * sizeof(DocumentId) + memory::hashMapNodes(live) + termBytes;
+}
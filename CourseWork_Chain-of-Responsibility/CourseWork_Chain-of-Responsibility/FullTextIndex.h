@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "Document.h"
+
+// Inverted index over document content for term, phrase and prefix search.
+//
+// Tokens are runs of letters and digits (Latin, Greek, Cyrillic); an
+// apostrophe between letters stays in the word, as in "зобов'язання",
+// whichever of ' ’ ʼ was typed. Tokens are lowercased per code point, so
+// "ҐАНОК" and "ґанок" are the same term.
+//
+// Every document version gets an internal number that only grows, so a
+// posting list is only ever appended to: varint-coded gaps between
+// numbers, each followed by the term's count and position gaps in that
+// document. Edits and removals retire the old number instead of
+// rewriting lists; once more than half of the numbers are retired, the
+// lists are recoded without them.
+//
+// Queries: words separated by spaces must all occur; "quoted words"
+// must occur next to each other in that order; a trailing * matches any
+// term with that prefix (прав* finds право, правила, ...).
+class FullTextIndex {
+public:
+    // Indexes `content` under `id`, replacing an earlier version; a no-op
+    // if that version had the same text hash.
+    void add(DocumentId id, const Content& content);
+    void remove(DocumentId id);
+    void clear();
+
+    // Matching IDs in ascending order; empty for a query without terms.
+    std::vector<DocumentId> search(const std::string& query) const;
+
+    static std::vector<std::string> tokenize(const std::string& text);
+
+    size_t documentCount() const { return live.size(); }
+    size_t termCount() const { return terms.size(); }
+    // O(1): the terms are counted as they change.
+    size_t memoryBytes() const;
+
+private:
+    struct Postings {
+        std::string bytes;  // see the class comment
+        uint32_t last = 0;  // number of the last document appended
+        uint32_t count = 0; // documents in the list, retired ones included
+    };
+    struct Version {
+        uint32_t number;
+        uint64_t contentHash;
+    };
+    // A posting list decoded for one query.
+    struct Hits {
+        std::vector<uint32_t> documents;
+        std::vector<uint32_t> firstPosition; // into `positions`, one past the end last
+        std::vector<uint32_t> positions;
+    };
+
+    std::map<std::string, Postings> terms; // ordered, for prefix ranges
+    std::vector<DocumentId> owners;        // by number; 0 once retired
+    std::unordered_map<DocumentId, Version> live;
+    size_t retired = 0;
+    size_t termBytes = 0; // termFootprint() of every entry of `terms`
+
+    static size_t termFootprint(const std::string& term, const Postings& list);
+
+    void retire(DocumentId id);
+    void compact();
+    // Documents only, or with positions when `withPositions`.
+    Hits decode(const Postings& postings, bool withPositions) const;
+    std::vector<uint32_t> matchTerm(const std::string& term) const;
+    std::vector<uint32_t> matchPrefix(const std::string& prefix) const;
+    std::vector<uint32_t> matchPhrase(const std::vector<std::string>& words) const;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Validator.h"
+#include "Sha256.h"
+
+// Replaces the trust in Document::isSigned with a check of
+// Document::signature: the lowercase hex HMAC-SHA-256 of the plain content
+// under a key shared with whoever signs the documents, e.g.
+//
+//   openssl dgst -sha256 -mac HMAC -macopt hexkey:$(cat signing.key) body.txt
+//
+// Verdicts are cached on the content body per signature. Bodies are
+// deduplicated by exact text, so an unchanged document (or another copy
+// of the same text with the same signature) is never hashed twice.
+class HmacSignatureValidator : public Validator {
+private:
+    HmacSha256 mac;
+    uint64_t configuration; // fingerprint of the key, never the key itself
+
+    uint64_t cacheKeyFor(const std::string& signature) const;
+
+public:
+    explicit HmacSignatureValidator(const std::string& key);
+
+    // Signature the document should carry for this content.
+    std::string sign(const Content& content) const;
+
+    std::string stableId() const override { return "signature-hmac"; }
+    uint64_t configHash() const override { return configuration; }
+    unsigned inputs() const override { return InputContent | InputSigned; }
+
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+};
+
+// Key file: one line of hex, at least 16 bytes once decoded
+// (`openssl rand -hex 32 > signing.key`).
+bool loadSigningKey(const std::string& path, std::string& key);
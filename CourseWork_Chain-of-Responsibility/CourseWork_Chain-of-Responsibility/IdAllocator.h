@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "Document.h"
+
+// Per-storage source of document IDs. Allocation is a single atomic add,
+// so ingest threads can each reserve a block and hand out IDs from it
+// without touching shared state again.
+//
+// IDs run from 1 to kMaxId: 0 means "no ID", and UINT64_MAX is never
+// used, so the next free ID cannot wrap around to 0.
+class IdAllocator {
+public:
+    static constexpr DocumentId kMaxId = UINT64_MAX - 1;
+
+    static bool valid(DocumentId id) { return id != 0 && id <= kMaxId; }
+
+    // Half-open [first, first + count).
+    struct Range {
+        DocumentId first = 0;
+        size_t count = 0;
+
+        DocumentId operator[](size_t i) const { return first + i; }
+        DocumentId end() const { return first + count; }
+    };
+
+    // 0 once every ID up to kMaxId has been handed out.
+    DocumentId allocate() {
+        Range range = reserve(1);
+        return range.count ? range.first : 0;
+    }
+
+    // Shorter than `count` (possibly empty) when fewer IDs are left.
+    Range reserve(size_t count) {
+        Range range;
+        DocumentId current = next.load(std::memory_order_relaxed);
+        size_t granted;
+        do {
+            granted = static_cast<size_t>(std::min<uint64_t>(count, kMaxId + 1 - current));
+        } while (!next.compare_exchange_weak(current, current + granted, std::memory_order_relaxed));
+        range.first = current;
+        range.count = granted;
+        return range;
+    }
+
+    // Records an ID that arrived from outside (a load, a preassigned ID) so
+    // it is never handed out again. No ID is consumed by this. False, and
+    // nothing recorded, for 0 and IDs above kMaxId.
+    bool observe(DocumentId used) {
+        if (!valid(used)) return false;
+        DocumentId current = next.load(std::memory_order_relaxed);
+        while (used >= current && !next.compare_exchange_weak(current, used + 1, std::memory_order_relaxed)) {}
+        return true;
+    }
+
+    DocumentId peek() const { return next.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<DocumentId> next{ 1 };
+};
@@ -0,0 +1,108 @@
+#include "KllSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+KllSketch::KllSketch(uint32_t sketchK) : k(std::max<uint32_t>(sketchK, 8)) {
+    grow();
+}
+
+// Lower levels get geometrically less room (factor 2/3 per level below the
+// top), which is what keeps the total logarithmic in n.
+size_t KllSketch::capacity(size_t level) const {
+    const size_t depth = levels.size() - level - 1;
+    return static_cast<size_t>(ceil(k * pow(2.0 / 3.0, static_cast<double>(depth)))) + 1;
+}
+
+void KllSketch::grow() {
+    levels.emplace_back();
+    maxSize = 0;
+    for (size_t h = 0; h < levels.size(); ++h) maxSize += capacity(h);
+}
+
+void KllSketch::add(double value) {
+    if (n == 0) minValue = maxValue = value;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    ++n;
+
+    levels[0].push_back(value);
+    if (++size >= maxSize) compress();
+}
+
+void KllSketch::compress() {
+    for (size_t h = 0; h < levels.size(); ++h) {
+        if (levels[h].size() < capacity(h)) continue;
+        if (h + 1 >= levels.size()) grow(); // may reallocate `levels`
+
+        vector<double>& full = levels[h];
+        sort(full.begin(), full.end());
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+
+        // An odd item out stays behind at its level.
+        const size_t pairs = full.size() / 2;
+        const size_t first = full.size() - 2 * pairs + (random & 1);
+        vector<double>& up = levels[h + 1];
+        for (size_t i = 0; i < pairs; ++i) up.push_back(full[first + 2 * i]);
+        full.resize(full.size() - 2 * pairs);
+
+        size = 0;
+        for (const auto& l : levels) size += l.size();
+        if (size < maxSize) break;
+    }
+}
+
+void KllSketch::merge(const KllSketch& other) {
+    if (other.n == 0) return;
+    if (n == 0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    }
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+    n += other.n;
+
+    while (levels.size() < other.levels.size()) grow();
+    for (size_t h = 0; h < other.levels.size(); ++h) {
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        size += other.levels[h].size();
+    }
+    while (size >= maxSize) {
+        const size_t before = size;
+        compress();
+        if (size == before) break; // nothing was over capacity
+    }
+}
+
+double KllSketch::quantile(double q) const {
+    if (n == 0) return 0;
+    if (q <= 0) return minValue;
+    if (q >= 1) return maxValue;
+
+    vector<pair<double, uint64_t>> weighted;
+    weighted.reserve(size);
+    for (size_t h = 0; h < levels.size(); ++h) {
+        for (double value : levels[h]) weighted.emplace_back(value, uint64_t(1) << h);
+    }
+    sort(weighted.begin(), weighted.end());
+
+    uint64_t total = 0;
+    for (const auto& w : weighted) total += w.second;
+    const double target = q * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (const auto& w : weighted) {
+        seen += w.second;
+        if (static_cast<double>(seen) >= target) return w.first;
+    }
+    return maxValue;
+}
+
+size_t KllSketch::memoryBytes() const {
+    size_t bytes = sizeof(*this) + levels.capacity() * sizeof(vector<double>);
+    for (const auto& level : levels) bytes += level.capacity() * sizeof(double);
+    return bytes;
+}
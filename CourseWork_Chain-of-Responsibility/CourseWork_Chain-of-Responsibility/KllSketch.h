@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// KLL quantile sketch (Karnin, Lang, Liberty 2016) over doubles. Level h
+// holds items that each stand for 2^h inputs; a full level is sorted and
+// every other item, from a random start, moves one level up. The memory
+// stays O(k log(n / k)) items, and a quantile's rank is off by about
+// 1.7 / k of the count (1% with the default k = 200).
+// Sketches of separate streams merge into the sketch of their union.
+class KllSketch {
+public:
+    explicit KllSketch(uint32_t k = 200);
+
+    void add(double value);
+    void merge(const KllSketch& other);
+
+    uint64_t count() const { return n; }
+    double min() const { return n ? minValue : 0; }
+    double max() const { return n ? maxValue : 0; }
+    // A value with about q * count() inputs at or below it, q in [0, 1];
+    // 0 for an empty sketch. Exact at q = 0 and q = 1.
+    double quantile(double q) const;
+
+    size_t retained() const { return size; }
+    size_t memoryBytes() const;
+
+private:
+    uint32_t k;
+    uint64_t n = 0;
+    double minValue = 0;
+    double maxValue = 0;
+    std::vector<std::vector<double>> levels;
+    size_t size = 0;         // items over all levels
+    size_t maxSize = 0;      // sum of the level capacities
+    uint64_t random = 0x9E3779B97F4A7C15ull; // xorshift state: runs are reproducible
+
+    size_t capacity(size_t level) const;
+    void grow();
+    void compress();
+};
@@ -0,0 +1,738 @@
+#include "LinearRegex.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+    // A byte outside a valid UTF-8 sequence decodes to kByteUnit + byte.
+    const uint32_t kByteUnit = 0x110000;
+    const uint32_t kLastUnit = kByteUnit + 0xFF;
+    const uint32_t kUnbounded = UINT32_MAX;
+    const int kMaxNesting = 256;
+
+    bool isContinuation(unsigned char b) { return (b & 0xC0) == 0x80; }
+
+    size_t decodeAt(const string& s, size_t pos, uint32_t& unit) {
+        const unsigned char b = static_cast<unsigned char>(s[pos]);
+        if (b < 0x80) {
+            unit = b;
+            return 1;
+        }
+        const size_t len = b >= 0xC2 && b <= 0xDF ? 2 : b >= 0xE0 && b <= 0xEF ? 3 : b >= 0xF0 && b <= 0xF4 ? 4 : 0;
+        if (len == 0 || pos + len > s.size()) {
+            unit = kByteUnit + b;
+            return 1;
+        }
+        uint32_t cp = b & (0x3F >> (len - 1));
+        for (size_t i = 1; i < len; ++i) {
+            const unsigned char c = static_cast<unsigned char>(s[pos + i]);
+            if (!isContinuation(c)) {
+                unit = kByteUnit + b;
+                return 1;
+            }
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        unit = cp;
+        return len;
+    }
+
+    // True unless `pos` is inside a sequence that decodeAt, run from the
+    // start of the text, would have read as one code point.
+    bool unitStartsAt(const string& s, size_t pos) {
+        for (size_t k = 1; k <= 3 && k <= pos; ++k) {
+            if (isContinuation(static_cast<unsigned char>(s[pos - k]))) continue;
+            uint32_t unit;
+            return decodeAt(s, pos - k, unit) <= k;
+        }
+        return true;
+    }
+
+    // \w and \b are ASCII-only in ECMAScript, and every byte of a longer
+    // sequence is >= 0x80, so a byte decides whether its unit is a word one.
+    bool isWordByte(unsigned char b) {
+        return (b >= '0' && b <= '9') || (b >= 'A' && b <= 'Z') || (b >= 'a' && b <= 'z') || b == '_';
+    }
+
+    unsigned char leadByte(uint32_t unit) {
+        if (unit < 0x80) return static_cast<unsigned char>(unit);
+        if (unit < 0x800) return static_cast<unsigned char>(0xC0 | (unit >> 6));
+        if (unit < 0x10000) return static_cast<unsigned char>(0xE0 | (unit >> 12));
+        if (unit < kByteUnit) return static_cast<unsigned char>(0xF0 | (unit >> 18));
+        return static_cast<unsigned char>(unit - kByteUnit);
+    }
+}
+
+struct LinearRegex::ThreadList {
+    vector<uint32_t> dense, sparse;
+    size_t count = 0;
+
+    explicit ThreadList(size_t size) : dense(size), sparse(size) {}
+    bool contains(uint32_t pc) const { return sparse[pc] < count && dense[sparse[pc]] == pc; }
+    void insert(uint32_t pc) {
+        sparse[pc] = static_cast<uint32_t>(count);
+        dense[count++] = pc;
+    }
+};
+
+// Recursive-descent parser into a small tree, then Thompson construction.
+class LinearRegex::Compiler {
+public:
+    Compiler(const string& pattern, LinearRegex& target) : text(pattern), regex(target) {}
+
+    bool run(string& error) {
+        Node root;
+        if (alternation(root) && pos < text.size()) fail("зайва закривна дужка");
+        if (message.empty()) emit(root);
+        if (message.empty() && regex.program.size() >= kMaxProgram) fail("шаблон завеликий після розгортання повторень");
+        if (!message.empty()) {
+            error = message;
+            return false;
+        }
+        push(Op::Match);
+        return true;
+    }
+
+private:
+    struct Node {
+        enum Type : uint8_t { Empty, Unit, Set, Concat, Alternate, Repeat, Begin, End, WordBoundary, NotWordBoundary };
+        Type type = Empty;
+        uint32_t value = 0;            // Unit: code point, Set: index into sets
+        uint32_t min = 0, max = 0;     // Repeat, max may be kUnbounded
+        vector<Node> children;         // Concat, Alternate, Repeat
+    };
+
+    const string& text;
+    LinearRegex& regex;
+    size_t pos = 0;
+    int depth = 0;
+    string message;
+
+    bool fail(const string& what) {
+        if (message.empty()) message = "позиція " + to_string(pos + 1) + ": " + what;
+        return false;
+    }
+    bool atEnd() const { return pos >= text.size(); }
+    char peek() const { return atEnd() ? '\0' : text[pos]; }
+
+    static void normalize(UnitSet& set) {
+        sort(set.begin(), set.end());
+        UnitSet merged;
+        for (const auto& range : set) {
+            if (!merged.empty() && range.first <= merged.back().second + 1) {
+                merged.back().second = max(merged.back().second, range.second);
+            }
+            else {
+                merged.push_back(range);
+            }
+        }
+        set = move(merged);
+    }
+
+    static UnitSet complement(const UnitSet& set) {
+        UnitSet out;
+        uint32_t next = 0;
+        for (const auto& range : set) {
+            if (range.first > next) out.emplace_back(next, range.first - 1);
+            next = range.second + 1;
+        }
+        if (next <= kLastUnit) out.emplace_back(next, kLastUnit);
+        return out;
+    }
+
+    // \d \w \s and their negations, for `letter` in "dDwWsS".
+    static UnitSet builtinSet(char letter) {
+        UnitSet set;
+        switch (letter | 0x20) {
+        case 'd':
+            set = { { '0', '9' } };
+            break;
+        case 'w':
+            set = { { '0', '9' }, { 'A', 'Z' }, { '_', '_' }, { 'a', 'z' } };
+            break;
+        default:
+            set = { { '\t', '\r' }, { ' ', ' ' }, { 0xA0, 0xA0 }, { 0x1680, 0x1680 }, { 0x2000, 0x200A },
+                { 0x2028, 0x2029 }, { 0x202F, 0x202F }, { 0x205F, 0x205F }, { 0x3000, 0x3000 }, { 0xFEFF, 0xFEFF } };
+            break;
+        }
+        return letter >= 'A' && letter <= 'Z' ? complement(set) : set;
+    }
+
+    void setNode(Node& out, UnitSet set) {
+        out.type = Node::Set;
+        out.value = static_cast<uint32_t>(regex.sets.size());
+        regex.sets.push_back(move(set));
+    }
+
+    bool hexDigits(size_t count, uint32_t& value) {
+        value = 0;
+        for (size_t i = 0; i < count; ++i, ++pos) {
+            const char c = peek();
+            const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (digit < 0) return fail("очікується шістнадцяткова цифра");
+            value = value * 16 + static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    // A literal code point, plain or escaped; `pos` is past the backslash
+    // for an escape.
+    bool literal(uint32_t& unit) {
+        pos += decodeAt(text, pos, unit);
+        return true;
+    }
+
+    bool escapedUnit(uint32_t& unit) {
+        const char c = peek();
+        switch (c) {
+        case 't': ++pos; unit = '\t'; return true;
+        case 'n': ++pos; unit = '\n'; return true;
+        case 'r': ++pos; unit = '\r'; return true;
+        case 'f': ++pos; unit = '\f'; return true;
+        case 'v': ++pos; unit = '\v'; return true;
+        case '0': ++pos; unit = 0; return true;
+        case 'x': ++pos; return hexDigits(2, unit);
+        case 'u': ++pos; return hexDigits(4, unit);
+        case 'c': {
+            ++pos;
+            const char letter = peek();
+            if (!((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z'))) return fail("очікується літера після \\c");
+            ++pos;
+            unit = static_cast<uint32_t>(letter) % 32;
+            return true;
+        }
+        default:
+            if (c >= '1' && c <= '9') return fail("зворотні посилання не підтримуються");
+            return literal(unit);
+        }
+    }
+
+    bool alternation(Node& out) {
+        if (++depth > kMaxNesting) return fail("забагато вкладених дужок");
+        Node first;
+        if (!concat(first)) return false;
+        if (peek() == '|') {
+            out.type = Node::Alternate;
+            out.children.push_back(move(first));
+            while (peek() == '|') {
+                ++pos;
+                Node next;
+                if (!concat(next)) return false;
+                out.children.push_back(move(next));
+            }
+        }
+        else {
+            out = move(first);
+        }
+        --depth;
+        return true;
+    }
+
+    bool concat(Node& out) {
+        out.type = Node::Concat;
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            Node item;
+            if (!repeat(item)) return false;
+            out.children.push_back(move(item));
+        }
+        return true;
+    }
+
+    bool isQuantifier() const {
+        const char c = peek();
+        return c == '*' || c == '+' || c == '?' || c == '{';
+    }
+
+    bool count(uint32_t& value) {
+        if (!(peek() >= '0' && peek() <= '9')) return fail("очікується число в {}");
+        uint64_t parsed = 0;
+        while (peek() >= '0' && peek() <= '9') {
+            parsed = min<uint64_t>(parsed * 10 + static_cast<uint64_t>(peek() - '0'), kUnbounded - 1);
+            ++pos;
+        }
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    bool repeat(Node& out) {
+        if (!atom(out)) return false;
+        if (!isQuantifier()) return true;
+        if (out.type == Node::Begin || out.type == Node::End || out.type == Node::WordBoundary || out.type == Node::NotWordBoundary) {
+            return fail("квантифікатор після якоря");
+        }
+
+        Node node;
+        node.type = Node::Repeat;
+        const char c = text[pos++];
+        if (c == '*') node.max = kUnbounded;
+        else if (c == '+') node.min = 1, node.max = kUnbounded;
+        else if (c == '?') node.max = 1;
+        else {
+            if (!count(node.min)) return false;
+            node.max = node.min;
+            if (peek() == ',') {
+                ++pos;
+                if (peek() == '}') node.max = kUnbounded;
+                else if (!count(node.max)) return false;
+            }
+            if (peek() != '}') return fail("очікується }");
+            ++pos;
+            if (node.max < node.min) return fail("у {n,m} n більше за m");
+            if (node.min > kMaxRepeat || (node.max != kUnbounded && node.max > kMaxRepeat)) {
+                return fail("повторень більше за " + to_string(kMaxRepeat));
+            }
+        }
+        if (peek() == '?') ++pos; // lazy: same set of matches
+        if (isQuantifier()) return fail("два квантифікатори поспіль");
+
+        node.children.push_back(move(out));
+        out = move(node);
+        return true;
+    }
+
+    bool atom(Node& out) {
+        const char c = peek();
+        switch (c) {
+        case '(': {
+            ++pos;
+            if (peek() == '?') {
+                if (pos + 1 < text.size() && text[pos + 1] == ':') pos += 2;
+                else return fail("підтримуються лише групи (?:...), без lookaround");
+            }
+            if (!alternation(out)) return false;
+            if (peek() != ')') return fail("немає закривної дужки");
+            ++pos;
+            return true;
+        }
+        case '[':
+            ++pos;
+            return characterClass(out);
+        case '.':
+            ++pos;
+            setNode(out, complement({ { '\n', '\n' }, { '\r', '\r' }, { 0x2028, 0x2029 } }));
+            return true;
+        case '^':
+            ++pos;
+            out.type = Node::Begin;
+            return true;
+        case '$':
+            ++pos;
+            out.type = Node::End;
+            return true;
+        case '*': case '+': case '?': case '{':
+            return fail("квантифікатор без виразу");
+        case '\\': {
+            ++pos;
+            if (atEnd()) return fail("\\ у кінці шаблону");
+            const char e = peek();
+            if (e == 'b' || e == 'B') {
+                ++pos;
+                out.type = e == 'b' ? Node::WordBoundary : Node::NotWordBoundary;
+                return true;
+            }
+            if (strchr("dDwWsS", e)) {
+                ++pos;
+                setNode(out, builtinSet(e));
+                return true;
+            }
+            out.type = Node::Unit;
+            return escapedUnit(out.value);
+        }
+        default:
+            out.type = Node::Unit;
+            return literal(out.value);
+        }
+    }
+
+    // One class member: a code point, or a \d-style set added to `set`.
+    bool classAtom(uint32_t& unit, bool& isSet, UnitSet& set) {
+        isSet = false;
+        if (peek() != '\\') return literal(unit);
+        ++pos;
+        if (atEnd()) return fail("\\ у кінці шаблону");
+        const char e = peek();
+        if (strchr("dDwWsS", e)) {
+            ++pos;
+            UnitSet builtin = builtinSet(e);
+            set.insert(set.end(), builtin.begin(), builtin.end());
+            isSet = true;
+            return true;
+        }
+        if (e == 'b') {
+            ++pos;
+            unit = '\b';
+            return true;
+        }
+        return escapedUnit(unit);
+    }
+
+    bool characterClass(Node& out) {
+        const bool negated = peek() == '^';
+        if (negated) ++pos;
+        UnitSet set;
+        for (;;) {
+            if (atEnd()) return fail("немає ]");
+            if (peek() == ']') {
+                ++pos;
+                break;
+            }
+            uint32_t low = 0;
+            bool isSet = false;
+            if (!classAtom(low, isSet, set)) return false;
+            if (isSet) continue;
+            if (peek() == '-' && pos + 1 < text.size() && text[pos + 1] != ']') {
+                ++pos;
+                uint32_t high = 0;
+                bool highIsSet = false;
+                UnitSet ignored;
+                if (!classAtom(high, highIsSet, ignored)) return false;
+                if (highIsSet || high < low) return fail("некоректний діапазон у []");
+                set.emplace_back(low, high);
+            }
+            else {
+                set.emplace_back(low, low);
+            }
+        }
+        normalize(set);
+        setNode(out, negated ? complement(set) : move(set));
+        return true;
+    }
+
+    size_t push(Op op, uint32_t arg = 0) {
+        regex.program.push_back({ op, arg, 0 });
+        return regex.program.size() - 1;
+    }
+
+    uint32_t here() const { return static_cast<uint32_t>(regex.program.size()); }
+
+    // Stops early once the program is too large; run() reports it.
+    void emit(const Node& node) {
+        auto& program = regex.program;
+        if (program.size() >= kMaxProgram) return;
+        switch (node.type) {
+        case Node::Empty: break;
+        case Node::Unit: push(Op::Unit, node.value); break;
+        case Node::Set: push(Op::Set, node.value); break;
+        case Node::Begin: push(Op::Begin); break;
+        case Node::End: push(Op::End); break;
+        case Node::WordBoundary: push(Op::WordBoundary); break;
+        case Node::NotWordBoundary: push(Op::NotWordBoundary); break;
+        case Node::Concat:
+            for (const auto& child : node.children) emit(child);
+            break;
+        case Node::Alternate: {
+            vector<size_t> exits;
+            for (size_t i = 0; i < node.children.size(); ++i) {
+                if (i + 1 == node.children.size()) {
+                    emit(node.children[i]);
+                    break;
+                }
+                const size_t split = push(Op::Split, here() + 1);
+                emit(node.children[i]);
+                exits.push_back(push(Op::Jump));
+                program[split].alt = here();
+            }
+            for (size_t exit : exits) program[exit].arg = here();
+            break;
+        }
+        case Node::Repeat: {
+            const Node& body = node.children[0];
+            for (uint32_t i = 0; i < node.min && program.size() < kMaxProgram; ++i) emit(body);
+            if (node.max == kUnbounded) {
+                const size_t loop = push(Op::Split, here() + 1);
+                emit(body);
+                push(Op::Jump, static_cast<uint32_t>(loop));
+                program[loop].alt = here();
+            }
+            else {
+                vector<size_t> splits;
+                for (uint32_t i = node.min; i < node.max && program.size() < kMaxProgram; ++i) {
+                    splits.push_back(push(Op::Split, here() + 1));
+                    emit(body);
+                }
+                for (size_t split : splits) program[split].alt = here();
+            }
+            break;
+        }
+        }
+    }
+};
+
+optional<LinearRegex> LinearRegex::compile(const string& pattern, string* error) {
+    LinearRegex regex;
+    string message;
+    if (!Compiler(pattern, regex).run(message)) {
+        if (error) *error = message;
+        return nullopt;
+    }
+    for (const auto& inst : regex.program) {
+        if (inst.op == Op::WordBoundary || inst.op == Op::NotWordBoundary) regex.wordAssertions = true;
+    }
+    regex.buildPrefilter();
+    return regex;
+}
+
+bool LinearRegex::consumes(const Inst& inst, uint32_t unit) const {
+    if (inst.op == Op::Unit) return inst.arg == unit;
+    if (inst.op != Op::Set) return false;
+    const UnitSet& set = sets[inst.arg];
+    auto it = upper_bound(set.begin(), set.end(), make_pair(unit, kUnbounded));
+    return it != set.begin() && prev(it)->second >= unit;
+}
+
+bool LinearRegex::addThreads(ThreadList& list, uint32_t pc, const Context& context, vector<uint32_t>& stack) const {
+    stack.clear();
+    stack.push_back(pc);
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        if (list.contains(pc)) continue;
+        list.insert(pc);
+
+        const Inst& inst = program[pc];
+        switch (inst.op) {
+        case Op::Match: return true;
+        case Op::Jump: stack.push_back(inst.arg); break;
+        case Op::Split:
+            stack.push_back(inst.alt);
+            stack.push_back(inst.arg);
+            break;
+        case Op::Begin: if (context.atStart) stack.push_back(pc + 1); break;
+        case Op::End: if (context.atEnd) stack.push_back(pc + 1); break;
+        case Op::WordBoundary: if (context.prevWord != context.nextWord) stack.push_back(pc + 1); break;
+        case Op::NotWordBoundary: if (context.prevWord == context.nextWord) stack.push_back(pc + 1); break;
+        default: break; // consumes a unit in the next step
+        }
+    }
+    return false;
+}
+
+// Walks everything reachable from the start without consuming, taking
+// every assertion as satisfied, and collects the first bytes of the units
+// the walk can consume.
+void LinearRegex::buildPrefilter() {
+    startsMatch.fill(false);
+    auto mark = [this](uint32_t low, uint32_t high) {
+        static const pair<uint32_t, uint32_t> kLengths[] = {
+            { 0, 0x7F }, { 0x80, 0x7FF }, { 0x800, 0xFFFF }, { 0x10000, 0x10FFFF }, { kByteUnit, kLastUnit } };
+        for (const auto& length : kLengths) {
+            const uint32_t from = max(low, length.first), to = min(high, length.second);
+            if (from > to) continue;
+            for (unsigned b = leadByte(from); b <= leadByte(to); ++b) startsMatch[b] = true;
+        }
+    };
+
+    vector<bool> seen(program.size(), false);
+    vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const uint32_t pc = stack.back();
+        stack.pop_back();
+        if (seen[pc]) continue;
+        seen[pc] = true;
+        const Inst& inst = program[pc];
+        switch (inst.op) {
+        case Op::Match: return; // an empty match: no prefilter
+        case Op::Unit: mark(inst.arg, inst.arg); break;
+        case Op::Set:
+            for (const auto& range : sets[inst.arg]) mark(range.first, range.second);
+            break;
+        case Op::Jump: stack.push_back(inst.arg); break;
+        case Op::Split:
+            stack.push_back(inst.alt);
+            stack.push_back(inst.arg);
+            break;
+        default: stack.push_back(pc + 1); break;
+        }
+    }
+
+    for (unsigned b = 0; b < 256; ++b) {
+        if (startsMatch[b]) startBytes.push_back(static_cast<unsigned char>(b));
+    }
+    prefilter = startBytes.size() < 256;
+}
+
+size_t LinearRegex::skipToCandidate(const string& text, size_t pos) const {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t n = text.size();
+    while (pos < n) {
+        if (startBytes.size() == 1) {
+            const void* hit = memchr(data + pos, startBytes[0], n - pos);
+            if (!hit) return n;
+            pos = static_cast<const unsigned char*>(hit) - data;
+        }
+        else {
+            while (pos < n && !startsMatch[data[pos]]) ++pos;
+            if (pos == n) return n;
+        }
+        // Only a byte that decodeAt would reach on its own starts a unit.
+        if (!isContinuation(data[pos]) || unitStartsAt(text, pos)) return pos;
+        ++pos;
+    }
+    return n;
+}
+
+LinearRegex::Context LinearRegex::contextAt(const string& text, size_t pos) {
+    Context context;
+    context.atStart = pos == 0;
+    context.atEnd = pos == text.size();
+    context.prevWord = pos > 0 && isWordByte(static_cast<unsigned char>(text[pos - 1]));
+    context.nextWord = pos < text.size() && isWordByte(static_cast<unsigned char>(text[pos]));
+    return context;
+}
+
+// Thread sets between two positions inside the text, where ^ and $ never
+// hold, keyed by their consuming instructions. A state already includes
+// the attempt that starts at its position.
+class LinearRegex::Dfa {
+public:
+    static const int32_t kUnknown = -1;
+    static const int32_t kMatched = -2;
+
+    explicit Dfa(const LinearRegex& owner)
+        : regex(owner), scratch(owner.program.size()) {
+        reset();
+    }
+
+    int32_t startState() const { return start; }
+
+    int32_t intern(const ThreadList& list) {
+        vector<uint32_t> pcs;
+        for (size_t i = 0; i < list.count; ++i) {
+            const Op op = regex.program[list.dense[i]].op;
+            if (op == Op::Unit || op == Op::Set) pcs.push_back(list.dense[i]);
+        }
+        sort(pcs.begin(), pcs.end());
+        return internSorted(move(pcs));
+    }
+
+    void load(int32_t state, ThreadList& list) const {
+        list.count = 0;
+        for (uint32_t pc : states[state].pcs) list.insert(pc);
+    }
+
+    // kMatched if a match ends right after `unit`. May start the cache
+    // over, so ids other than the returned one are stale afterwards.
+    int32_t next(int32_t state, uint32_t unit) {
+        int32_t cached = lookup(state, unit);
+        if (cached != kUnknown) return cached;
+
+        if (states.size() >= kMaxDfaStates) {
+            vector<uint32_t> pcs = states[state].pcs;
+            reset();
+            state = internSorted(move(pcs));
+        }
+        const Context interior;
+        scratch.count = 0;
+        bool matched = false;
+        for (uint32_t pc : states[state].pcs) {
+            if (regex.consumes(regex.program[pc], unit) && regex.addThreads(scratch, pc + 1, interior, stack)) {
+                matched = true;
+                break;
+            }
+        }
+        matched = matched || regex.addThreads(scratch, 0, interior, stack);
+        const int32_t target = matched ? kMatched : intern(scratch);
+        if (unit < 128) states[state].ascii[unit] = target;
+        else wide[key(state, unit)] = target;
+        return target;
+    }
+
+private:
+    struct State {
+        vector<uint32_t> pcs;
+        array<int32_t, 128> ascii;
+    };
+
+    const LinearRegex& regex;
+    vector<State> states;
+    map<vector<uint32_t>, int32_t> ids;
+    unordered_map<uint64_t, int32_t> wide; // transitions on code points >= 128
+    int32_t start = 0;
+    ThreadList scratch;
+    vector<uint32_t> stack;
+
+    static uint64_t key(int32_t state, uint32_t unit) { return (static_cast<uint64_t>(state) << 21) | unit; }
+
+    int32_t lookup(int32_t state, uint32_t unit) const {
+        if (unit < 128) return states[state].ascii[unit];
+        auto it = wide.find(key(state, unit));
+        return it == wide.end() ? kUnknown : it->second;
+    }
+
+    int32_t internSorted(vector<uint32_t> pcs) {
+        auto it = ids.find(pcs);
+        if (it != ids.end()) return it->second;
+        const int32_t id = static_cast<int32_t>(states.size());
+        states.push_back(State{ pcs, {} });
+        states.back().ascii.fill(kUnknown);
+        ids.emplace(move(pcs), id);
+        return id;
+    }
+
+    void reset() {
+        states.clear();
+        ids.clear();
+        wide.clear();
+        scratch.count = 0;
+        regex.addThreads(scratch, 0, Context(), stack); // cannot match: see search()
+        start = intern(scratch);
+    }
+};
+
+optional<bool> LinearRegex::search(const string& text, const ValidationDeadline* deadline) const {
+    const size_t n = text.size();
+    ThreadList current(program.size()), next(program.size());
+    vector<uint32_t> stack;
+    // `current` holds the threads at `pos`, the attempt starting there
+    // included, unless `state` says which DFA state holds them.
+    if (addThreads(current, 0, contextAt(text, 0), stack)) return true;
+    optional<Dfa> dfa;
+    int32_t state = Dfa::kUnknown;
+    size_t nextPoll = kPollBytes;
+
+    for (size_t pos = 0; pos < n;) {
+        if (pos >= nextPoll) {
+            if (deadline && deadline->passed()) return nullopt;
+            nextPoll = pos + kPollBytes;
+        }
+        uint32_t unit = 0;
+        const size_t after = pos + decodeAt(text, pos, unit);
+
+        // Between two interior positions only \b and \B could see more
+        // than the thread set. An empty match would have been found at
+        // position 0, so the start state never matches by itself.
+        if (!wordAssertions && after < n) {
+            if (!dfa) dfa.emplace(*this);
+            if (state == Dfa::kUnknown) state = dfa->intern(current);
+            state = dfa->next(state, unit);
+            if (state == Dfa::kMatched) return true;
+            pos = after;
+            if (prefilter && state == dfa->startState()) pos = skipToCandidate(text, pos);
+            continue;
+        }
+
+        if (state != Dfa::kUnknown) {
+            dfa->load(state, current);
+            state = Dfa::kUnknown;
+        }
+        const Context there = contextAt(text, after);
+        next.count = 0;
+        for (size_t i = 0; i < current.count; ++i) {
+            const uint32_t pc = current.dense[i];
+            if (consumes(program[pc], unit) && addThreads(next, pc + 1, there, stack)) return true;
+        }
+        pos = after;
+        if (prefilter && next.count == 0 && pos < n) {
+            pos = skipToCandidate(text, pos);
+            if (pos == n) return false;
+            if (addThreads(next, 0, contextAt(text, pos), stack)) return true;
+        }
+        else if (addThreads(next, 0, there, stack)) {
+            return true;
+        }
+        swap(current, next);
+    }
+    return false;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "Cancellation.h"
+
+// Regular expression search in time linear in the text, for ban-regex
+// rules. The pattern is compiled to an NFA that is simulated one code
+// point at a time with the set of live states, never by backtracking, so
+// no pattern and no input can make it recurse or take exponential time.
+// State sets met during a search are cached as DFA states with their
+// transitions (at most kMaxDfaStates, then the cache starts over), so a
+// long text mostly costs one table lookup per code point.
+//
+// Syntax is the ECMAScript subset without backreferences and lookaround:
+//     literals, ".", [...] and [^...] with ranges, \d \D \w \W \s \S,
+//     \t \n \r \f \v \0 \xHH \uHHHH, groups (...) and (?:...), "|",
+//     * + ? {n} {n,} {n,m} (a trailing "?" for laziness is accepted and
+//     changes nothing, as only the existence of a match is reported),
+//     ^ $ \b \B (not multiline).
+// Text and pattern are read as UTF-8; a byte that does not start a valid
+// sequence stands for itself, so CP1251 patterns still match CP1251 text.
+class LinearRegex {
+public:
+    // nullopt for a pattern outside the subset; `error` then says why.
+    static std::optional<LinearRegex> compile(const std::string& pattern, std::string* error = nullptr);
+
+    // True if the pattern matches anywhere in `text`; nullopt if `deadline`
+    // passed first. The deadline is polled every kPollBytes.
+    std::optional<bool> search(const std::string& text, const ValidationDeadline* deadline = nullptr) const;
+
+    static const size_t kPollBytes = 1 << 20;
+    static const uint32_t kMaxRepeat = 1000;       // bound of {n,m}
+    static const size_t kMaxProgram = 1 << 16;     // instructions after expanding repeats
+    static const size_t kMaxDfaStates = 4096;
+
+private:
+    enum class Op : uint8_t { Unit, Set, Split, Jump, Begin, End, WordBoundary, NotWordBoundary, Match };
+
+    struct Inst {
+        Op op = Op::Match;
+        uint32_t arg = 0;  // Unit: the code point, Set: index into sets, Split/Jump: target
+        uint32_t alt = 0;  // Split: second target
+    };
+    // Sorted, non-overlapping inclusive ranges of code points.
+    using UnitSet = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    struct Context {
+        bool atStart = false, atEnd = false;
+        bool prevWord = false, nextWord = false;
+    };
+
+    class Compiler;
+    struct ThreadList;
+    class Dfa;
+
+    LinearRegex() = default;
+
+    bool consumes(const Inst& inst, uint32_t unit) const;
+    // Adds `pc` and everything reachable from it without consuming; true
+    // once Match is reached.
+    bool addThreads(ThreadList& list, uint32_t pc, const Context& context, std::vector<uint32_t>& stack) const;
+    void buildPrefilter();
+    size_t skipToCandidate(const std::string& text, size_t pos) const;
+    static Context contextAt(const std::string& text, size_t pos);
+
+    std::vector<Inst> program;
+    std::vector<UnitSet> sets;
+    // \b and \B depend on the neighbouring code points, which a DFA state
+    // does not record; such patterns are only simulated.
+    bool wordAssertions = false;
+    // Bytes that can start a match; only used when every match consumes
+    // at least one code point.
+    bool prefilter = false;
+    std::array<bool, 256> startsMatch{};
+    std::vector<unsigned char> startBytes;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+// Heap bytes held by a document store, by kind. Figures are computed from
+// object sizes and capacities plus typical allocator layouts (node headers,
+// control blocks), so they are estimates, not allocator statistics.
+struct MemoryUsage {
+    size_t documents = 0;     // Document objects
+    size_t content = 0;       // distinct bodies: body objects plus text or compressed block
+    size_t formats = 0;       // format and signature strings too long for the small-string buffer
+    size_t nodes = 0;         // tree/hash nodes, bucket arrays, pool vectors
+    size_t controlBlocks = 0; // shared_ptr control blocks
+    size_t caches = 0;        // verdict caches on bodies and per-link verdicts
+    size_t indexes = 0;       // full-text index, once built
+
+    size_t total() const { return documents + content + formats + nodes + controlBlocks + caches + indexes; }
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        documents += other.documents;
+        content += other.content;
+        formats += other.formats;
+        nodes += other.nodes;
+        controlBlocks += other.controlBlocks;
+        caches += other.caches;
+        indexes += other.indexes;
+        return *this;
+    }
+};
+
+namespace memory {
+    // make_shared control block: vtable pointer plus use and weak counts.
+    const size_t kControlBlock = sizeof(void*) + 2 * sizeof(int);
+    // Red-black tree node header: parent, left, right and colour.
+    const size_t kTreeNode = 4 * sizeof(void*);
+    // Hash node header: next pointer and cached hash.
+    const size_t kHashNode = 2 * sizeof(void*);
+
+    // Strings up to 15 chars live inside the object on the common standard
+    // libraries (SSO) and cost nothing extra.
+    inline size_t stringHeap(const std::string& s) {
+        return s.capacity() > 15 ? s.capacity() + 1 : 0;
+    }
+
+    inline size_t errorsHeap(const std::vector<std::string>& errors) {
+        size_t bytes = errors.capacity() * sizeof(std::string);
+        for (const auto& e : errors) bytes += stringHeap(e);
+        return bytes;
+    }
+
+    // Nodes and bucket array, not what the values point to.
+    template <typename Key, typename Value>
+    size_t hashMapNodes(const std::unordered_map<Key, Value>& map) {
+        using Entry = typename std::unordered_map<Key, Value>::value_type;
+        return map.bucket_count() * sizeof(void*) + map.size() * (kHashNode + sizeof(Entry));
+    }
+}
@@ -0,0 +1,208 @@
+#include "NearDuplicateValidator.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    // splitmix64 finaliser: FNV-1a alone leaves the top bits, which pick
+    // the bin, poorly mixed for short inputs.
+    uint64_t mix(uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBull;
+        return h ^ (h >> 31);
+    }
+
+    const uint32_t kRotation = 0x9E3779B9u; // offset of a value borrowed per bin of distance
+}
+
+NearDuplicateValidator::NearDuplicateValidator(double similarity, size_t shingle)
+    : threshold(min(max(similarity, 0.01), 1.0)), shingleLength(max<size_t>(shingle, 1)) {
+    // Pairs at the threshold should nearly always share a band: take the
+    // most rows per band whose LSH threshold, (1/b)^(1/r), stays below it.
+    size_t rows = 1;
+    for (size_t r = 2; r < kSignatureSize; r *= 2) {
+        if (pow(1.0 / static_cast<double>(kSignatureSize / r), 1.0 / static_cast<double>(r)) < threshold - 0.05) rows = r;
+    }
+    bands = kSignatureSize / rows;
+    buckets.resize(bands);
+}
+
+uint64_t NearDuplicateValidator::configHash() const {
+    return hashConfig({ to_string(threshold), to_string(shingleLength) });
+}
+
+NearDuplicateValidator::Signature NearDuplicateValidator::sign(const Content& content) const {
+    if (content.empty()) return Signature();
+    string scratch;
+    const string& text = content.text(scratch);
+
+    Signature signature(kSignatureSize, 0);
+    vector<char> filled(kSignatureSize, 0);
+    auto add = [&](size_t from, size_t to) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = from; i < to; ++i) h = (h ^ static_cast<unsigned char>(text[i])) * 1099511628211ull;
+        h = mix(h);
+        const size_t bin = static_cast<size_t>(h >> 57); // top 7 bits, 128 bins
+        const uint32_t value = static_cast<uint32_t>(h);
+        if (!filled[bin] || value < signature[bin]) {
+            signature[bin] = value;
+            filled[bin] = 1;
+        }
+    };
+
+    // Shingles are windows of code points, so Cyrillic text is cut between
+    // letters; `starts` keeps the offsets of the last shingleLength ones.
+    vector<size_t> starts(shingleLength);
+    size_t codePoints = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && (static_cast<unsigned char>(text[i]) & 0xC0) == 0x80) continue;
+        if (codePoints >= shingleLength) add(starts[codePoints % shingleLength], i);
+        if (i == text.size()) break;
+        starts[codePoints % shingleLength] = i;
+        ++codePoints;
+    }
+    if (codePoints < shingleLength) add(0, text.size());
+
+    // Rotation densification: an empty bin takes the next filled one's value.
+    for (size_t bin = 0; bin < kSignatureSize; ++bin) {
+        if (filled[bin]) continue;
+        for (size_t step = 1; step < kSignatureSize; ++step) {
+            const size_t from = (bin + step) % kSignatureSize;
+            if (filled[from]) {
+                signature[bin] = signature[from] + static_cast<uint32_t>(step) * kRotation;
+                break;
+            }
+        }
+    }
+    return signature;
+}
+
+double NearDuplicateValidator::similarity(const Signature& a, const Signature& b) {
+    if (a.empty() || a.size() != b.size()) return 0;
+    size_t equal = 0;
+    for (size_t i = 0; i < a.size(); ++i) equal += a[i] == b[i];
+    return static_cast<double>(equal) / static_cast<double>(a.size());
+}
+
+size_t NearDuplicateValidator::indexedCount() const {
+    return entries.size();
+}
+
+uint64_t NearDuplicateValidator::bandKey(const Signature& signature, size_t band) const {
+    const size_t rows = kSignatureSize / bands;
+    uint64_t h = 14695981039346656037ull ^ band;
+    for (size_t i = band * rows; i < (band + 1) * rows; ++i) {
+        h = (h ^ signature[i]) * 1099511628211ull;
+    }
+    return mix(h);
+}
+
+void NearDuplicateValidator::corpusAdded(const Document& doc) {
+    if (doc.id == 0 || doc.content.empty()) return;
+
+    auto it = entries.find(doc.id);
+    if (it != entries.end()) {
+        if (it->second.contentHash == doc.content.hash()) return; // e.g. a shard loaded again
+        unindex(doc.id, it->second);
+        entries.erase(it);
+    }
+
+    Entry entry;
+    entry.contentHash = doc.content.hash();
+    entry.signature = sign(doc.content);
+    entry.slots.resize(bands);
+    for (size_t band = 0; band < bands; ++band) {
+        Bucket& bucket = buckets[band][bandKey(entry.signature, band)];
+        if (bucket.ids.size() < kMaxCandidates) {
+            entry.slots[band] = static_cast<uint32_t>(bucket.ids.size());
+            bucket.ids.push_back(doc.id);
+        }
+        else {
+            entry.slots[band] = static_cast<uint32_t>(kMaxCandidates + bucket.overflow.size());
+            bucket.overflow.push_back(doc.id);
+        }
+    }
+    entries.emplace(doc.id, move(entry));
+}
+
+void NearDuplicateValidator::corpusRemoved(const Document& doc) {
+    auto it = entries.find(doc.id);
+    if (it == entries.end()) return;
+    unindex(doc.id, it->second);
+    entries.erase(it);
+}
+
+void NearDuplicateValidator::corpusCleared() {
+    entries.clear();
+    for (auto& table : buckets) table.clear();
+}
+
+void NearDuplicateValidator::unindex(DocumentId id, const Entry& entry) {
+    for (size_t band = 0; band < bands; ++band) {
+        auto found = buckets[band].find(bandKey(entry.signature, band));
+        Bucket& bucket = found->second;
+        uint32_t slot = entry.slots[band];
+        const bool overflowed = slot >= kMaxCandidates;
+        auto& list = overflowed ? bucket.overflow : bucket.ids;
+        if (overflowed) slot -= static_cast<uint32_t>(kMaxCandidates);
+
+        // The freed slot takes the last ID of the overflow if there is
+        // one, otherwise that of its own list.
+        auto& donor = !overflowed && !bucket.overflow.empty() ? bucket.overflow : list;
+        const DocumentId moved = donor.back();
+        donor.pop_back();
+        if (moved != id) {
+            list[slot] = moved;
+            entries.at(moved).slots[band] = static_cast<uint32_t>(overflowed ? kMaxCandidates + slot : slot);
+        }
+        if (bucket.ids.empty()) buckets[band].erase(found);
+    }
+}
+
+void NearDuplicateValidator::check(const Document& doc, vector<string>& errors) {
+    if (doc.content.empty()) return;
+
+    // A stored document was signed when it was indexed.
+    Signature own;
+    const Signature* signature = &own;
+    auto indexed = entries.find(doc.id);
+    if (doc.id != 0 && indexed != entries.end() && indexed->second.contentHash == doc.content.hash()) {
+        signature = &indexed->second.signature;
+    }
+    else {
+        own = sign(doc.content);
+    }
+
+    // Only earlier documents count, so the first copy stays valid. An
+    // unstored document (ID 0) is compared with the whole corpus.
+    vector<DocumentId> candidates;
+    for (size_t band = 0; band < bands && candidates.size() < kMaxCandidates; ++band) {
+        auto bucket = buckets[band].find(bandKey(*signature, band));
+        if (bucket == buckets[band].end()) continue;
+        for (DocumentId id : bucket->second.ids) {
+            if (id == doc.id || (doc.id != 0 && id > doc.id)) continue;
+            candidates.push_back(id);
+            if (candidates.size() == kMaxCandidates) break;
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    DocumentId best = 0;
+    double bestSimilarity = 0;
+    for (DocumentId id : candidates) {
+        const double s = similarity(*signature, entries.at(id).signature);
+        if (s > bestSimilarity) { // ascending IDs: ties keep the earliest
+            best = id;
+            bestSimilarity = s;
+        }
+    }
+    if (best != 0 && bestSimilarity >= threshold) {
+        errors.push_back("- Майже дублікат документа ID " + to_string(best) + " (схожість "
+            + to_string(static_cast<int>(bestSimilarity * 100)) + "%)");
+    }
+}
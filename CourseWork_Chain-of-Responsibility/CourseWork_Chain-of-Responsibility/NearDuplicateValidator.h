@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "Validator.h"
+
+// Flags resubmissions: documents whose content is nearly the same as that
+// of a stored document with a lower ID (an edited date or name). Similarity
+// is the Jaccard index of the sets of `shingle`-code-point substrings,
+// estimated from 128-value MinHash signatures; a document at or above
+// `similarity` gets "- Майже дублікат документа ID n (схожість p%)" with
+// the most similar earlier document.
+//
+// Signatures are one-permutation MinHash (each shingle hash lands in one of
+// the 128 bins, empty bins are filled by rotation), so signing costs one
+// hash per shingle. The stored corpus is indexed through the corpus hooks
+// with LSH: signatures are cut into bands, and only documents sharing a
+// whole band with the checked one are compared, at most kMaxCandidates of
+// them. A check reads at most kMaxCandidates IDs of a bucket; further
+// documents wait in its overflow list and move up as those leave. Every
+// entry remembers its slot in each bucket, so removing a document is
+// O(bands), and neither a check nor an update depends on the corpus size.
+//
+// One index serves every store using the chain, so the shards of a
+// ShardedDocumentStorage share it. The sharded store loads every shard once
+// when the chain is set, so the index covers the whole corpus before the
+// first check; that pass is repeated on every start, as the index is not
+// saved. Entries stay when their shard is evicted: the index costs about
+// 1.4 KiB per document (the 512-byte signature, hash-map nodes and a
+// bucket slot per band) for the whole corpus, outside the memory budget.
+class NearDuplicateValidator : public Validator {
+public:
+    static const size_t kSignatureSize = 128;
+    static const size_t kMaxCandidates = 256;
+    using Signature = std::vector<uint32_t>;
+
+    // `similarity` in (0, 1]; `shingle` code points, at least 1.
+    NearDuplicateValidator(double similarity, size_t shingle);
+
+    // Empty for empty content.
+    Signature sign(const Content& content) const;
+    // Fraction of equal signature values, the Jaccard estimate.
+    static double similarity(const Signature& a, const Signature& b);
+
+    size_t indexedCount() const;
+    size_t bandCount() const { return bands; }
+
+    std::string stableId() const override { return "near-duplicates"; }
+    uint64_t configHash() const override;
+    unsigned inputs() const override { return InputContent; }
+
+    bool tracksCorpus() const override { return true; }
+    void corpusAdded(const Document& doc) override;
+    void corpusRemoved(const Document& doc) override;
+    void corpusCleared() override;
+
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+
+private:
+    struct Entry {
+        uint64_t contentHash = 0; // Content::hash() the signature was made from
+        Signature signature;
+        // Per band: index in the bucket's `ids`, or kMaxCandidates plus the
+        // index in its `overflow`.
+        std::vector<uint32_t> slots;
+    };
+    struct Bucket {
+        std::vector<DocumentId> ids;      // what checks read, kMaxCandidates at most
+        std::vector<DocumentId> overflow;
+    };
+
+    double threshold;
+    size_t shingleLength;
+    size_t bands; // of kSignatureSize / bands rows each, chosen from the threshold
+
+    // Checks only read these, and hooks never overlap checks (see Validator).
+    std::unordered_map<DocumentId, Entry> entries;
+    std::vector<std::unordered_map<uint64_t, Bucket>> buckets; // per band: band hash -> IDs
+
+    uint64_t bandKey(const Signature& signature, size_t band) const;
+    // Fills each freed slot from the overflow, or else with the last ID.
+    void unindex(DocumentId id, const Entry& entry);
+};
@@ -0,0 +1,290 @@
+#include "Sha256.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHA256_TARGET
+#else
+#include <cpuid.h>
+#define SHA256_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+#endif
+
+using namespace std;
+
+namespace {
+    const uint32_t kRound[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    const uint32_t kInitial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compressScalar(uint32_t state[8], const uint8_t* blocks, size_t count) {
+        uint32_t w[64];
+        for (; count > 0; --count, blocks += 64) {
+            for (int i = 0; i < 16; ++i) {
+                const uint8_t* p = blocks + 4 * i;
+                w[i] = uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+            }
+            for (int i = 16; i < 64; ++i) {
+                uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#ifdef SHA256_X86
+    bool cpuHasShaNi() {
+        unsigned leaf1[4] = {}, leaf7[4] = {};
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) return false;
+        __cpuid(regs, 1);
+        memcpy(leaf1, regs, sizeof(regs));
+        __cpuidex(regs, 7, 0);
+        memcpy(leaf7, regs, sizeof(regs));
+#else
+        if (__get_cpuid_max(0, nullptr) < 7) return false;
+        __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+        const bool ssse3 = (leaf1[2] >> 9) & 1;
+        const bool sse41 = (leaf1[2] >> 19) & 1;
+        const bool sha = (leaf7[1] >> 29) & 1;
+        return ssse3 && sse41 && sha;
+    }
+
+    // The SHA extensions keep the state as ABEF/CDGH register pairs and run
+    // two rounds per sha256rnds2; the message schedule for the next four
+    // words is built with sha256msg1/msg2 while the current four are used.
+    SHA256_TARGET void compressShaNi(uint32_t state[8], const uint8_t* blocks, size_t count) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1); // CDAB
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B); // EFGH
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);    // ABEF
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);         // CDGH
+
+        for (; count > 0; --count, blocks += 64) {
+            const __m128i savedAbef = state0;
+            const __m128i savedCdgh = state1;
+            __m128i w[4];
+
+            for (int i = 0; i < 16; ++i) {
+                __m128i& current = w[i & 3];
+                if (i < 4) {
+                    current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * i)), byteSwap);
+                }
+                __m128i msg = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kRound[4 * i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                if (i >= 3 && i < 15) {
+                    __m128i& following = w[(i + 1) & 3];
+                    following = _mm_add_epi32(following, _mm_alignr_epi8(current, w[(i + 3) & 3], 4));
+                    following = _mm_sha256msg2_epu32(following, current);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+                if (i >= 1 && i <= 12) {
+                    __m128i& previous = w[(i + 3) & 3];
+                    previous = _mm_sha256msg1_epu32(previous, current);
+                }
+            }
+
+            state0 = _mm_add_epi32(state0, savedAbef);
+            state1 = _mm_add_epi32(state1, savedCdgh);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);           // FEBA
+        state1 = _mm_shuffle_epi32(state1, 0xB1);        // DCHG
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);     // DCBA
+        state1 = _mm_alignr_epi8(state1, tmp, 8);        // HGFE
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+#endif
+}
+
+Sha256::Backend Sha256::bestBackend() {
+    static const Backend best = supported(Backend::ShaNi) ? Backend::ShaNi : Backend::Scalar;
+    return best;
+}
+
+bool Sha256::supported(Backend backend) {
+    if (backend == Backend::Scalar) return true;
+#ifdef SHA256_X86
+    static const bool shaNi = cpuHasShaNi();
+    return shaNi;
+#else
+    return false;
+#endif
+}
+
+const char* Sha256::backendName(Backend backend) {
+    return backend == Backend::ShaNi ? "SHA-NI" : "scalar";
+}
+
+Sha256::Sha256(Backend backend)
+    : backend(supported(backend) ? backend : Backend::Scalar) {
+    reset();
+}
+
+void Sha256::reset() {
+    memcpy(state, kInitial, sizeof(state));
+    buffered = 0;
+    totalBytes = 0;
+}
+
+void Sha256::compress(const uint8_t* blocks, size_t count) {
+#ifdef SHA256_X86
+    if (backend == Backend::ShaNi) {
+        compressShaNi(state, blocks, count);
+        return;
+    }
+#endif
+    compressScalar(state, blocks, count);
+}
+
+void Sha256::update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    totalBytes += size;
+
+    if (buffered > 0) {
+        size_t take = min(size, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        size -= take;
+        if (buffered < sizeof(buffer)) return;
+        compress(buffer, 1);
+        buffered = 0;
+    }
+
+    // Whole blocks straight from the input, without copying.
+    if (size >= 64) {
+        compress(bytes, size / 64);
+        bytes += size / 64 * 64;
+        size %= 64;
+    }
+    memcpy(buffer, bytes, size);
+    buffered = size;
+}
+
+Sha256::Digest Sha256::finish() {
+    const uint64_t bits = totalBytes * 8;
+    const uint8_t pad = 0x80;
+    const uint8_t zeros[64] = {};
+    update(&pad, 1);
+    update(zeros, (buffered <= 56 ? 56 : 120) - buffered);
+
+    uint8_t length[8];
+    for (int i = 0; i < 8; ++i) length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    update(length, 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::hash(const void* data, size_t size) {
+    Sha256 sha;
+    sha.update(data, size);
+    return sha.finish();
+}
+
+string Sha256::toHex(const Digest& digest) {
+    static const char kDigits[] = "0123456789abcdef";
+    string hex(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); ++i) {
+        hex[2 * i] = kDigits[digest[i] >> 4];
+        hex[2 * i + 1] = kDigits[digest[i] & 0xF];
+    }
+    return hex;
+}
+
+HmacSha256::HmacSha256(const string& key, Sha256::Backend backend)
+    : inner(backend), outer(backend) {
+    uint8_t block[64] = {};
+    if (key.size() > sizeof(block)) {
+        Sha256 sha(backend);
+        sha.update(key.data(), key.size());
+        Sha256::Digest shortened = sha.finish();
+        memcpy(block, shortened.data(), shortened.size());
+    }
+    else {
+        memcpy(block, key.data(), key.size());
+    }
+
+    uint8_t pad[64];
+    for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x36;
+    inner.update(pad, sizeof(pad));
+    for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x5c;
+    outer.update(pad, sizeof(pad));
+}
+
+Sha256::Digest HmacSha256::sign(const void* data, size_t size) const {
+    Sha256 innerHash = inner;
+    innerHash.update(data, size);
+    Sha256::Digest innerDigest = innerHash.finish();
+
+    Sha256 outerHash = outer;
+    outerHash.update(innerDigest.data(), innerDigest.size());
+    return outerHash.finish();
+}
+
+bool decodeHex(const string& hex, string& bytes) {
+    auto value = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    if (hex.size() % 2 != 0) return false;
+
+    string decoded(hex.size() / 2, '\0');
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        int high = value(hex[2 * i]);
+        int low = value(hex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        decoded[i] = static_cast<char>(high << 4 | low);
+    }
+    bytes = move(decoded);
+    return true;
+}
+
+bool constantTimeEquals(const string& a, const string& b) {
+    if (a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    return diff == 0;
+}
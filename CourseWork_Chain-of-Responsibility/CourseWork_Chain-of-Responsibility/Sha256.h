@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// SHA-256 (FIPS 180-4). Blocks are compressed with the x86 SHA extensions
+// when the CPU has them, otherwise with portable code; both give the same
+// digests, the backend only changes speed.
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    enum class Backend { Scalar, ShaNi };
+    // Fastest backend this CPU supports, detected once.
+    static Backend bestBackend();
+    static bool supported(Backend backend);
+    static const char* backendName(Backend backend);
+
+    explicit Sha256(Backend backend = bestBackend());
+
+    void update(const void* data, size_t size);
+    // Pads and returns the digest; the object must be reset before reuse.
+    Digest finish();
+    void reset();
+
+    static Digest hash(const void* data, size_t size);
+    static Digest hash(const std::string& data) { return hash(data.data(), data.size()); }
+    static std::string toHex(const Digest& digest);
+
+private:
+    Backend backend;
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t totalBytes = 0;
+
+    void compress(const uint8_t* blocks, size_t count);
+};
+
+// HMAC-SHA-256 (RFC 2104) with the key schedule done once: the padded
+// inner and outer key blocks are hashed at construction and every sign()
+// starts from copies of those states.
+class HmacSha256 {
+public:
+    explicit HmacSha256(const std::string& key, Sha256::Backend backend = Sha256::bestBackend());
+
+    Sha256::Digest sign(const void* data, size_t size) const;
+    Sha256::Digest sign(const std::string& data) const { return sign(data.data(), data.size()); }
+
+private:
+    Sha256 inner;
+    Sha256 outer;
+};
+
+// Hex in either case; false on odd length or a non-hex character.
+bool decodeHex(const std::string& hex, std::string& bytes);
+// Compares without an early exit, so the time taken does not reveal how
+// many leading characters of a forged signature were right.
+bool constantTimeEquals(const std::string& a, const std::string& b);
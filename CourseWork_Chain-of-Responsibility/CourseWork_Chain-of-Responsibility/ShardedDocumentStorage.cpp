@@ -0,0 +1,537 @@
+#include "ShardedDocumentStorage.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <algorithm>
+#include <optional>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    // Version 2 added the file size of each shard.
+    const char kManifestMagic[] = "DocumentShards 2";
+    const char kManifestMagicV1[] = "DocumentShards 1";
+
+    // "shard-<k>.txt" gives k; nullopt for any other name.
+    optional<size_t> shardNumber(const string& name) {
+        const string prefix = "shard-", suffix = ".txt";
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0
+            || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            return nullopt;
+        }
+        const string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (digits.size() > 18 || !all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return nullopt;
+        }
+        return static_cast<size_t>(stoull(digits));
+    }
+}
+
+ShardedDocumentStorage::ShardedDocumentStorage(string dir, ShardOptions opts)
+    : directory(move(dir)), options(opts) {
+    if (options.idsPerShard == 0) options.idsPerShard = 1;
+    if (options.maxResidentShards == 0) options.maxResidentShards = 1;
+
+    error_code ec;
+    fs::create_directories(directory, ec);
+    opened = !ec && readManifest() && reconcileShardFiles();
+}
+
+ShardedDocumentStorage::~ShardedDocumentStorage() {
+    if (opened) flush();
+}
+
+string ShardedDocumentStorage::shardPath(size_t shard) const {
+    return (fs::path(directory) / ("shard-" + to_string(shard) + ".txt")).string();
+}
+
+string ShardedDocumentStorage::manifestPath() const {
+    return (fs::path(directory) / "manifest.txt").string();
+}
+
+// A missing manifest means a new, empty store.
+bool ShardedDocumentStorage::readManifest() {
+    ifstream in(manifestPath());
+    if (!in.is_open()) return true;
+
+    string line;
+    if (!getline(in, line) || (line != kManifestMagic && line != kManifestMagicV1)) return false;
+
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string key;
+        fields >> key;
+        if (key == "span") {
+            size_t span = 0;
+            if (!(fields >> span) || span == 0) return false;
+            options.idsPerShard = span; // the files decide, not the caller
+        }
+        else if (key == "next-id") {
+            DocumentId next = 0;
+            if (!(fields >> next) || next == 0) return false;
+            if (next > 1 && !idAllocator.observe(next - 1)) return false;
+        }
+        else if (key == "shard") {
+            size_t shard = 0, count = 0;
+            uint64_t bytes = UINT64_MAX; // version 1: always recounted
+            if (!(fields >> shard >> count)) return false;
+            fields >> bytes;
+            if (count == 0) continue;
+            files[shard] = { count, bytes };
+        }
+        else if (!key.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShardedDocumentStorage::reconcileShardFiles() {
+    error_code ec;
+    bool changed = false;
+    set<size_t> present;
+    for (const auto& item : fs::directory_iterator(directory, ec)) {
+        auto shard = shardNumber(item.path().filename().string());
+        if (!shard || !item.is_regular_file(ec)) continue;
+        present.insert(*shard);
+
+        const uint64_t bytes = item.file_size(ec);
+        auto known = files.find(*shard);
+        if (!ec && known != files.end() && known->second.bytes == bytes) continue;
+
+        ifstream in(item.path(), ios::binary);
+        if (!in.is_open()) return false;
+        ShardFile counted{ 0, bytes };
+        while (auto doc = DocumentStorage::readDocumentRecord(in)) {
+            ++counted.documents;
+            idAllocator.observe(doc->id);
+        }
+        if (counted.documents > 0) files[*shard] = counted;
+        else files.erase(*shard);
+        changed = true;
+    }
+    for (auto it = files.begin(); it != files.end();) {
+        if (present.count(it->first)) {
+            ++it;
+            continue;
+        }
+        it = files.erase(it); // listed, but the file is gone
+        changed = true;
+    }
+
+    for (const auto& f : files) {
+        counts[f.first] = f.second.documents;
+        total += f.second.documents;
+    }
+    return !changed || writeManifest();
+}
+
+bool ShardedDocumentStorage::writeManifest() const {
+    const string path = manifestPath(), temporary = path + ".tmp";
+    {
+        ofstream out(temporary);
+        if (!out.is_open()) return false;
+
+        out << kManifestMagic << "\n";
+        out << "span " << options.idsPerShard << "\n";
+        out << "next-id " << idAllocator.peek() << "\n";
+        for (const auto& f : files) {
+            out << "shard " << f.first << " " << f.second.documents << " " << f.second.bytes << "\n";
+        }
+        if (!out.flush()) return false;
+    }
+    error_code ec;
+    fs::rename(temporary, path, ec);
+    return !ec;
+}
+
+size_t ShardedDocumentStorage::residentBytes() const {
+    size_t bytes = 0;
+    for (const auto& r : resident) bytes += r.second.storage->trackedMemory();
+    return bytes;
+}
+
+ShardedDocumentStorage::Shard& ShardedDocumentStorage::acquire(size_t shard) const {
+    auto it = resident.find(shard);
+    if (it != resident.end()) {
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+        return it->second;
+    }
+
+    Shard entry;
+    entry.storage = make_shared<DocumentStorage>();
+    entry.storage->setCompressionThreshold(compressionThreshold);
+    entry.storage->setValidateOnLoad(false);
+    entry.storage->setValidatorChain(validatorChain);
+    entry.storage->setTrace(trace);
+    if (counts.count(shard)) {
+        entry.storage->loadDocumentsFromFile(shardPath(shard));
+    }
+    if (textIndex) {
+        entry.storage->attachTextIndex(textIndex);
+        indexedShards.insert(shard);
+    }
+
+    lru.push_front(shard);
+    entry.lruPosition = lru.begin();
+    return resident.emplace(shard, move(entry)).first->second;
+}
+
+void ShardedDocumentStorage::corpusChanged(size_t shard) const {
+    for (const auto& r : resident) {
+        if (r.first != shard) r.second.storage->forgetCorpusVerdicts();
+    }
+}
+
+// The manifest follows every shard write, so it never lists more than the
+// files hold.
+bool ShardedDocumentStorage::writeBack(size_t shard, Shard& entry) const {
+    if (!entry.dirty) return true;
+
+    const string path = shardPath(shard);
+    error_code ec;
+    if (entry.storage->empty()) {
+        fs::remove(path, ec);
+        fs::remove(DocumentIndex::pathFor(path), ec);
+        files.erase(shard);
+    }
+    else {
+        if (!entry.storage->saveDocumentsToFile(path)) return false;
+        const uint64_t bytes = fs::file_size(path, ec);
+        if (ec) return false;
+        files[shard] = { entry.storage->size(), bytes };
+    }
+    entry.dirty = false;
+    return writeManifest();
+}
+
+// The most recently used shard always stays, callers may still hold it.
+void ShardedDocumentStorage::evictExcess() const {
+    auto overBudget = [this] {
+        return resident.size() > options.maxResidentShards
+            || (options.memoryBudget > 0 && residentBytes() > options.memoryBudget);
+    };
+
+    while (resident.size() > 1 && overBudget()) {
+        size_t victim = lru.back();
+        Shard& entry = resident.at(victim);
+        if (!writeBack(victim, entry)) break; // keep it rather than lose edits
+        lru.pop_back();
+        resident.erase(victim);
+    }
+}
+
+bool ShardedDocumentStorage::flush() const {
+    bool ok = true;
+    for (auto& r : resident) {
+        ok = writeBack(r.first, r.second) && ok;
+    }
+    return writeManifest() && ok;
+}
+
+void ShardedDocumentStorage::setValidatorChain(shared_ptr<Validator> chain) {
+    validatorChain = chain;
+    for (auto& r : resident) {
+        r.second.storage->setValidatorChain(chain);
+    }
+
+    bool tracksCorpus = false;
+    for (Validator* link = chain.get(); link; link = link->nextLink()) {
+        tracksCorpus = tracksCorpus || link->tracksCorpus();
+    }
+    if (!tracksCorpus) return;
+
+    // A shard's documents join the corpus-tracking links when it loads, so
+    // until every shard has been loaded once a check could miss a match in
+    // one that has not. Load them all now; evicted shards stay in the links.
+    set<size_t> joined;
+    for (const auto& r : resident) joined.insert(r.first);
+    for (const auto& c : counts) {
+        if (joined.count(c.first)) continue;
+        acquire(c.first);
+        evictExcess();
+    }
+    // Whatever was carried over from the old chain predates a full corpus.
+    for (const auto& r : resident) r.second.storage->forgetCorpusVerdicts();
+}
+
+// Only resident shards take memory; the shard table itself is small.
+MemoryUsage ShardedDocumentStorage::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& r : resident) usage += r.second.storage->memoryUsage();
+    usage.nodes += counts.size() * (memory::kTreeNode + sizeof(pair<const size_t, size_t>))
+        + memory::hashMapNodes(resident) + lru.size() * (2 * sizeof(void*) + sizeof(size_t));
+    usage.controlBlocks += resident.size() * memory::kControlBlock;
+    if (textIndex) usage.indexes += textIndex->memoryBytes();
+    return usage;
+}
+
+void ShardedDocumentStorage::setMemoryBudget(size_t bytes) {
+    options.memoryBudget = bytes;
+    evictExcess();
+}
+
+void ShardedDocumentStorage::setTrace(shared_ptr<ValidationTrace> validationTrace) {
+    trace = validationTrace;
+    for (auto& r : resident) {
+        r.second.storage->setTrace(validationTrace);
+    }
+}
+
+// Shards on disk are converted when they are next loaded.
+void ShardedDocumentStorage::setCompressionThreshold(size_t minBytes) {
+    compressionThreshold = minBytes;
+    for (auto& r : resident) {
+        r.second.storage->setCompressionThreshold(minBytes);
+        r.second.dirty = true;
+    }
+    evictExcess();
+}
+
+DocumentId ShardedDocumentStorage::add(Document&& doc) {
+    if (doc.id == 0) {
+        doc.id = idAllocator.allocate();
+        if (doc.id == 0) return 0; // every ID is taken
+    }
+    else if (!idAllocator.observe(doc.id)) {
+        return 0;
+    }
+
+    size_t shard = shardOf(doc.id);
+    Shard& entry = acquire(shard);
+    DocumentId id = entry.storage->add(move(doc));
+    if (id != 0) {
+        ++counts[shard];
+        ++total;
+        entry.dirty = true;
+        corpusChanged(shard);
+    }
+    evictExcess();
+    return id;
+}
+
+bool ShardedDocumentStorage::edit(DocumentId id, DocumentPatch patch) {
+    if (id == 0) return false;
+    size_t shard = shardOf(id);
+    if (!counts.count(shard)) return false;
+
+    Shard& entry = acquire(shard);
+    bool changed = entry.storage->edit(id, move(patch));
+    if (changed) {
+        entry.dirty = true;
+        corpusChanged(shard);
+    }
+    evictExcess();
+    return changed;
+}
+
+bool ShardedDocumentStorage::remove(DocumentId id) {
+    if (id == 0) return false;
+    size_t shard = shardOf(id);
+    if (!counts.count(shard)) return false;
+
+    Shard& entry = acquire(shard);
+    bool removed = entry.storage->remove(id);
+    if (removed) {
+        entry.dirty = true;
+        corpusChanged(shard);
+        --total;
+        if (--counts[shard] == 0) counts.erase(shard);
+    }
+    evictExcess();
+    return removed;
+}
+
+// IDs are not reused after clear(), same as DocumentStorage.
+void ShardedDocumentStorage::clear() {
+    error_code ec;
+    for (const auto& c : counts) {
+        fs::remove(shardPath(c.first), ec);
+        fs::remove(DocumentIndex::pathFor(shardPath(c.first)), ec);
+    }
+    resident.clear();
+    lru.clear();
+    counts.clear();
+    files.clear();
+    for (Validator* link = validatorChain.get(); link; link = link->nextLink()) {
+        if (link->tracksCorpus()) link->corpusCleared();
+    }
+    if (textIndex) textIndex->clear();
+    indexedShards.clear();
+    total = 0;
+    writeManifest();
+}
+
+shared_ptr<const Document> ShardedDocumentStorage::find(DocumentId id) const {
+    if (id == 0) return nullptr;
+    size_t shard = shardOf(id);
+    if (!counts.count(shard)) return nullptr;
+
+    // The document keeps its shard's copy alive even if the shard is evicted.
+    auto doc = acquire(shard).storage->find(id);
+    evictExcess();
+    return doc;
+}
+
+// A document of a loaded shard goes through that shard, which keeps the
+// per-link verdicts; others just run the chain.
+ErrorSet ShardedDocumentStorage::validate(const Document& doc) const {
+    ErrorSet errors;
+    if (!validatorChain) return errors;
+
+    if (doc.id != 0) {
+        auto it = resident.find(shardOf(doc.id));
+        if (it != resident.end()) return it->second.storage->validate(doc);
+    }
+    validatorChain->validate(doc, errors);
+    return errors;
+}
+
+optional<ErrorSet> ShardedDocumentStorage::validate(DocumentId id) const {
+    auto doc = find(id);
+    if (!doc) return nullopt;
+    return validate(*doc);
+}
+
+optional<ErrorSet> ShardedDocumentStorage::validateWithin(const Document& doc, const ValidationDeadline& deadline) const {
+    ErrorSet errors;
+    if (!validatorChain) return errors;
+
+    if (doc.id != 0) {
+        auto it = resident.find(shardOf(doc.id));
+        if (it != resident.end()) return it->second.storage->validateWithin(doc, deadline);
+    }
+    if (!validatorChain->validateWithin(doc, errors, deadline)) return nullopt;
+    return errors;
+}
+
+void ShardedDocumentStorage::forEach(const DocumentVisitor& visit, const DocumentFilter& filter) const {
+    for (const auto& c : counts) {
+        // Holding the storage keeps it valid should the LRU drop the shard.
+        shared_ptr<DocumentStorage> storage = acquire(c.first).storage;
+        evictExcess();
+        storage->forEach(visit, filter);
+    }
+}
+
+PageCursor ShardedDocumentStorage::forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit,
+                                              const DocumentFilter& filter) const {
+    PageCursor cursor{ after, false };
+    size_t visited = 0;
+    auto countVisit = [&](const Document& doc) {
+        ++visited;
+        visit(doc);
+    };
+    for (auto c = counts.lower_bound(shardOf(after + 1)); c != counts.end(); ++c) {
+        if (limit != 0 && visited == limit) {
+            cursor.more = true;
+            break;
+        }
+        shared_ptr<DocumentStorage> storage = acquire(c->first).storage;
+        evictExcess();
+        PageCursor shard = storage->forEachPage(countVisit, cursor.last, limit == 0 ? 0 : limit - visited, filter);
+        cursor.last = shard.last;
+        if (shard.more) {
+            cursor.more = true;
+            break;
+        }
+    }
+    return cursor;
+}
+
+vector<DocumentId> ShardedDocumentStorage::searchText(const string& query, size_t limit) const {
+    if (!textIndex) {
+        textIndex = make_shared<FullTextIndex>();
+        for (auto& r : resident) {
+            r.second.storage->attachTextIndex(textIndex);
+            indexedShards.insert(r.first);
+        }
+    }
+    for (const auto& c : counts) {
+        if (indexedShards.count(c.first)) continue;
+        acquire(c.first);
+        evictExcess();
+    }
+
+    vector<DocumentId> ids = textIndex->search(query);
+    if (limit != 0 && ids.size() > limit) ids.resize(limit);
+    return ids;
+}
+
+// Shards go in ID order, so a stop inside one leaves the shards after it
+// untouched and its progress describes the whole run; once the deadline
+// has passed, no further shard is even loaded.
+ValidationProgress ShardedDocumentStorage::eachShard(const ShardRun& run, const ValidationDeadline& deadline) const {
+    ValidationProgress progress;
+    for (const auto& c : counts) {
+        if ((progress.stopped = deadline.reason()) != StopReason::None) {
+            progress.resumeAfter = static_cast<DocumentId>(c.first * options.idsPerShard);
+            return progress;
+        }
+
+        shared_ptr<DocumentStorage> storage = acquire(c.first).storage;
+        evictExcess();
+        ValidationProgress shard = run(*storage);
+        progress.validated += shard.validated;
+        if (!shard.complete()) {
+            shard.validated = progress.validated;
+            // Everything in the shards before it was done.
+            shard.resumeAfter = max(shard.resumeAfter, static_cast<DocumentId>(c.first * options.idsPerShard));
+            return shard;
+        }
+    }
+    return progress;
+}
+
+ValidationProgress ShardedDocumentStorage::validateEach(const ValidationVisitor& visit, const DocumentFilter& filter,
+                                                        const ValidationDeadline& deadline) const {
+    return eachShard([&](const DocumentStorage& storage) {
+        return storage.validateEach(visit, filter, deadline);
+    }, deadline);
+}
+
+ValidationProgress ShardedDocumentStorage::collectStatistics(CorpusStatistics& stats, const ValidationDeadline& deadline) const {
+    return eachShard([&](const DocumentStorage& storage) {
+        return storage.collectStatistics(stats, deadline);
+    }, deadline);
+}
+
+// Like DocumentStorage, written to a temporary file that replaces `filename`
+// only once it is complete.
+bool ShardedDocumentStorage::saveDocumentsToFile(const string& filename) const {
+    const string temporary = filename + ".tmp";
+    ofstream out(temporary, ios::binary);
+    if (!out.is_open()) return false;
+
+    vector<DocumentIndex::Entry> entries;
+    entries.reserve(total);
+    bool written = true;
+    for (const auto& c : counts) {
+        shared_ptr<DocumentStorage> storage = acquire(c.first).storage;
+        evictExcess();
+        if (!(written = storage->saveTo(out, &entries))) break;
+    }
+
+    out.close();
+    error_code ec;
+    if (written && out) fs::rename(temporary, filename, ec);
+    if (!written || !out || ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+
+    return DocumentIndex::write(filename, entries, errorPolicy());
+}
+
+bool ShardedDocumentStorage::loadDocumentsFromFile(const string& filename, vector<MalformedRecord>* malformed) {
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) return false;
+
+    while (auto doc = DocumentStorage::readDocumentRecord(in, malformed)) {
+        add(move(*doc));
+    }
+    return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <set>
+#include <functional>
+#include "DocumentStore.h"
+#include "DocumentStorage.h"
+#include "IdAllocator.h"
+
+struct ShardOptions {
+    size_t idsPerShard = 100000;   // shard k holds IDs [k*span + 1, (k+1)*span]
+    size_t maxResidentShards = 4;  // at least one shard is always kept
+    size_t memoryBudget = 0;       // bytes for resident shards, 0 = no limit (see setMemoryBudget)
+};
+
+// Document store for corpora larger than RAM. Documents are partitioned by
+// ID range into shard files ("shard-<k>.txt", same record format as
+// documents.txt) inside one directory; only recently used shards are kept
+// in memory, each as a plain DocumentStorage. A shard evicted from the LRU
+// is written back if it was modified. Shards load without validation;
+// their documents are checked when a page or validateEach reaches them.
+//
+// "manifest.txt" keeps the shard span, the next free ID and the document
+// count and file size of every shard file, so size() and ID allocation need
+// no shard loads. It is rewritten after every shard write and describes the
+// files as they are on disk; on open, a shard file whose size disagrees
+// with it (a crash between the two writes, an edit by hand) is recounted.
+// Shard files and the manifest are written to a temporary file that is
+// then renamed over the old one.
+class ShardedDocumentStorage : public DocumentStore {
+public:
+    explicit ShardedDocumentStorage(std::string directory, ShardOptions options = {});
+    ~ShardedDocumentStorage() override;
+
+    ShardedDocumentStorage(const ShardedDocumentStorage&) = delete;
+    ShardedDocumentStorage& operator=(const ShardedDocumentStorage&) = delete;
+
+    // False if the directory could not be created or the manifest is corrupt.
+    bool isOpen() const { return opened; }
+
+    // With a corpus-tracking link (Validator::tracksCorpus) in the chain,
+    // loads every shard once so the link sees the whole corpus before its
+    // first check, like the first searchText does for the text index.
+    void setValidatorChain(std::shared_ptr<Validator> chain) override;
+    bool hasValidatorChain() const override { return validatorChain != nullptr; }
+    ErrorPolicy errorPolicy() const override { return errorPolicyOf(validatorChain.get()); }
+    void setCompressionThreshold(size_t minBytes) override;
+
+    DocumentId add(Document&& doc) override;
+    bool edit(DocumentId id, DocumentPatch patch) override;
+    bool remove(DocumentId id) override;
+    void clear() override;
+
+    std::shared_ptr<const Document> find(DocumentId id) const override;
+    size_t size() const override { return total; }
+
+    ErrorSet validate(const Document& doc) const override;
+    std::optional<ErrorSet> validate(DocumentId id) const override;
+    std::optional<ErrorSet> validateWithin(const Document& doc, const ValidationDeadline& deadline) const override;
+
+    // Pages the shards in one after another; at most the LRU limit stays
+    // resident while walking.
+    void forEach(const DocumentVisitor& visit, const DocumentFilter& filter = nullptr) const override;
+    // Starts at the shard holding `after` + 1 and loads only as many shards
+    // as the page reaches. A page that ends a shard reports `more` if any
+    // shard follows, so a filtered walk may end on an empty page.
+    PageCursor forEachPage(const DocumentVisitor& visit, DocumentId after, size_t limit,
+        const DocumentFilter& filter = nullptr) const override;
+    ValidationProgress validateEach(const ValidationVisitor& visit, const DocumentFilter& filter = nullptr,
+        const ValidationDeadline& deadline = {}) const override;
+    ValidationProgress collectStatistics(CorpusStatistics& stats, const ValidationDeadline& deadline = {}) const override;
+    // One index serves all shards. The first search loads every shard once
+    // to fill it; evicted shards stay indexed, so later searches load none.
+    std::vector<DocumentId> searchText(const std::string& query, size_t limit = 0) const override;
+    void setTrace(std::shared_ptr<ValidationTrace> validationTrace) override;
+
+    MemoryUsage memoryUsage() const override;
+    // Spills: least recently used shards are written back and dropped
+    // until the resident ones fit. Ingestion is never refused.
+    void setMemoryBudget(size_t bytes) override;
+    size_t memoryBudget() const override { return options.memoryBudget; }
+    size_t rejectedByBudget() const override { return 0; }
+
+    // Exports every shard into one documents file (plus its index) and
+    // imports one record by record, so neither needs the corpus in memory.
+    bool saveDocumentsToFile(const std::string& filename = "documents.txt") const override;
+    bool loadDocumentsFromFile(const std::string& filename = "documents.txt",
+        std::vector<MalformedRecord>* malformed = nullptr) override;
+
+    // Writes back modified shards and the manifest.
+    bool flush() const;
+
+    size_t shardCount() const { return counts.size(); }
+    size_t residentShardCount() const { return resident.size(); }
+    // Tracked memory of the resident shards, as used against the budget.
+    size_t residentBytes() const;
+
+private:
+    struct Shard {
+        std::shared_ptr<DocumentStorage> storage;
+        bool dirty = false;
+        std::list<size_t>::iterator lruPosition;
+    };
+
+    std::string directory;
+    ShardOptions options;
+    bool opened = false;
+
+    std::shared_ptr<Validator> validatorChain;
+    std::shared_ptr<ValidationTrace> trace;
+    size_t compressionThreshold = 0;
+    IdAllocator idAllocator;
+
+    std::map<size_t, size_t> counts; // shard -> documents, non-empty shards only
+    size_t total = 0;
+
+    // Shard files as last written, which is what the manifest records.
+    struct ShardFile {
+        size_t documents = 0;
+        uint64_t bytes = 0;
+    };
+    mutable std::map<size_t, ShardFile> files;
+
+    mutable std::shared_ptr<FullTextIndex> textIndex; // null until the first search
+    mutable std::set<size_t> indexedShards;
+
+    // Residency is a cache, so it may change under const operations.
+    mutable std::unordered_map<size_t, Shard> resident;
+    mutable std::list<size_t> lru; // most recently used first
+
+    size_t shardOf(DocumentId id) const { return static_cast<size_t>((id - 1) / options.idsPerShard); }
+    std::string shardPath(size_t shard) const;
+    std::string manifestPath() const;
+
+    bool readManifest();
+    // Checks the manifest against the shard files in the directory and
+    // recounts those it does not match; then fills `counts` from `files`.
+    bool reconcileShardFiles();
+    bool writeManifest() const;
+
+    // After a change to `shard`, the other resident shards drop their
+    // verdicts of links that depend on the whole corpus.
+    void corpusChanged(size_t shard) const;
+
+    // Loads the shard if needed and marks it most recently used.
+    Shard& acquire(size_t shard) const;
+    bool writeBack(size_t shard, Shard& entry) const;
+    void evictExcess() const;
+
+    // Runs a bounded pass over every non-empty shard in ID order and
+    // merges the shards' progress into that of the whole store.
+    using ShardRun = std::function<ValidationProgress(const DocumentStorage&)>;
+    ValidationProgress eachShard(const ShardRun& run, const ValidationDeadline& deadline) const;
+};
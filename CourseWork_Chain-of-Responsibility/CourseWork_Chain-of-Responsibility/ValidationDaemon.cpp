@@ -0,0 +1,467 @@
+#include "ValidationDaemon.h"
+#include "DaemonProtocol.h"
+#include <optional>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+using namespace daemon_protocol;
+
+namespace {
+    // Stop answering a connection's frames while this much of its output
+    // is unsent, so a client that never reads cannot grow the buffer.
+    const size_t kMaxPendingOut = 8u << 20;
+    // Read at most this much per wakeup to stay fair to other clients.
+    const size_t kReadPerWakeup = 1u << 20;
+    // Validate batches at least this big (and a sizeable share of the
+    // store) go through validateEach and so run in parallel.
+    const size_t kParallelBatch = 64;
+
+    string systemError(const char* what) {
+        return string(what) + ": " + strerror(errno);
+    }
+
+    void writeErrors(FrameWriter& out, const ErrorSet& errors) {
+        out.u32(static_cast<uint32_t>(errors.size()));
+        for (const auto& error : errors) out.str(error);
+    }
+
+    // One Validate/ValidateDoc item. An item that would leave less than 5
+    // bytes (status and an empty error list) for each of the `left` items
+    // after it goes out as ItemNotValidated, so the answer fits a frame.
+    void writeVerdict(FrameWriter& out, ItemStatus status, const ErrorSet& errors, size_t left) {
+        size_t bytes = 5;
+        for (const auto& error : errors) bytes += 4 + error.size();
+        if (out.payload().size() + bytes + 5 * left > kMaxFrameBytes) {
+            out.u8(ItemNotValidated);
+            writeErrors(out, {});
+            return;
+        }
+        out.u8(status);
+        writeErrors(out, errors);
+    }
+
+    // Starts counting when the request has been parsed.
+    ValidationDeadline deadlineAfter(uint32_t timeoutMs) {
+        return timeoutMs == 0 ? ValidationDeadline() : ValidationDeadline::after(chrono::milliseconds(timeoutMs));
+    }
+
+    string badRequest(uint32_t tag, const string& message) {
+        FrameWriter out;
+        out.u8(StatusBadRequest);
+        out.u32(tag);
+        out.str(message);
+        return out.finish();
+    }
+}
+
+ValidationDaemon::~ValidationDaemon() {
+    for (auto& [fd, conn] : connections) close(fd);
+    if (signalFd >= 0) close(signalFd);
+    if (epollFd >= 0) close(epollFd);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(path.c_str());
+    }
+}
+
+bool ValidationDaemon::listen(const string& socketPath, string& error) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        error = "Недопустимий шлях сокета: " + socketPath;
+        return false;
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    // A socket file left by a daemon that did not exit cleanly blocks bind.
+    struct stat existing;
+    if (stat(socketPath.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(socketPath.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = systemError("socket");
+        return false;
+    }
+    // The protocol can rewrite and save the store: owner only. The socket
+    // file gets its mode from the umask at bind, so there is no window in
+    // which another user could connect before a chmod.
+    const mode_t previousMask = umask(0177);
+    const int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(previousMask);
+    if (bound < 0) {
+        error = systemError("bind");
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    path = socketPath;
+    if (::listen(listenFd, SOMAXCONN) < 0) {
+        error = systemError("listen");
+        return false;
+    }
+    return true;
+}
+
+bool ValidationDaemon::run(string& error) {
+    if (listenFd < 0) {
+        error = "Сокет не відкрито";
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        error = systemError("epoll_create1");
+        return false;
+    }
+
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    signalFd = signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0) {
+        error = systemError("signalfd");
+        return false;
+    }
+
+    for (int fd : { listenFd, signalFd }) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            error = systemError("epoll_ctl");
+            return false;
+        }
+    }
+
+    epoll_event events[64];
+    for (;;) {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            error = systemError("epoll_wait");
+            return false;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            const int fd = events[i].data.fd;
+            const uint32_t flags = events[i].events;
+            if (fd == signalFd) {
+                for (auto& [clientFd, conn] : connections) close(clientFd);
+                connections.clear();
+                return true;
+            }
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue; // closed earlier in this batch
+            if (flags & EPOLLERR) {
+                closeConnection(fd);
+                continue;
+            }
+            pump(fd, it->second, (flags & (EPOLLIN | EPOLLHUP)) != 0);
+        }
+    }
+}
+
+void ValidationDaemon::acceptClients() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN, or a client that gave up meanwhile
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        connections[fd].interest = EPOLLIN;
+        ++accepted;
+    }
+}
+
+bool ValidationDaemon::pump(int fd, Connection& conn, bool readable) {
+    if (readable && !conn.closing) {
+        bool eof = false;
+        if (!readFrom(fd, conn, eof)) {
+            closeConnection(fd);
+            return false;
+        }
+        conn.closing = eof;
+    }
+
+    // Answering may stop at kMaxPendingOut; once flushing makes room the
+    // remaining frames are answered on the same wakeup.
+    for (;;) {
+        if (!serveFrames(conn) || !flush(fd, conn)) {
+            closeConnection(fd);
+            return false;
+        }
+        const bool drained = conn.outPos == conn.out.size();
+        if (!drained || completeFrame(conn.in.data(), conn.in.size()) == 0) break;
+    }
+
+    if (conn.closing && conn.outPos == conn.out.size()) {
+        closeConnection(fd);
+        return false;
+    }
+    updateInterest(fd, conn);
+    return true;
+}
+
+bool ValidationDaemon::readFrom(int fd, Connection& conn, bool& eof) {
+    char buffer[64 * 1024];
+    size_t total = 0;
+    while (total < kReadPerWakeup) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got > 0) {
+            conn.in.append(buffer, static_cast<size_t>(got));
+            total += static_cast<size_t>(got);
+            continue;
+        }
+        if (got == 0) {
+            eof = true;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+bool ValidationDaemon::serveFrames(Connection& conn) {
+    size_t consumed = 0;
+    bool valid = true;
+    while (conn.out.size() - conn.outPos < kMaxPendingOut) {
+        const size_t frame = completeFrame(conn.in.data() + consumed, conn.in.size() - consumed);
+        if (frame == 0) break;
+        if (frame == SIZE_MAX) {
+            valid = false;
+            break;
+        }
+        conn.out += handle(conn.in.data() + consumed + 4, frame - 4);
+        consumed += frame;
+        ++requests;
+    }
+    conn.in.erase(0, consumed);
+    return valid;
+}
+
+bool ValidationDaemon::flush(int fd, Connection& conn) {
+    while (conn.outPos < conn.out.size()) {
+        ssize_t sent = send(fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn.outPos += static_cast<size_t>(sent);
+    }
+    conn.out.clear();
+    conn.outPos = 0;
+    return true;
+}
+
+void ValidationDaemon::updateInterest(int fd, Connection& conn) {
+    const size_t pending = conn.out.size() - conn.outPos;
+    uint32_t interest = 0;
+    if (!conn.closing && pending < kMaxPendingOut) interest |= EPOLLIN;
+    if (pending > 0) interest |= EPOLLOUT;
+    if (interest == conn.interest) return;
+
+    epoll_event event{};
+    event.events = interest;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    conn.interest = interest;
+}
+
+void ValidationDaemon::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+string ValidationDaemon::handle(const char* payload, size_t size) {
+    FrameReader in(payload, size);
+    uint8_t opcode = 0;
+    uint32_t tag = 0;
+    if (!in.u8(opcode) || !in.u32(tag)) return badRequest(tag, "Короткий заголовок запиту");
+
+    FrameWriter out;
+    out.u8(StatusOk);
+    out.u32(tag);
+
+    // Batch bodies start with a count; every item takes at least 8 bytes,
+    // so a count beyond that is rejected before anything is reserved.
+    uint32_t count = 0;
+    auto readCount = [&] {
+        return in.u32(count) && count <= size / 8;
+    };
+    // Every case checks for trailing bytes as soon as its body is parsed,
+    // before it touches the store, so a malformed request changes nothing.
+    auto trailingBytes = [&] { return badRequest(tag, "Зайві байти в кінці запиту"); };
+
+    switch (opcode) {
+    case OpValidate: {
+        uint32_t timeoutMs = 0;
+        if (!in.u32(timeoutMs) || !readCount()) return badRequest(tag, "Невірна кількість");
+        vector<DocumentId> ids(count);
+        for (auto& id : ids) {
+            if (!in.u64(id)) return badRequest(tag, "Обрізаний список ID");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        const ValidationDeadline deadline = deadlineAfter(timeoutMs);
+
+        vector<ItemStatus> status(count, ItemNotFound);
+        vector<ErrorSet> results(count);
+        if (count >= kParallelBatch && static_cast<size_t>(count) * 16 >= store.size()) {
+            // One pass over the store; the matches are validated in parallel.
+            unordered_map<DocumentId, vector<size_t>> positions;
+            for (size_t i = 0; i < ids.size(); ++i) positions[ids[i]].push_back(i);
+            ValidationProgress progress = store.validateEach([&](const Document& doc, const ErrorSet& errors) {
+                for (size_t i : positions.at(doc.id)) {
+                    status[i] = ItemValidated;
+                    results[i] = errors;
+                }
+            }, [&](const Document& doc) { return positions.count(doc.id) != 0; }, deadline);
+
+            if (!progress.complete()) {
+                for (DocumentId id : progress.interrupted) {
+                    for (size_t i : positions.at(id)) status[i] = ItemNotValidated;
+                }
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    if (ids[i] > progress.resumeAfter) status[i] = ItemNotValidated;
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < ids.size(); ++i) {
+                auto doc = store.find(ids[i]);
+                if (!doc) continue;
+                auto errors = store.validateWithin(*doc, deadline);
+                status[i] = errors ? ItemValidated : ItemNotValidated;
+                if (errors) results[i] = move(*errors);
+            }
+        }
+
+        for (size_t i = 0; i < ids.size(); ++i) writeVerdict(out, status[i], results[i], ids.size() - i - 1);
+        break;
+    }
+    case OpValidateDocument: {
+        uint32_t timeoutMs = 0;
+        if (!in.u32(timeoutMs) || !readCount()) return badRequest(tag, "Невірна кількість");
+        vector<Document> docs;
+        docs.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            docs.emplace_back("", false, "");
+            if (!in.document(docs.back())) return badRequest(tag, "Обрізаний документ");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        const ValidationDeadline deadline = deadlineAfter(timeoutMs);
+        for (size_t i = 0; i < docs.size(); ++i) {
+            auto errors = store.validateWithin(docs[i], deadline);
+            writeVerdict(out, errors ? ItemValidated : ItemNotValidated, errors ? *errors : ErrorSet{}, docs.size() - i - 1);
+        }
+        break;
+    }
+    case OpAdd: {
+        if (!readCount()) return badRequest(tag, "Невірна кількість");
+        // Parsed and checked up front, so a truncated or overlong batch adds nothing.
+        vector<Document> docs;
+        docs.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            docs.emplace_back("", false, "");
+            if (!in.document(docs.back())) return badRequest(tag, "Обрізаний документ");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        for (auto& doc : docs) out.u64(store.add(move(doc)));
+        break;
+    }
+    case OpEdit: {
+        if (!readCount()) return badRequest(tag, "Невірна кількість");
+        vector<pair<DocumentId, DocumentPatch>> patches(count);
+        for (auto& [id, patch] : patches) {
+            if (!in.patch(id, patch)) return badRequest(tag, "Обрізана зміна");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        for (auto& [id, patch] : patches) out.u8(store.edit(id, move(patch)) ? 1 : 0);
+        break;
+    }
+    case OpRemove: {
+        if (!readCount()) return badRequest(tag, "Невірна кількість");
+        vector<DocumentId> ids(count);
+        for (auto& id : ids) {
+            if (!in.u64(id)) return badRequest(tag, "Обрізаний список ID");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        for (DocumentId id : ids) out.u8(store.remove(id) ? 1 : 0);
+        break;
+    }
+    case OpQuery: {
+        uint32_t mask = 0, limit = 0;
+        DocumentId after = 0;
+        if (!in.u32(mask) || !in.u32(limit) || !in.u64(after)) return badRequest(tag, "Обрізаний запит");
+        if (!in.atEnd()) return trailingBytes();
+        if (limit == 0 || limit > kMaxQueryIds) limit = kMaxQueryIds;
+        vector<DocumentId> ids;
+        DocumentFilter filter;
+        if (mask != 0) {
+            filter = [mask, policy = store.errorPolicy()](const Document& doc) { return (detectErrors(doc, policy) & mask) != 0; };
+        }
+        store.forEachPage([&](const Document& doc) { ids.push_back(doc.id); }, after, limit, filter);
+        out.u32(static_cast<uint32_t>(ids.size()));
+        for (DocumentId id : ids) out.u64(id);
+        break;
+    }
+    case OpGet: {
+        if (!readCount()) return badRequest(tag, "Невірна кількість");
+        vector<DocumentId> ids(count);
+        for (auto& id : ids) {
+            if (!in.u64(id)) return badRequest(tag, "Обрізаний список ID");
+        }
+        if (!in.atEnd()) return trailingBytes();
+        for (size_t i = 0; i < ids.size(); ++i) {
+            auto doc = store.find(ids[i]);
+            if (!doc) {
+                out.u8(GetNotFound);
+                continue;
+            }
+            // Leaves a byte for each item after this one.
+            const size_t left = ids.size() - i - 1;
+            if (out.payload().size() + 1 + documentBytes(*doc) + left > kMaxFrameBytes) {
+                out.u8(GetOmitted);
+                continue;
+            }
+            out.u8(GetFound);
+            out.document(*doc);
+        }
+        break;
+    }
+    case OpSave: {
+        string filename;
+        if (!in.str(filename)) return badRequest(tag, "Обрізаний запит");
+        if (!in.atEnd()) return trailingBytes();
+        out.u8(store.saveDocumentsToFile(filename.empty() ? "documents.txt" : filename) ? 1 : 0);
+        break;
+    }
+    default:
+        return badRequest(tag, "Невідома операція " + to_string(opcode));
+    }
+    return out.finish();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "DocumentStore.h"
+
+// Long-running server that keeps a warm store and validator chain resident
+// and answers batched requests (see DaemonProtocol.h) over a Unix domain
+// socket. One thread multiplexes every client with epoll; requests are
+// applied to the store one at a time, in arrival order per connection,
+// while large validate batches still fan out on the work-stealing
+// scheduler through validateEach. Linux only.
+class ValidationDaemon {
+public:
+    explicit ValidationDaemon(DocumentStore& documentStore) : store(documentStore) {}
+    ~ValidationDaemon();
+
+    ValidationDaemon(const ValidationDaemon&) = delete;
+    ValidationDaemon& operator=(const ValidationDaemon&) = delete;
+
+    // Binds and listens at `socketPath`, replacing a stale socket file.
+    bool listen(const std::string& socketPath, std::string& error);
+
+    // Serves until SIGINT or SIGTERM arrives. Both must already be blocked
+    // in every thread (block them before the scheduler starts), since they
+    // are read from a signalfd. False if the event loop cannot be set up.
+    bool run(std::string& error);
+
+    size_t requestsServed() const { return requests; }
+    size_t connectionsAccepted() const { return accepted; }
+
+private:
+    struct Connection {
+        std::string in;
+        std::string out;
+        size_t outPos = 0; // bytes of `out` already sent
+        bool closing = false; // peer finished sending; close once flushed
+        uint32_t interest = 0; // epoll events currently registered
+    };
+
+    DocumentStore& store;
+    std::string path;
+    int listenFd = -1;
+    int epollFd = -1;
+    int signalFd = -1;
+    std::unordered_map<int, Connection> connections;
+    size_t requests = 0;
+    size_t accepted = 0;
+
+    void acceptClients();
+    // Reads what the socket has, answers the complete frames and sends the
+    // answers as far as the socket takes them. Closes the connection (and
+    // returns false) on EOF once everything is sent, or on any error.
+    bool pump(int fd, Connection& conn, bool readable);
+    // False on a read error; `eof` is set once the peer stops sending.
+    bool readFrom(int fd, Connection& conn, bool& eof);
+    // False if the connection breaks the framing.
+    bool serveFrames(Connection& conn);
+    bool flush(int fd, Connection& conn);
+    void updateInterest(int fd, Connection& conn);
+    void closeConnection(int fd);
+
+    // Answers one request payload with a complete response frame.
+    std::string handle(const char* payload, size_t size);
+};
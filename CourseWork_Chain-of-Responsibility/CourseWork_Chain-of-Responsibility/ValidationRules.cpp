@@ -0,0 +1,306 @@
+#include "ValidationRules.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    string trim(const string& s) {
+        size_t first = s.find_first_not_of(" \t\r");
+        if (first == string::npos) return string();
+        size_t last = s.find_last_not_of(" \t\r");
+        return s.substr(first, last - first + 1);
+    }
+
+    vector<string> splitList(const string& value) {
+        vector<string> items;
+        stringstream ss(value);
+        string item;
+        while (getline(ss, item, ',')) {
+            item = trim(item);
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    bool parseFlag(const string& value, bool& flag) {
+        if (value == "yes" || value == "true" || value == "1") { flag = true; return true; }
+        if (value == "no" || value == "false" || value == "0") { flag = false; return true; }
+        return false;
+    }
+
+    bool parseSize(const string& value, size_t& size) {
+        try {
+            size_t used = 0;
+            unsigned long long parsed = stoull(value, &used);
+            if (used != value.size()) return false;
+            size = static_cast<size_t>(parsed);
+            return true;
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    bool parseFraction(const string& value, double& fraction) {
+        try {
+            size_t used = 0;
+            double parsed = stod(value, &used);
+            if (used != value.size() || !(parsed > 0 && parsed <= 1)) return false;
+            fraction = parsed;
+            return true;
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    const char* const kKnownLinks[] = { "format", "sniff", "content", "signature", "banned", "near-duplicates" };
+}
+
+bool loadValidationRules(const string& path, ValidationRules& rules, string& error) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        error = "не вдалося відкрити " + path;
+        return false;
+    }
+
+    ValidationRules parsed;
+    bool chainSet = false;
+    string line;
+    int lineNo = 0;
+    int lengthLine = 0; // the later of the min-length and max-length lines
+    while (getline(in, line)) {
+        ++lineNo;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t eq = line.find('=');
+        if (eq == string::npos) {
+            error = path + ":" + to_string(lineNo) + ": очікується 'ключ = значення'";
+            return false;
+        }
+        string key = trim(line.substr(0, eq));
+        string value = trim(line.substr(eq + 1));
+        bool ok = true;
+
+        if (key == "chain") {
+            parsed.chain = splitList(value);
+            chainSet = true;
+            for (const auto& link : parsed.chain) {
+                if (find(begin(kKnownLinks), end(kKnownLinks), link) == end(kKnownLinks)) ok = false;
+            }
+        }
+        else if (key == "formats") {
+            parsed.formats = splitList(value);
+        }
+        else if (key == "min-length") {
+            ok = parseSize(value, parsed.minLength);
+            lengthLine = lineNo;
+        }
+        else if (key == "max-length") {
+            ok = parseSize(value, parsed.maxLength);
+            lengthLine = lineNo;
+        }
+        else if (key == "require-signature") {
+            ok = parseFlag(value, parsed.requireSignature);
+        }
+        else if (key == "signature-key") {
+            ok = loadSigningKey(value, parsed.signingKey);
+        }
+        else if (key == "ban") {
+            ok = !value.empty();
+            parsed.bannedTerms.push_back(value);
+        }
+        else if (key == "ban-file") {
+            ifstream terms(value);
+            ok = terms.is_open();
+            string term;
+            while (ok && getline(terms, term)) {
+                term = trim(term);
+                if (!term.empty()) parsed.bannedTerms.push_back(term);
+            }
+        }
+        else if (key == "ban-regex") {
+            string reason;
+            if (!LinearRegex::compile(value, &reason)) {
+                error = path + ":" + to_string(lineNo) + ": некоректне правило 'ban-regex': " + reason;
+                return false;
+            }
+            parsed.bannedPatterns.push_back(value);
+        }
+        else if (key == "near-duplicate-similarity") {
+            ok = parseFraction(value, parsed.nearDuplicateSimilarity);
+        }
+        else if (key == "near-duplicate-shingle") {
+            ok = parseSize(value, parsed.nearDuplicateShingle) && parsed.nearDuplicateShingle > 0;
+        }
+        else {
+            ok = false;
+        }
+
+        if (!ok) {
+            error = path + ":" + to_string(lineNo) + ": некоректне правило '" + key + "'";
+            return false;
+        }
+    }
+
+    // Checked once both bounds are read, so they may come in either order.
+    if (parsed.minLength > parsed.maxLength) {
+        error = path + ":" + to_string(lengthLine) + ": min-length (" + to_string(parsed.minLength)
+            + ") більша за max-length (" + to_string(parsed.maxLength) + ")";
+        return false;
+    }
+
+    // Bans without an explicit chain still have to be enforced.
+    bool hasBans = !parsed.bannedTerms.empty() || !parsed.bannedPatterns.empty();
+    if (!chainSet && hasBans) parsed.chain.push_back("banned");
+
+    rules = parsed;
+    return true;
+}
+
+shared_ptr<Validator> buildValidatorChain(const ValidationRules& rules) {
+    vector<shared_ptr<Validator>> links;
+    for (const auto& name : rules.chain) {
+        if (name == "format") {
+            links.push_back(make_shared<AllowedFormatsValidator>(rules.formats));
+        }
+        else if (name == "sniff") {
+            links.push_back(make_shared<SniffedFormatValidator>());
+        }
+        else if (name == "content") {
+            links.push_back(make_shared<ContentLengthValidator>(rules.minLength, rules.maxLength));
+        }
+        else if (name == "signature" && rules.requireSignature) {
+            if (rules.signingKey.empty()) links.push_back(make_shared<SignatureValidator>());
+            else links.push_back(make_shared<HmacSignatureValidator>(rules.signingKey));
+        }
+        else if (name == "banned") {
+            if (!rules.bannedTerms.empty()) {
+                links.push_back(make_shared<ForbiddenTermsValidator>(rules.bannedTerms));
+            }
+            if (!rules.bannedPatterns.empty()) {
+                links.push_back(make_shared<BannedPatternsValidator>(rules.bannedPatterns));
+            }
+        }
+        else if (name == "near-duplicates") {
+            links.push_back(make_shared<NearDuplicateValidator>(rules.nearDuplicateSimilarity, rules.nearDuplicateShingle));
+        }
+    }
+
+    for (size_t i = 1; i < links.size(); ++i) {
+        links[i - 1]->setNext(links[i]);
+    }
+    return links.empty() ? make_shared<Validator>() : links.front();
+}
+
+shared_ptr<Validator> buildDefaultValidatorChain() {
+    auto formatValidator = make_shared<FormatValidator>();
+    auto contentValidator = make_shared<ContentValidator>();
+    auto signatureValidator = make_shared<SignatureValidator>();
+
+    // Link the chain: Format -> Content -> Signature
+    formatValidator->setNext(contentValidator);
+    contentValidator->setNext(signatureValidator);
+    return formatValidator;
+}
+
+AllowedFormatsValidator::AllowedFormatsValidator(vector<string> allowed)
+    : formats(move(allowed)) {}
+
+bool AllowedFormatsValidator::allows(const string& format) const {
+    for (const auto& f : formats) {
+        if (f == format) return true;
+    }
+    return false;
+}
+
+uint64_t AllowedFormatsValidator::configHash() const {
+    vector<string> sorted = formats; // order does not change any verdict
+    sort(sorted.begin(), sorted.end());
+    return hashConfig(sorted);
+}
+
+bool AllowedFormatsValidator::sameVerdict(const Validator& previous, const Document& doc, const ErrorSet&) const {
+    auto old = dynamic_cast<const AllowedFormatsValidator*>(&previous);
+    return old && old->allows(doc.format) == allows(doc.format);
+}
+
+void AllowedFormatsValidator::check(const Document& doc, vector<string>& errors) {
+    if (!allows(doc.format)) errors.push_back("- Формат");
+}
+
+void SniffedFormatValidator::check(const Document& doc, vector<string>& errors) {
+    SniffedFormat sniffed = doc.content.sniffedFormat();
+    if (!formatMatches(doc.format, sniffed)) {
+        errors.push_back(string("- Формат не відповідає вмісту (") + sniffedFormatName(sniffed) + ")");
+    }
+}
+
+ContentLengthValidator::ContentLengthValidator(size_t minLen, size_t maxLen)
+    : minLength(minLen), maxLength(maxLen) {}
+
+uint64_t ContentLengthValidator::configHash() const {
+    return hashConfig({ to_string(minLength), to_string(maxLength) });
+}
+
+bool ContentLengthValidator::sameVerdict(const Validator& previous, const Document& doc, const ErrorSet&) const {
+    auto old = dynamic_cast<const ContentLengthValidator*>(&previous);
+    return old && old->inRange(doc.content.length()) == inRange(doc.content.length());
+}
+
+void ContentLengthValidator::check(const Document& doc, vector<string>& errors) {
+    if (!inRange(doc.content.length())) {
+        errors.push_back("- Вміст");
+    }
+}
+
+BannedPatternsValidator::BannedPatternsValidator(const vector<string>& bannedPatterns)
+    : sources(bannedPatterns) {
+    for (const auto& p : bannedPatterns) {
+        if (auto compiled = LinearRegex::compile(p)) patterns.push_back(move(*compiled));
+    }
+}
+
+bool BannedPatternsValidator::sameVerdict(const Validator& previous, const Document& doc, const ErrorSet& previousErrors) const {
+    auto old = dynamic_cast<const BannedPatternsValidator*>(&previous);
+    if (!old) return false;
+
+    // Caught stays caught while no pattern is dropped; clean stays clean
+    // while none is added.
+    const auto& required = previousErrors.empty() ? sources : old->sources;
+    const auto& available = previousErrors.empty() ? old->sources : sources;
+    for (const auto& p : required) {
+        if (find(available.begin(), available.end(), p) == available.end()) return false;
+    }
+    return true;
+}
+
+void BannedPatternsValidator::check(const Document& doc, vector<string>& errors) {
+    search(doc, errors, nullptr);
+}
+
+bool BannedPatternsValidator::checkBounded(const Document& doc, vector<string>& errors,
+                                           WorkStealingScheduler*, const ValidationDeadline& deadline) {
+    return search(doc, errors, &deadline);
+}
+
+bool BannedPatternsValidator::search(const Document& doc, vector<string>& errors, const ValidationDeadline* deadline) const {
+    if (doc.content.empty()) return true;
+
+    string scratch;
+    const string& text = doc.content.text(scratch);
+
+    for (const auto& pattern : patterns) {
+        if (deadline && deadline->passed()) return false;
+        optional<bool> found = pattern.search(text, deadline);
+        if (!found) return false;
+        if (*found) {
+            errors.push_back("- Заборонений вміст");
+            return true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "Validator.h"
+#include "ForbiddenTermsValidator.h"
+#include "HmacSignatureValidator.h"
+#include "NearDuplicateValidator.h"
+#include "LinearRegex.h"
+
+// Declarative description of the validator chain, read from rules.txt:
+//
+//   chain = format, content, signature, banned
+//                                 ("sniff" checks the format against the content,
+//                                  "near-duplicates" flags resubmissions)
+//   formats = txt, pdf
+//   min-length = 1
+//   max-length = 1048576
+//   require-signature = yes
+//   signature-key = signing.key   (verify HMAC signatures, see HmacSignatureValidator)
+//   ban = confidential            (repeatable)
+//   ban-file = banned_terms.txt   (one term per line)
+//   ban-regex = pass(word)?\s*=   (ECMAScript without backreferences or
+//                                  lookaround, see LinearRegex; repeatable)
+//   near-duplicate-similarity = 0.8  (Jaccard index, see NearDuplicateValidator)
+//   near-duplicate-shingle = 5       (code points per shingle)
+struct ValidationRules {
+    std::vector<std::string> chain{ "format", "content", "signature" };
+    std::vector<std::string> formats{ "txt", "pdf" };
+    size_t minLength = 1;
+    size_t maxLength = SIZE_MAX;
+    bool requireSignature = true;
+    std::string signingKey; // raw key bytes; empty trusts Document::isSigned
+    std::vector<std::string> bannedTerms;
+    std::vector<std::string> bannedPatterns;
+    double nearDuplicateSimilarity = 0.8;
+    size_t nearDuplicateShingle = 5;
+};
+
+// On failure `error` names the offending line and `rules` is left untouched.
+bool loadValidationRules(const std::string& path, ValidationRules& rules, std::string& error);
+
+// Compiles the rules into linked validators in `chain` order.
+std::shared_ptr<Validator> buildValidatorChain(const ValidationRules& rules);
+
+// Built-in Format -> Content -> Signature chain, used when there is no rules.txt.
+std::shared_ptr<Validator> buildDefaultValidatorChain();
+
+class AllowedFormatsValidator : public Validator {
+private:
+    std::vector<std::string> formats; // few entries: a linear scan beats hashing
+    bool allows(const std::string& format) const;
+public:
+    explicit AllowedFormatsValidator(std::vector<std::string> allowed);
+    std::string stableId() const override { return "format"; }
+    uint64_t configHash() const override;
+    unsigned inputs() const override { return InputFormat; }
+    void describeErrors(ErrorPolicy& policy) const override { policy.allowFormats(formats); }
+    // Only documents whose format was added to or dropped from the list flip.
+    bool sameVerdict(const Validator& previous, const Document& doc, const ErrorSet& previousErrors) const override;
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+};
+
+// Compares the declared format with the one sniffed from the first bytes
+// of the content (see FormatSniffer.h) instead of trusting the string.
+// The sniff is cached on the body, so only the comparison is per document.
+class SniffedFormatValidator : public Validator {
+public:
+    std::string stableId() const override { return "format-sniff"; }
+    unsigned inputs() const override { return InputContent | InputFormat; }
+    void describeErrors(ErrorPolicy& policy) const override { policy.formatMismatch = true; }
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+};
+
+class ContentLengthValidator : public Validator {
+private:
+    size_t minLength;
+    size_t maxLength;
+    bool inRange(size_t length) const { return length >= minLength && length <= maxLength; }
+public:
+    ContentLengthValidator(size_t minLen, size_t maxLen);
+    std::string stableId() const override { return "content"; }
+    uint64_t configHash() const override;
+    unsigned inputs() const override { return InputContent; }
+    bool sameVerdict(const Validator& previous, const Document& doc, const ErrorSet& previousErrors) const override;
+protected:
+    // Length is cached on the content, no decompression needed.
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+};
+
+// Regex bans; plain terms go to ForbiddenTermsValidator. Matching is
+// linear in the content (LinearRegex), whatever the pattern.
+class BannedPatternsValidator : public Validator {
+private:
+    std::vector<std::string> sources;
+    std::vector<LinearRegex> patterns; // sources outside LinearRegex's syntax are skipped
+    // False if `deadline` passed before every pattern was tried.
+    bool search(const Document& doc, std::vector<std::string>& errors, const ValidationDeadline* deadline) const;
+public:
+    explicit BannedPatternsValidator(const std::vector<std::string>& bannedPatterns);
+    std::string stableId() const override { return "banned-patterns"; }
+    uint64_t configHash() const override { return hashConfig(sources); }
+    unsigned inputs() const override { return InputContent; }
+    // Pattern lists that only grew (or only shrank) keep part of the verdicts.
+    bool sameVerdict(const Validator& previous, const Document& doc, const ErrorSet& previousErrors) const override;
+protected:
+    bool cachesByContent() const override { return true; }
+    void check(const Document& doc, std::vector<std::string>& errors) override;
+    // The deadline is polled between patterns and every
+    // LinearRegex::kPollBytes within a search.
+    bool checkBounded(const Document& doc, std::vector<std::string>& errors,
+                      WorkStealingScheduler* scheduler, const ValidationDeadline& deadline) override;
+};
@@ -0,0 +1,104 @@
+#include "ValidationTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+    bool fasterThan(const ValidationTrace::SlowDocument& a, const ValidationTrace::SlowDocument& b) {
+        return a.totalNanoseconds > b.totalNanoseconds;
+    }
+
+    // Small stable numbers for the viewer's thread lanes.
+    unsigned traceThreadId() {
+        static atomic<unsigned> counter{ 1 };
+        thread_local unsigned id = counter++;
+        return id;
+    }
+
+    void writeJsonString(ostream& out, const string& text) {
+        out << '"';
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (c < 0x20) out << "\\u" << hex << setw(4) << setfill('0') << unsigned(c) << dec << setfill(' ');
+            else out << c;
+        }
+        out << '"';
+    }
+}
+
+ValidationTrace::ValidationTrace(size_t slowestKept, size_t maxEvents)
+    : keep(slowestKept), eventLimit(maxEvents) {}
+
+void ValidationTrace::record(DocumentId id, size_t bytes, const vector<LinkTiming>& links) {
+    SlowDocument doc{ id, bytes, 0, string(), 0 };
+    for (const auto& link : links) {
+        doc.totalNanoseconds += link.nanoseconds;
+        if (link.nanoseconds >= doc.slowestNanoseconds) {
+            doc.slowestNanoseconds = link.nanoseconds;
+            doc.slowestValidator = link.validator;
+        }
+    }
+    const unsigned thread = traceThreadId();
+
+    lock_guard<mutex> guard(lock);
+    ++documents;
+    for (const auto& link : links) {
+        if (events.size() >= eventLimit) {
+            ++dropped;
+            continue;
+        }
+        uint64_t start = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(link.start - origin).count());
+        events.push_back({ id, bytes, link.validator, start, link.nanoseconds, thread });
+    }
+
+    if (keep == 0) return;
+    if (heap.size() < keep) {
+        heap.push_back(move(doc));
+        push_heap(heap.begin(), heap.end(), fasterThan);
+    }
+    else if (doc.totalNanoseconds > heap.front().totalNanoseconds) {
+        pop_heap(heap.begin(), heap.end(), fasterThan);
+        heap.back() = move(doc);
+        push_heap(heap.begin(), heap.end(), fasterThan);
+    }
+}
+
+vector<ValidationTrace::SlowDocument> ValidationTrace::slowest() const {
+    lock_guard<mutex> guard(lock);
+    vector<SlowDocument> result = heap;
+    sort(result.begin(), result.end(), fasterThan);
+    return result;
+}
+
+size_t ValidationTrace::documentCount() const {
+    lock_guard<mutex> guard(lock);
+    return documents;
+}
+
+size_t ValidationTrace::droppedEvents() const {
+    lock_guard<mutex> guard(lock);
+    return dropped;
+}
+
+bool ValidationTrace::writeChromeTrace(const string& path) const {
+    ofstream out(path, ios::binary);
+    if (!out.is_open()) return false;
+
+    lock_guard<mutex> guard(lock);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << fixed << setprecision(3);
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        out << (i ? ",\n" : "\n") << "{\"name\":";
+        writeJsonString(out, e.validator);
+        out << ",\"cat\":\"validate\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":" << e.startNanoseconds / 1000.0
+            << ",\"dur\":" << e.nanoseconds / 1000.0
+            << ",\"args\":{\"id\":" << e.id << ",\"bytes\":" << e.bytes << "}}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Document.h"
+
+// Timing of validation runs, per document and per chain link. A storage
+// only measures while a trace is attached (setTrace), so with tracing off
+// the cost is one null check per document.
+class ValidationTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct LinkTiming {
+        std::string validator;
+        Clock::time_point start;
+        uint64_t nanoseconds;
+    };
+
+    struct SlowDocument {
+        DocumentId id;
+        size_t bytes;
+        uint64_t totalNanoseconds;
+        std::string slowestValidator;
+        uint64_t slowestNanoseconds;
+    };
+
+    explicit ValidationTrace(size_t slowestKept = 10, size_t maxEvents = 1000000);
+
+    // Called once per validated document, from any thread.
+    void record(DocumentId id, size_t bytes, const std::vector<LinkTiming>& links);
+
+    // Slowest first.
+    std::vector<SlowDocument> slowest() const;
+    size_t documentCount() const;
+    size_t droppedEvents() const;
+
+    // Chrome trace-event format ("X" events, microseconds), readable by
+    // chrome://tracing and Perfetto.
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    struct Event {
+        DocumentId id;
+        size_t bytes;
+        std::string validator;
+        uint64_t startNanoseconds; // since the trace was created
+        uint64_t nanoseconds;
+        unsigned thread;
+    };
+
+    const Clock::time_point origin = Clock::now();
+    const size_t keep;
+    const size_t eventLimit;
+
+    mutable std::mutex lock;
+    std::vector<Event> events;
+    std::vector<SlowDocument> heap; // min-heap on totalNanoseconds, at most `keep`
+    size_t documents = 0;
+    size_t dropped = 0;
+};
@@ -4,52 +4,207 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <cstdint>
+#include "WorkStealingScheduler.h"
+#include "Cancellation.h"
+
+// Error messages collected by a chain run, in chain order.
+using ErrorSet = std::vector<std::string>;
+
+// Document fields a link's verdict depends on.
+enum ValidatorInput : unsigned {
+    InputContent = 1,
+    InputSigned = 2,
+    InputFormat = 4,
+    InputAll = InputContent | InputSigned | InputFormat
+};
 
 class Validator {
 protected:
     std::shared_ptr<Validator> next;
+
+    // Checks performed by this link only; the chain walk lives in validate().
+    virtual void check(const Document& doc, std::vector<std::string>& errors) {}
+
+    // Links whose verdict depends on nothing but the content opt in here, so
+    // their result is cached on the (deduplicated) body and reused for every
+    // document sharing it.
+    virtual bool cachesByContent() const { return false; }
+
+    // Same result as check(), but a link with a long scan may split it into
+    // subtasks on `scheduler` (waiting for them before it returns).
+    virtual void checkParallel(const Document& doc, std::vector<std::string>& errors, WorkStealingScheduler& scheduler) {
+        check(doc, errors);
+    }
+
+    // Same result as checkParallel() (or check() without a scheduler), but
+    // a long scan polls `deadline` between its pieces and returns false,
+    // with `errors` incomplete, once it has passed. Links that finish fast
+    // keep this default and are only interrupted between links.
+    virtual bool checkBounded(const Document& doc, std::vector<std::string>& errors,
+                              WorkStealingScheduler* scheduler, const ValidationDeadline& deadline) {
+        runCheck(doc, errors, scheduler, nullptr);
+        return true;
+    }
+
+    // Process-unique key of this link in the body verdict caches.
+    uint64_t verdictKey() const { return serial; }
+
+    // FNV-1a over the items, for configHash() implementations.
+    static uint64_t hashConfig(const std::vector<std::string>& items, uint64_t seed = 14695981039346656037ull) {
+        uint64_t h = seed;
+        for (const auto& item : items) {
+            for (unsigned char c : item) h = (h ^ c) * 1099511628211ull;
+            h = (h ^ 0xFF) * 1099511628211ull; // separator, "ab","c" != "a","bc"
+        }
+        return h;
+    }
+
+private:
+    static uint64_t allocateSerial() {
+        static std::atomic<uint64_t> counter{ 1 };
+        return counter++;
+    }
+
+    // Unique for the process lifetime, unlike `this`, so cached verdicts of a
+    // destroyed validator can never be picked up by a new one.
+    const uint64_t serial = allocateSerial();
+
 public:
     virtual ~Validator() = default;
 
     void setNext(std::shared_ptr<Validator> nextValidator) {
         next = nextValidator;
     }
+    Validator* nextLink() const { return next.get(); }
+
+    // A link is recognised across chain rebuilds by its stable ID plus a
+    // hash of its configuration; "" means it is never matched. Storages
+    // keep per-link verdicts and reuse them when the pair is unchanged.
+    virtual std::string stableId() const { return std::string(); }
+    virtual uint64_t configHash() const { return 0; }
+    virtual unsigned inputs() const { return InputAll; }
+
+    // Called on a link whose configuration changed, with the old link of the
+    // same stableId() and its verdict for `doc`: true if this link is known
+    // to give the same verdict, so the document need not be re-checked.
+    virtual bool sameVerdict(const Validator& previous, const Document& doc, const ErrorSet& previousErrors) const {
+        return false;
+    }
+
+    // Links whose verdict depends on the other stored documents, not only
+    // on the one checked, opt in here. Stores then report every document
+    // entering or leaving the corpus (a re-add of an unchanged document
+    // may happen and must be harmless) and drop the link's verdicts
+    // whenever the corpus changes. Not called concurrently with checks.
+    virtual bool tracksCorpus() const { return false; }
+    virtual void corpusAdded(const Document& doc) {}
+    virtual void corpusRemoved(const Document& doc) {}
+    virtual void corpusCleared() {}
+
+    // Links checking one of the DocumentError categories that is not always
+    // reported switch it on here (see errorPolicyOf).
+    virtual void describeErrors(ErrorPolicy& policy) const {}
 
     // Returns true if valid so far, but we want to collect ALL errors.
     // So we usually return void or bool, but append to errors vector.
-    virtual void validate(const Document& doc, std::vector<std::string>& errors) {
+    // With a scheduler, links may spread a single document over its workers.
+    virtual void validate(const Document& doc, std::vector<std::string>& errors,
+                          WorkStealingScheduler* scheduler = nullptr) {
+        validateLink(doc, errors, scheduler);
+
         if (next) {
-            next->validate(doc, errors);
+            next->validate(doc, errors, scheduler);
+        }
+    }
+
+    // This link only, without walking the rest of the chain. With a
+    // deadline, false means it passed first: `errors` is then incomplete
+    // and nothing was cached.
+    bool validateLink(const Document& doc, std::vector<std::string>& errors,
+                      WorkStealingScheduler* scheduler = nullptr, const ValidationDeadline* deadline = nullptr) {
+        if (deadline && deadline->passed()) return false;
+        if (cachesByContent() && !doc.content.empty()) {
+            if (!doc.content.findVerdict(serial, errors)) {
+                std::vector<std::string> found;
+                if (!runCheck(doc, found, scheduler, deadline)) return false;
+                doc.content.storeVerdict(serial, found);
+                errors.insert(errors.end(), found.begin(), found.end());
+            }
+            return true;
+        }
+        return runCheck(doc, errors, scheduler, deadline);
+    }
+
+    // The whole chain from this link, like validate(), but giving up (and
+    // returning false) once `deadline` has passed.
+    bool validateWithin(const Document& doc, std::vector<std::string>& errors,
+                        const ValidationDeadline& deadline, WorkStealingScheduler* scheduler = nullptr) {
+        for (Validator* link = this; link; link = link->nextLink()) {
+            if (!link->validateLink(doc, errors, scheduler, &deadline)) return false;
         }
+        return true;
+    }
+
+private:
+    bool runCheck(const Document& doc, std::vector<std::string>& errors,
+                  WorkStealingScheduler* scheduler, const ValidationDeadline* deadline) {
+        if (deadline && !deadline->unbounded()) return checkBounded(doc, errors, scheduler, *deadline);
+        if (scheduler) checkParallel(doc, errors, *scheduler);
+        else check(doc, errors);
+        return true;
     }
 };
 
+// How reports name a link: its stable ID, or else its position in the chain.
+inline std::string linkLabel(const Validator& link, size_t index) {
+    std::string name = link.stableId();
+    return name.empty() ? "link " + std::to_string(index + 1) : name;
+}
+
+// The error categories `chain` checks, for detectErrors().
+inline ErrorPolicy errorPolicyOf(const Validator* chain) {
+    ErrorPolicy policy;
+    for (const Validator* link = chain; link; link = link->nextLink()) link->describeErrors(policy);
+    return policy;
+}
+
 class FormatValidator : public Validator {
 public:
-    void validate(const Document& doc, std::vector<std::string>& errors) override {
+    std::string stableId() const override { return "builtin-format"; }
+    unsigned inputs() const override { return InputFormat; }
+    void describeErrors(ErrorPolicy& policy) const override { policy.allowFormats({ "txt", "pdf" }); }
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override {
         if (doc.format != "txt" && doc.format != "pdf") {
             errors.push_back("- Формат");
         }
-        Validator::validate(doc, errors);
     }
 };
 
+// Emptiness is cached on the body already, a verdict lookup would cost more
+// than the check itself, so this link does not use cachesByContent().
 class ContentValidator : public Validator {
 public:
-    void validate(const Document& doc, std::vector<std::string>& errors) override {
+    std::string stableId() const override { return "builtin-content"; }
+    unsigned inputs() const override { return InputContent; }
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override {
         if (doc.content.empty()) {
             errors.push_back("- Вміст");
         }
-        Validator::validate(doc, errors);
     }
 };
 
 class SignatureValidator : public Validator {
 public:
-    void validate(const Document& doc, std::vector<std::string>& errors) override {
+    std::string stableId() const override { return "signature"; }
+    unsigned inputs() const override { return InputSigned; }
+protected:
+    void check(const Document& doc, std::vector<std::string>& errors) override {
         if (!doc.isSigned) {
             errors.push_back("- Підпис");
         }
-        Validator::validate(doc, errors);
     }
 };
@@ -0,0 +1,138 @@
+#include "WorkStealingScheduler.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    // Which scheduler the current thread works for, and its queue there.
+    thread_local const WorkStealingScheduler* currentScheduler = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+WorkStealingScheduler& WorkStealingScheduler::shared() {
+    static WorkStealingScheduler scheduler;
+    return scheduler;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(size_t threadCount) {
+    if (threadCount == 0) {
+        size_t hardware = thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (size_t i = 0; i <= threadCount; ++i) {
+        queues.push_back(make_unique<Queue>());
+    }
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+size_t WorkStealingScheduler::ownQueue() const {
+    return currentScheduler == this ? currentQueue : 0;
+}
+
+void WorkStealingScheduler::spawn(TaskGroup& group, function<void()> task) {
+    group.pending.fetch_add(1, memory_order_relaxed);
+
+    Queue& queue = *queues[ownQueue()];
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.jobs.push_back({ move(task), &group });
+    }
+    {
+        // Counted under the sleep lock so a worker about to sleep sees it.
+        lock_guard<mutex> guard(sleepLock);
+        queued.fetch_add(1, memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingScheduler::popOwn(size_t self, Job& job) {
+    Queue& queue = *queues[self];
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.jobs.empty()) return false;
+    // Workers take their newest task; the injection queue is FIFO.
+    if (self == 0) {
+        job = move(queue.jobs.front());
+        queue.jobs.pop_front();
+    }
+    else {
+        job = move(queue.jobs.back());
+        queue.jobs.pop_back();
+    }
+    return true;
+}
+
+bool WorkStealingScheduler::steal(size_t self, Job& job) {
+    const size_t count = queues.size();
+    for (size_t step = 1; step < count; ++step) {
+        Queue& victim = *queues[(self + step) % count];
+        unique_lock<mutex> guard(victim.lock, try_to_lock);
+        if (!guard.owns_lock() || victim.jobs.empty()) continue;
+        job = move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingScheduler::runOne(size_t self) {
+    Job job;
+    if (!popOwn(self, job) && !steal(self, job)) return false;
+    queued.fetch_sub(1, memory_order_relaxed);
+    execute(job);
+    return true;
+}
+
+void WorkStealingScheduler::execute(Job& job) {
+    TaskGroup& group = *job.group;
+    try {
+        job.run();
+    }
+    catch (...) {
+        lock_guard<mutex> guard(group.errorLock);
+        if (!group.error) group.error = current_exception();
+    }
+    job.run = nullptr; // release captures before the group is reported done
+    group.pending.fetch_sub(1, memory_order_release);
+}
+
+void WorkStealingScheduler::wait(TaskGroup& group) {
+    const size_t self = ownQueue();
+    while (group.pending.load(memory_order_acquire) != 0) {
+        if (!runOne(self)) this_thread::yield();
+    }
+
+    lock_guard<mutex> guard(group.errorLock);
+    if (group.error) {
+        exception_ptr error = group.error;
+        group.error = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void WorkStealingScheduler::workerLoop(size_t self) {
+    currentScheduler = this;
+    currentQueue = self;
+
+    while (true) {
+        if (runOne(self)) continue;
+
+        unique_lock<mutex> guard(sleepLock);
+        // A failed steal can race with a busy queue lock, so only sleep
+        // when nothing is queued anywhere.
+        wake.wait(guard, [this] { return stopping || queued.load(memory_order_relaxed) != 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks spawned together; WorkStealingScheduler::wait returns once all of
+// them (and anything they spawned into the same group) have finished.
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+    friend class WorkStealingScheduler;
+
+    std::atomic<size_t> pending{ 0 };
+    std::mutex errorLock;
+    std::exception_ptr error; // first exception thrown by a task
+};
+
+// CPU pool for validation. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (newest first, cache-warm), while idle workers
+// steal from the front of the others (oldest first, usually the biggest
+// pieces). Threads outside the pool feed a shared injection queue, and a
+// thread waiting for a group runs queued tasks instead of blocking, so
+// tasks may spawn and wait for subtasks without deadlocking.
+class WorkStealingScheduler {
+public:
+    static WorkStealingScheduler& shared();
+
+    // 0 picks one worker per hardware thread, less the waiting caller.
+    explicit WorkStealingScheduler(size_t threads = 0);
+    ~WorkStealingScheduler();
+
+    WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+    size_t workerCount() const { return threads.size(); }
+
+    void spawn(TaskGroup& group, std::function<void()> task);
+    // Helps running tasks until the group is done, then rethrows the first
+    // exception of the group, if any.
+    void wait(TaskGroup& group);
+
+private:
+    struct Job {
+        std::function<void()> run;
+        TaskGroup* group;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    // queues[0] is the injection queue, queues[i + 1] belongs to worker i.
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    size_t ownQueue() const;
+    bool popOwn(size_t self, Job& job);
+    bool steal(size_t self, Job& job);
+    bool runOne(size_t self);
+    void execute(Job& job);
+    void workerLoop(size_t self);
+};
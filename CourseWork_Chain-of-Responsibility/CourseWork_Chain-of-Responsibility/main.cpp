@@ -2,34 +2,21 @@
 #include <string>
 #include <limits>
 #include <fstream>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <iomanip>
 #include "DocumentStorage.h"
-#include <Windows.h>
+#include "ShardedDocumentStorage.h"
+#include "DocumentConsole.h"
+#include "ValidationRules.h"
+#include "Console.h"
+#include "Sha256.h"
 
 using namespace std;
 
-// Helper functions (moved from original monolithic file or duplicated if simple)
-bool getValidatedInt(const string& prompt, int& result, int min, int max) {
-    cout << prompt;
-    string input;
-    getline(cin, input);
-
-    try {
-        result = stoi(input);
-        if (result < min || result > max) throw out_of_range("Out of range");
-        return true;
-    }
-    catch (...) {
-        cout << "Некоректне значення. Спробуйте ще раз!\n";
-        return false;
-    }
-}
-
-void logResult(const string& message) {
-    ofstream logFile("log.txt", ios::app);
-    logFile << message << endl;
-    logFile.close();
-}
-
 void showMenu() {
     cout << "+-------------------------------------------------+" << endl;
     cout << "|        Меню системи перевірки документів        |" << endl;
@@ -43,117 +30,247 @@ void showMenu() {
     cout << "| 7 |  Зберегти документи у файл                  |" << endl;
     cout << "| 8 |  Видалити документ за ID                    |" << endl;
     cout << "| 9 |  Завантажити документи з файлу              |" << endl;
+    cout << "| 10 | Запит за індексом (без завантаження)       |" << endl;
+    cout << "| 11 | Перевірка з трасуванням                    |" << endl;
+    cout << "| 12 | Використання пам'яті                       |" << endl;
+    cout << "| 13 | Статистика корпусу                         |" << endl;
+    cout << "| 14 | Пошук за текстом                           |" << endl;
+    cout << "| 15 | Запит за фільтром                          |" << endl;
     cout << "| 0 |  Вийти                                      |" << endl;
     cout << "+-------------------------------------------------+" << endl;
 }
 
-int getValidatedMenuChoice(const string& prompt, int minOption, int maxOption) {
-    int choice;
-    string input;
-    while (true) {
-        cout << prompt;
-        getline(cin, input);
+// Hashing throughput of every backend this CPU supports, on one thread and
+// on one thread per hardware thread, so the scaling per core is visible.
+void runSha256Benchmark() {
+    const size_t kBytes = 64 << 20;
+    const unsigned cores = max(1u, thread::hardware_concurrency());
+    const string data(kBytes, 'x');
 
-        try {
-            choice = stoi(input);
-            if (choice >= minOption && choice <= maxOption) {
-                return choice;
-            }
-            else {
-                cout << "Неправильний пункт меню. Вибір має бути між " << minOption << " і " << maxOption << ".\n";
-            }
-        }
-        catch (...) {
-            cout << "Некоректний пункт меню. Спробуйте ще раз.\n";
+    auto megabytesPerSecond = [&](Sha256::Backend backend, unsigned threads) {
+        vector<thread> workers;
+        auto start = chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&data, backend] {
+                Sha256 sha(backend);
+                sha.update(data.data(), data.size());
+                volatile uint8_t sink = sha.finish()[0];
+                (void)sink;
+            });
         }
+        for (auto& worker : workers) worker.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return threads * (kBytes / 1e6) / seconds;
+    };
+
+    cout << "SHA-256, " << (kBytes >> 20) << " МіБ на потік, ядер: " << cores << "\n";
+    cout << fixed << setprecision(1);
+    for (Sha256::Backend backend : { Sha256::Backend::Scalar, Sha256::Backend::ShaNi }) {
+        if (!Sha256::supported(backend)) {
+            cout << Sha256::backendName(backend) << ": не підтримується процесором\n";
+            continue;
+        }
+        double single = megabytesPerSecond(backend, 1);
+        double all = megabytesPerSecond(backend, cores);
+        cout << Sha256::backendName(backend) << ": 1 потік " << single << " МБ/с, "
+            << cores << " потоків " << all << " МБ/с (" << all / cores << " МБ/с на ядро)\n";
     }
 }
 
-int main() {
-    // Set console encoding for Ukrainian characters
-    SetConsoleCP(1251);
-    SetConsoleOutputCP(1251);
+int main(int argc, char* argv[]) {
+    initConsole();
 
-    DocumentStorage DocSystem;
-    
-    // Construct Chain of Responsibility
-    auto formatValidator = make_shared<FormatValidator>();
-    auto contentValidator = make_shared<ContentValidator>();
-    auto signatureValidator = make_shared<SignatureValidator>();
+    // --shards <dir> keeps the documents in a sharded directory instead of
+    // memory; --memory-budget <MiB> caps the memory held (in-memory storage
+    // refuses further documents, sharded storage spills shards).
+    // --crawl <dir> ingests a directory tree of files before the menu opens.
+    // --time-limit <ms> bounds every "verify all" run (Ctrl+C stops one too).
+    // --page-size <n> sets the rows per page of document lists (0 = all).
+    // --stats <file> prints the corpus statistics of a documents file,
+    // streamed rather than loaded, and exits.
+    string shardDirectory;
+    string crawlRoot;
+    ShardOptions shardOptions;
+    size_t memoryBudget = 0;
+    chrono::milliseconds timeLimit{ 0 };
+    string statsFile;
+    size_t pageSize = 20;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--shards" && i + 1 < argc) {
+            shardDirectory = argv[++i];
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            memoryBudget = static_cast<size_t>(strtoull(argv[++i], nullptr, 10)) * 1024 * 1024;
+        }
+        else if (arg == "--time-limit" && i + 1 < argc) {
+            timeLimit = chrono::milliseconds(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--crawl" && i + 1 < argc) {
+            crawlRoot = argv[++i];
+        }
+        else if (arg == "--page-size" && i + 1 < argc) {
+            pageSize = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--stats" && i + 1 < argc) {
+            statsFile = argv[++i];
+        }
+        else if (arg == "--bench-sha256") {
+            runSha256Benchmark();
+            return 0;
+        }
+        else {
+            cerr << "Невідомий аргумент: " << arg << "\n";
+            return 1;
+        }
+    }
 
-    // Link the chain: Format -> Content -> Signature
-    formatValidator->setNext(contentValidator);
-    contentValidator->setNext(signatureValidator);
+    // Construct Chain of Responsibility from rules.txt when present,
+    // otherwise fall back to the built-in Format -> Content -> Signature chain.
+    shared_ptr<Validator> chain;
+    ValidationRules rules;
+    string rulesError;
+    if (loadValidationRules("rules.txt", rules, rulesError)) {
+        chain = buildValidatorChain(rules);
+    }
+    else {
+        if (ifstream("rules.txt").good()) {
+            cerr << "Помилка у файлі правил: " << rulesError << "\n";
+        }
+        chain = buildDefaultValidatorChain();
+    }
 
-    // Inject chain into storage
-    DocSystem.setValidatorChain(formatValidator);
+    if (!statsFile.empty()) {
+        CorpusStatistics stats;
+        vector<MalformedRecord> malformed;
+        if (!collectFileStatistics(statsFile, chain, stats, &malformed)) {
+            cerr << "Не вдалося відкрити файл: " << statsFile << "\n";
+            return 1;
+        }
+        DocumentConsole::printStatistics(stats);
+        if (!malformed.empty()) {
+            cout << "Пропущено пошкоджених записів: " << malformed.size() << "\n";
+        }
+        return 0;
+    }
+
+    unique_ptr<DocumentStore> store;
+    if (shardDirectory.empty()) {
+        store = make_unique<DocumentStorage>();
+    }
+    else {
+        auto sharded = make_unique<ShardedDocumentStorage>(shardDirectory, shardOptions);
+        if (!sharded->isOpen()) {
+            cerr << "Не вдалося відкрити каталог шардів: " << shardDirectory << "\n";
+            return 1;
+        }
+        store = move(sharded);
+    }
+    store->setMemoryBudget(memoryBudget);
+    DocumentStore& DocSystem = *store;
+    DocumentConsole DocConsole(DocSystem);
+    DocConsole.setValidationTimeLimit(timeLimit);
+    DocConsole.setPageSize(pageSize);
+    DocSystem.setValidatorChain(chain);
+
+    if (!crawlRoot.empty()) {
+        DocConsole.importDirectory(crawlRoot);
+    }
 
     showMenu();
     int choice;
     do {
-        choice = getValidatedMenuChoice("Оберіть опцію: ", 0, 9);
+        choice = getValidatedMenuChoice("Оберіть опцію: ", 0, 15);
 
         switch (choice) {
         case 1:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.addDocumentManually();
+            DocConsole.addDocumentManually();
             break;
         case 2:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.editDocumentById();
+            DocConsole.editDocumentById();
             break;
         case 3:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.verifyAllDocuments();
+            DocConsole.verifyAllDocuments();
             break;
         case 4:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.clearAllDocuments();
+            DocConsole.clearAllDocuments();
             break;
         case 5: {
             int errorOption;
-            DocSystem.showErrorFilterMenu();
+            DocConsole.showErrorFilterMenu();
             do {
-                errorOption = getValidatedMenuChoice("Ваш вибір: ", 0, 4);
-                if (errorOption >= 1 && errorOption <= 4) {
-                    system("cls");
+                errorOption = getValidatedMenuChoice("Ваш вибір: ", 0, 5);
+                if (errorOption >= 1 && errorOption <= 5) {
+                    clearScreen();
                     showMenu();
-                    DocSystem.showErrorFilterMenu();
-                    DocSystem.handleErrorSearch(errorOption);
+                    DocConsole.showErrorFilterMenu();
+                    DocConsole.handleErrorSearch(errorOption);
                 }
             } while (errorOption != 0);
-            system("cls");
+            clearScreen();
             showMenu();
             break;
         }
         case 6:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.printAllDocuments();
+            DocConsole.printAllDocuments();
             break;
         case 7:
-            system("cls");
+            clearScreen();
             showMenu();
-            DocSystem.saveDocumentsToFile();
-            cout << "Документи збережено!" << endl;
+            DocConsole.saveDocumentsToFile();
             break;
         case 8: {
-            system("cls");
+            clearScreen();
             showMenu();
-            int delId;
-            while (!getValidatedInt("Введіть ID документа для видалення: ", delId, 1, INT_MAX)) {}
-            DocSystem.deleteDocumentById(delId);
+            DocumentId delId;
+            while (!getValidatedId("Введіть ID документа для видалення: ", delId)) {}
+            DocConsole.deleteDocumentById(delId);
             break;
         }
         case 9:
-            system("cls");
+            clearScreen();
+            showMenu();
+            DocConsole.loadDocumentsFromFile();
+            break;
+        case 10:
+            clearScreen();
+            showMenu();
+            DocConsole.queryIndexWithoutLoading();
+            break;
+        case 11:
+            clearScreen();
+            showMenu();
+            DocConsole.traceAllDocuments();
+            break;
+        case 12:
+            clearScreen();
+            showMenu();
+            DocConsole.printMemoryUsage();
+            break;
+        case 13:
+            clearScreen();
+            showMenu();
+            DocConsole.printCorpusStatistics();
+            break;
+        case 14:
+            clearScreen();
+            showMenu();
+            DocConsole.searchDocumentsByText();
+            break;
+        case 15:
+            clearScreen();
             showMenu();
-            DocSystem.loadDocumentsFromFile();
-            cout << "Документи завантажено!" << endl;
+            DocConsole.queryDocuments();
             break;
         case 0:
             cout << "Вихід з програми...\n";
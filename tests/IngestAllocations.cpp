@@ -0,0 +1,75 @@
+// Counts the heap allocations big enough to hold a document body while a
+// body goes through the ingest path, to check that it is moved, not copied:
+// add() and edit() must not allocate a second body, and a load only the
+// chunk it reads the file into plus the line the body is copied out of.
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fstream>
+#include "DocumentStorage.h"
+
+namespace {
+    const size_t kBody = 4 << 20;
+    size_t largeAllocations = 0;
+}
+
+void* operator new(size_t size) {
+    if (size >= kBody) ++largeAllocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+    int failures = 0;
+
+    void expectAtMost(const char* step, size_t counted, size_t limit) {
+        std::printf("%-28s %zu large allocation(s), limit %zu\n", step, counted, limit);
+        if (counted > limit) ++failures;
+    }
+
+    void expect(const char* step, bool ok) {
+        if (ok) return;
+        std::printf("%s failed\n", step);
+        ++failures;
+    }
+}
+
+int main() {
+    const std::string path = "ingest_allocations.txt";
+    DocumentStorage storage;
+
+    std::string body(kBody, 'a');
+    largeAllocations = 0;
+    Document doc(std::move(body), true, "txt");
+    DocumentId id = storage.add(std::move(doc));
+    expectAtMost("Document + add()", largeAllocations, 0);
+    expect("add()", id != 0);
+
+    std::string replacement(kBody, 'b');
+    largeAllocations = 0;
+    const bool edited = storage.edit(id, DocumentPatch{ std::move(replacement), std::nullopt, std::nullopt, std::nullopt });
+    expectAtMost("edit()", largeAllocations, 0);
+    expect("edit()", edited);
+
+    if (!storage.saveDocumentsToFile(path)) {
+        std::printf("cannot write %s\n", path.c_str());
+        return 1;
+    }
+    DocumentStorage loaded;
+    largeAllocations = 0;
+    loaded.loadDocumentsFromFile(path);
+    const size_t loadAllocations = largeAllocations;
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+    expectAtMost("loadDocumentsFromFile()", loadAllocations, 2);
+    expect("loaded size", loaded.size() == 1);
+    const auto found = loaded.find(id);
+    expect("loaded body", found && found->content.str() == std::string(kBody, 'b'));
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+// Known-answer tests for SHA-256 (FIPS 180-4 examples) and HMAC-SHA-256
+// (RFC 4231), run on every backend this CPU supports, so the SHA-NI and
+// the portable compression functions are both checked against the
+// published digests and not only against each other.
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include "Sha256.h"
+
+namespace {
+    int failures = 0;
+
+    void expectHex(const char* name, Sha256::Backend backend, const Sha256::Digest& digest, const char* expected) {
+        const std::string hex = Sha256::toHex(digest);
+        if (hex == expected) return;
+        std::printf("%s (%s): got %s, expected %s\n", name, Sha256::backendName(backend), hex.c_str(), expected);
+        ++failures;
+    }
+
+    // The whole message in one update(), then in pieces of `step` bytes,
+    // which crosses block boundaries at a different place each time.
+    void checkHash(const char* name, Sha256::Backend backend, const std::string& message, const char* expected) {
+        Sha256 whole(backend);
+        whole.update(message.data(), message.size());
+        expectHex(name, backend, whole.finish(), expected);
+
+        for (size_t step : { size_t(1), size_t(63), size_t(65) }) {
+            Sha256 pieces(backend);
+            for (size_t at = 0; at < message.size(); at += step) {
+                pieces.update(message.data() + at, std::min(step, message.size() - at));
+            }
+            expectHex(name, backend, pieces.finish(), expected);
+        }
+    }
+
+    void checkHmac(const char* name, Sha256::Backend backend, const std::string& key, const std::string& data, const char* expected) {
+        expectHex(name, backend, HmacSha256(key, backend).sign(data), expected);
+    }
+}
+
+int main() {
+    for (Sha256::Backend backend : { Sha256::Backend::Scalar, Sha256::Backend::ShaNi }) {
+        if (!Sha256::supported(backend)) {
+            std::printf("%s: not supported by this CPU, skipped\n", Sha256::backendName(backend));
+            continue;
+        }
+        std::printf("%s\n", Sha256::backendName(backend));
+
+        checkHash("empty", backend, "",
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        checkHash("abc", backend, "abc",
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        checkHash("448 bits", backend, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+        checkHash("896 bits", backend,
+            "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+            "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+        checkHash("million a", backend, std::string(1000000, 'a'),
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+        // RFC 4231 test cases 1-4, 6 and 7; case 5 checks a truncated tag.
+        const std::string key131(131, '\xaa');
+        checkHmac("RFC 4231 case 1", backend, std::string(20, '\x0b'), "Hi There",
+            "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+        checkHmac("RFC 4231 case 2", backend, "Jefe", "what do ya want for nothing?",
+            "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+        checkHmac("RFC 4231 case 3", backend, std::string(20, '\xaa'), std::string(50, '\xdd'),
+            "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+        std::string key25;
+        for (char c = 1; c <= 25; ++c) key25.push_back(c);
+        checkHmac("RFC 4231 case 4", backend, key25, std::string(50, '\xcd'),
+            "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+        checkHmac("RFC 4231 case 6", backend, key131, "Test Using Larger Than Block-Size Key - Hash Key First",
+            "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+        checkHmac("RFC 4231 case 7", backend, key131,
+            "This is a test using a larger than block-size key and a larger than block-size data. "
+            "The key needs to be hashed before being used by the HMAC algorithm.",
+            "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+    }
+    return failures == 0 ? 0 : 1;
+}